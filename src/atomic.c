@@ -0,0 +1,85 @@
+/*=============================================================================
+    atomic.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+#include "atomic.h"
+
+/*-----------------------------------------------------------------------------
+    AtomicLoadAcquire
+    Read a value shared between threads. Reads and writes that follow the
+    load cannot be reordered before it.
+ ----------------------------------------------------------------------------*/
+uint32_t AtomicLoadAcquire(volatile uint32_t *value)
+{
+#ifdef _MSC_VER
+    uint32_t result = *value;
+    _ReadWriteBarrier();
+    return result;
+#else
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    AtomicStoreRelease
+    Write a value shared between threads. Reads and writes that precede the
+    store cannot be reordered after it.
+ ----------------------------------------------------------------------------*/
+void AtomicStoreRelease(volatile uint32_t *value, uint32_t newValue)
+{
+#ifdef _MSC_VER
+    _ReadWriteBarrier();
+    *value = newValue;
+#else
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AtomicAdd
+    Add to a value shared between threads and return the new value.
+ ----------------------------------------------------------------------------*/
+uint32_t AtomicAdd(volatile uint32_t *value, uint32_t addend)
+{
+#ifdef _MSC_VER
+    return (uint32_t)_InterlockedExchangeAdd((volatile long *)value, (long)addend) + addend;
+#else
+    return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    AtomicAdd64
+    Add to a 64 bit value shared between threads and return the new value.
+ ----------------------------------------------------------------------------*/
+uint64_t AtomicAdd64(volatile uint64_t *value, uint64_t addend)
+{
+#ifdef _MSC_VER
+    return (uint64_t)_InterlockedExchangeAdd64((volatile __int64 *)value, (__int64)addend) + addend;
+#else
+    return __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+    AtomicCompareExchange
+    Replace a value shared between threads if it still holds the expected
+    value. Returns true if the value was replaced.
+ ----------------------------------------------------------------------------*/
+bool AtomicCompareExchange(volatile uint32_t *value, uint32_t expected, uint32_t newValue)
+{
+#ifdef _MSC_VER
+    return (uint32_t)_InterlockedCompareExchange((volatile long *)value, (long)newValue, (long)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(value, &expected, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
\ No newline at end of file
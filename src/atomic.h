@@ -0,0 +1,17 @@
+/*=============================================================================
+    atomic.h
+ =============================================================================*/
+
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+uint32_t AtomicLoadAcquire(volatile uint32_t *);
+void AtomicStoreRelease(volatile uint32_t *, uint32_t);
+uint32_t AtomicAdd(volatile uint32_t *, uint32_t);
+uint64_t AtomicAdd64(volatile uint64_t *, uint64_t);
+bool AtomicCompareExchange(volatile uint32_t *, uint32_t, uint32_t);
+
+#endif /* ATOMIC_H */
\ No newline at end of file
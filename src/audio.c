@@ -0,0 +1,425 @@
+/*=============================================================================
+    audio.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define AUDIO_SSE2
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define AUDIO_NEON
+#endif
+
+#include "audio.h"
+
+/*-----------------------------------------------------------------------------
+    AudioQueueInit
+    Initialize an empty audio command queue.
+ ----------------------------------------------------------------------------*/
+void AudioQueueInit(struct audio_queue *audioQueue)
+{
+    audioQueue->writeIndex = 0;
+    audioQueue->readIndex = 0;
+    audioQueue->closed = 0;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioPlay
+    Ask the mixer to start a sound at a volume out of AUDIO_VOLUME_FULL.
+    Returns false, and drops the sound, if the queue is full or closed.
+    Only called by the producer.
+ ----------------------------------------------------------------------------*/
+bool AudioPlay(struct audio_queue *audioQueue, int sound, int volume)
+{
+    uint32_t writeIndex = audioQueue->writeIndex;
+    uint32_t readIndex = AtomicLoadAcquire(&audioQueue->readIndex);
+    struct audio_command *command;
+
+    if (writeIndex - readIndex >= AUDIO_QUEUE_SIZE || AtomicLoadAcquire(&audioQueue->closed))
+        return false;
+
+    command = &audioQueue->commands[writeIndex & AUDIO_QUEUE_MASK];
+    command->sound = (uint8_t)sound;
+    command->volume = (int16_t)volume;
+    AtomicStoreRelease(&audioQueue->writeIndex, writeIndex + 1);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioMixerInit
+    Initialize a mixer with no voices playing, and decode every sound.
+ ----------------------------------------------------------------------------*/
+void AudioMixerInit(struct audio_mixer *mixer, struct audio_sink *sink)
+{
+    AudioQueueInit(&mixer->queue);
+    for (int sound = 0; sound < NUM_SOUNDS; sound++)
+        AudioSoundInit(&mixer->sounds[sound], sound);
+    mixer->voiceCount = 0;
+    mixer->sink = sink;
+    mixer->quit = 0;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioSoundInit
+    Synthesize a sound: a tone sliding from one pitch to another under a
+    decaying envelope, with a few milliseconds of attack so it does not
+    click.
+ ----------------------------------------------------------------------------*/
+void AudioSoundInit(struct audio_sound *audioSound, int sound)
+{
+    float startHz, endHz, seconds, decay, phase, hz, envelope, value;
+    bool square;
+
+    switch (sound) {
+    case SOUND_PADDLE:
+        startHz = 440.0f; endHz = 440.0f; seconds = 0.06f; decay = 40.0f; square = true;
+        break;
+    case SOUND_BRICK:
+        startHz = 880.0f; endHz = 1320.0f; seconds = 0.08f; decay = 30.0f; square = true;
+        break;
+    case SOUND_LIFE_LOST:
+        startHz = 400.0f; endHz = 80.0f; seconds = 0.45f; decay = 4.0f; square = false;
+        break;
+    default:
+        startHz = 660.0f; endHz = 660.0f; seconds = 0.1f; decay = 25.0f; square = false;
+        break;
+    }
+
+    audioSound->frameCount = (int)(seconds * AUDIO_SAMPLE_RATE);
+    if (audioSound->frameCount > AUDIO_SOUND_FRAMES_MAX)
+        audioSound->frameCount = AUDIO_SOUND_FRAMES_MAX;
+
+    phase = 0.0f;
+    for (int frame = 0; frame < audioSound->frameCount; frame++) {
+        hz = startHz + (endHz - startHz) * frame / audioSound->frameCount;
+        phase += hz / AUDIO_SAMPLE_RATE;
+        phase -= floorf(phase);
+        envelope = expf(-decay * frame / AUDIO_SAMPLE_RATE);
+        if (frame < AUDIO_SAMPLE_RATE / 500)
+            envelope *= (float)frame / (AUDIO_SAMPLE_RATE / 500);
+        if (square)
+            value = (phase < 0.5f) ? 0.5f : -0.5f;
+        else
+            value = sinf(phase * 2.0f * 3.14159265f) * 0.7f;
+        audioSound->samples[frame] = (int16_t)(value * envelope * AUDIO_VOLUME_FULL);
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioMix
+    Mix any number of frames, a block at a time, and hand them to the sink.
+    Used when the mixer is driven by the game rather than by a device.
+    Returns false if the sink has failed, now or before; nothing more is
+    mixed after that.
+ ----------------------------------------------------------------------------*/
+bool AudioMix(struct audio_mixer *mixer, int frameCount)
+{
+    int frames;
+
+    for (; frameCount > 0; frameCount -= frames) {
+        frames = (frameCount < AUDIO_BLOCK_FRAMES) ? frameCount : AUDIO_BLOCK_FRAMES;
+        if (!AudioMixBlock(mixer, frames))
+            return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioMixBlock
+    Start the sounds asked for since the last block, mix up to a block of
+    frames from every playing voice and hand them to the sink. Voices are
+    summed in 32 bits and saturated once at the end. A sound asked for
+    while every voice is busy is dropped. Returns false, and closes the
+    queue so the game plays no more sounds, if the sink cannot take the
+    block or failed before.
+ ----------------------------------------------------------------------------*/
+bool AudioMixBlock(struct audio_mixer *mixer, int frameCount)
+{
+    struct audio_queue *audioQueue = &mixer->queue;
+    struct audio_voice *voice;
+    const struct audio_sound *audioSound;
+    uint32_t readIndex = audioQueue->readIndex;
+    uint32_t writeIndex = AtomicLoadAcquire(&audioQueue->writeIndex);
+    int count, frame = 0;
+    int32_t sample;
+
+    if (AtomicLoadAcquire(&audioQueue->closed))
+        return false;
+
+    for (; readIndex != writeIndex; readIndex++) {
+        if (mixer->voiceCount == AUDIO_VOICES_MAX)
+            continue;
+        voice = &mixer->voices[mixer->voiceCount++];
+        voice->sound = audioQueue->commands[readIndex & AUDIO_QUEUE_MASK].sound % NUM_SOUNDS;
+        voice->volume = audioQueue->commands[readIndex & AUDIO_QUEUE_MASK].volume;
+        voice->position = 0;
+    }
+    AtomicStoreRelease(&audioQueue->readIndex, readIndex);
+
+    memset(mixer->accumulator, 0, frameCount * sizeof(int32_t));
+    for (int voiceIndex = 0; voiceIndex < mixer->voiceCount; voiceIndex++) {
+        voice = &mixer->voices[voiceIndex];
+        audioSound = &mixer->sounds[voice->sound];
+        count = audioSound->frameCount - voice->position;
+        if (count > frameCount)
+            count = frameCount;
+        AudioMixVoice(mixer->accumulator, &audioSound->samples[voice->position], count, voice->volume);
+        voice->position += count;
+        if (voice->position == audioSound->frameCount)
+            mixer->voices[voiceIndex--] = mixer->voices[--mixer->voiceCount];
+    }
+
+#if defined(AUDIO_SSE2)
+    for (; frame + 8 <= frameCount; frame += 8)
+        _mm_storeu_si128((__m128i *)&mixer->block[frame], _mm_packs_epi32(
+            _mm_loadu_si128((const __m128i *)&mixer->accumulator[frame]),
+            _mm_loadu_si128((const __m128i *)&mixer->accumulator[frame + 4])));
+#elif defined(AUDIO_NEON)
+    for (; frame + 8 <= frameCount; frame += 8)
+        vst1q_s16(&mixer->block[frame], vcombine_s16(
+            vqmovn_s32(vld1q_s32(&mixer->accumulator[frame])),
+            vqmovn_s32(vld1q_s32(&mixer->accumulator[frame + 4]))));
+#endif
+    for (; frame < frameCount; frame++) {
+        sample = mixer->accumulator[frame];
+        sample = (sample > INT16_MAX) ? INT16_MAX : (sample < INT16_MIN) ? INT16_MIN : sample;
+        mixer->block[frame] = (int16_t)sample;
+    }
+
+    if (!mixer->sink->write(mixer->sink, mixer->block, frameCount)) {
+        AtomicStoreRelease(&audioQueue->closed, 1);
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioMixVoice
+    Add samples scaled by a volume out of AUDIO_VOLUME_FULL to a 32 bit
+    accumulator, eight at a time with SSE2 or NEON.
+ ----------------------------------------------------------------------------*/
+void AudioMixVoice(int32_t *accumulator, const int16_t *samples, int count, int volume)
+{
+    int frame = 0;
+
+#if defined(AUDIO_SSE2)
+    __m128i gain = _mm_set1_epi16((int16_t)volume);
+    __m128i source, low, high;
+
+    for (; frame + 8 <= count; frame += 8) {
+        source = _mm_loadu_si128((const __m128i *)&samples[frame]);
+        low = _mm_mullo_epi16(source, gain);
+        high = _mm_mulhi_epi16(source, gain);
+        _mm_storeu_si128((__m128i *)&accumulator[frame], _mm_add_epi32(
+            _mm_loadu_si128((const __m128i *)&accumulator[frame]),
+            _mm_srai_epi32(_mm_unpacklo_epi16(low, high), 15)));
+        _mm_storeu_si128((__m128i *)&accumulator[frame + 4], _mm_add_epi32(
+            _mm_loadu_si128((const __m128i *)&accumulator[frame + 4]),
+            _mm_srai_epi32(_mm_unpackhi_epi16(low, high), 15)));
+    }
+#elif defined(AUDIO_NEON)
+    int16x8_t source;
+
+    for (; frame + 8 <= count; frame += 8) {
+        source = vld1q_s16(&samples[frame]);
+        vst1q_s32(&accumulator[frame], vaddq_s32(vld1q_s32(&accumulator[frame]),
+            vshrq_n_s32(vmull_n_s16(vget_low_s16(source), (int16_t)volume), 15)));
+        vst1q_s32(&accumulator[frame + 4], vaddq_s32(vld1q_s32(&accumulator[frame + 4]),
+            vshrq_n_s32(vmull_n_s16(vget_high_s16(source), (int16_t)volume), 15)));
+    }
+#endif
+
+    for (; frame < count; frame++)
+        accumulator[frame] += (samples[frame] * volume) >> 15;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioMixerStart
+    Mix on a thread of its own, for a sink that paces it.
+ ----------------------------------------------------------------------------*/
+void AudioMixerStart(struct audio_mixer *mixer)
+{
+    mixer->quit = 0;
+#ifdef _WIN32
+    mixer->thread = CreateThread(NULL, 0, AudioMixerThread, mixer, 0, NULL);
+    SetThreadPriority(mixer->thread, THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    pthread_create(&mixer->thread, NULL, AudioMixerThread, mixer);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioMixerStop
+    Stop the mixer thread after the block it is on.
+ ----------------------------------------------------------------------------*/
+void AudioMixerStop(struct audio_mixer *mixer)
+{
+    AtomicStoreRelease(&mixer->quit, 1);
+#ifdef _WIN32
+    WaitForSingleObject(mixer->thread, INFINITE);
+    CloseHandle(mixer->thread);
+#else
+    pthread_join(mixer->thread, NULL);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioMixerThread
+    Mix block after block until told to stop, or until the sink fails.
+ ----------------------------------------------------------------------------*/
+#ifdef _WIN32
+DWORD WINAPI AudioMixerThread(LPVOID parameter)
+#else
+void *AudioMixerThread(void *parameter)
+#endif
+{
+    struct audio_mixer *mixer = parameter;
+
+    while (!AtomicLoadAcquire(&mixer->quit)) {
+        if (!AudioMixBlock(mixer, AUDIO_BLOCK_FRAMES))
+            break;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioSinkNullOpen
+    Make a sink that throws the samples away.
+ ----------------------------------------------------------------------------*/
+void AudioSinkNullOpen(struct audio_sink *sink)
+{
+    sink->context = NULL;
+    sink->write = AudioSinkNullWrite;
+    sink->close = AudioSinkNullClose;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioSinkNullWrite
+    Throw samples away.
+ ----------------------------------------------------------------------------*/
+bool AudioSinkNullWrite(struct audio_sink *sink, const int16_t *samples, int frameCount)
+{
+    (void)sink;
+    (void)samples;
+    (void)frameCount;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioSinkNullClose
+    Close a null sink.
+ ----------------------------------------------------------------------------*/
+void AudioSinkNullClose(struct audio_sink *sink)
+{
+    (void)sink;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioSinkWavOpen
+    Make a sink that writes a mono 16 bit WAV file. The header is written
+    again with the final size when the sink is closed. Returns false if the
+    file cannot be created.
+ ----------------------------------------------------------------------------*/
+bool AudioSinkWavOpen(struct audio_sink *sink, struct audio_wav_sink *wav, const char *path)
+{
+    uint8_t header[44];
+
+    wav->file = fopen(path, "wb");
+    if (!wav->file)
+        return false;
+    wav->dataSize = 0;
+    AudioWavHeader(header, 0);
+    fwrite(header, sizeof(header), 1, wav->file);
+
+    sink->context = wav;
+    sink->write = AudioSinkWavWrite;
+    sink->close = AudioSinkWavClose;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioSinkWavWrite
+    Append samples to a WAV file. Samples are little endian in the file, as
+    they are in memory on every platform the game runs on.
+ ----------------------------------------------------------------------------*/
+bool AudioSinkWavWrite(struct audio_sink *sink, const int16_t *samples, int frameCount)
+{
+    struct audio_wav_sink *wav = sink->context;
+
+    if (fwrite(samples, sizeof(int16_t), frameCount, wav->file) != (size_t)frameCount)
+        return false;
+    wav->dataSize += frameCount * sizeof(int16_t);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioSinkWavClose
+    Write the final header and close a WAV file.
+ ----------------------------------------------------------------------------*/
+void AudioSinkWavClose(struct audio_sink *sink)
+{
+    struct audio_wav_sink *wav = sink->context;
+    uint8_t header[44];
+
+    AudioWavHeader(header, wav->dataSize);
+    fseek(wav->file, 0, SEEK_SET);
+    fwrite(header, sizeof(header), 1, wav->file);
+    fclose(wav->file);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AudioWavHeader
+    Fill in the 44 byte header of a mono 16 bit PCM WAV file.
+ ----------------------------------------------------------------------------*/
+void AudioWavHeader(uint8_t *header, uint32_t dataSize)
+{
+    uint32_t fields[] = {
+        36 + dataSize,                       /* RIFF chunk size */
+        16,                                  /* fmt chunk size */
+        1 | (1 << 16),                       /* PCM, one channel */
+        AUDIO_SAMPLE_RATE,
+        AUDIO_SAMPLE_RATE * sizeof(int16_t), /* bytes per second */
+        sizeof(int16_t) | (16 << 16),        /* block align, bits per sample */
+        dataSize
+    };
+    int offsets[] = { 4, 16, 20, 24, 28, 32, 40 };
+
+    memcpy(header, "RIFF----WAVEfmt ", 16);
+    memcpy(header + 36, "data", 4);
+    for (int field = 0; field < 7; field++)
+        for (int byte = 0; byte < 4; byte++)
+            header[offsets[field] + byte] = (uint8_t)(fields[field] >> (byte * 8));
+
+    return;
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+/*=============================================================================
+    audio.h
+ =============================================================================*/
+
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+#include <stdio.h>
+
+#include "atomic.h"
+
+#define AUDIO_SAMPLE_RATE 48000
+/* 4ms of mono samples. */
+#define AUDIO_BLOCK_FRAMES 192
+#define AUDIO_VOICES_MAX 16
+#define AUDIO_SOUND_FRAMES_MAX (AUDIO_SAMPLE_RATE / 2)
+#define AUDIO_VOLUME_FULL 32767
+
+/* Must be a power of two so the free running indices can be masked. */
+#define AUDIO_QUEUE_SIZE 64
+#define AUDIO_QUEUE_MASK (AUDIO_QUEUE_SIZE - 1)
+
+enum sound_ids {
+    SOUND_PADDLE,
+    SOUND_BRICK,
+    SOUND_LIFE_LOST,
+    SOUND_COUNTDOWN,
+    NUM_SOUNDS
+};
+
+struct audio_command {
+    uint8_t sound;
+    int16_t volume;
+};
+
+/* Single producer (GameUpdate), single consumer (the mixer), in the same
+   way as the input queue. Sounds played while it is full are dropped, so
+   the game never waits on audio. The mixer closes the queue when its sink
+   fails, and the game is silent from then on. */
+struct audio_queue {
+    struct audio_command commands[AUDIO_QUEUE_SIZE];
+    volatile uint32_t writeIndex;
+    volatile uint32_t readIndex;
+    volatile uint32_t closed;
+};
+
+/* Mono 16 bit samples, decoded before the game starts. */
+struct audio_sound {
+    int frameCount;
+    int16_t samples[AUDIO_SOUND_FRAMES_MAX];
+};
+
+struct audio_voice {
+    int sound;
+    int position;
+    int16_t volume;
+};
+
+/* Where mixed blocks go. A device sink blocks in write until it has room,
+   which paces the mixer thread; file and null sinks return at once and
+   are mixed on demand instead. */
+struct audio_sink {
+    void *context;
+    bool (*write)(struct audio_sink *, const int16_t *, int);
+    void (*close)(struct audio_sink *);
+};
+
+struct audio_wav_sink {
+    FILE *file;
+    uint32_t dataSize;
+};
+
+struct audio_mixer {
+    struct audio_queue queue;
+    struct audio_sound sounds[NUM_SOUNDS];
+    struct audio_voice voices[AUDIO_VOICES_MAX];
+    int voiceCount;
+    struct audio_sink *sink;
+    int32_t accumulator[AUDIO_BLOCK_FRAMES];
+    int16_t block[AUDIO_BLOCK_FRAMES];
+    volatile uint32_t quit;
+#ifdef _WIN32
+    HANDLE thread;
+#else
+    pthread_t thread;
+#endif
+};
+
+void AudioQueueInit(struct audio_queue *);
+bool AudioPlay(struct audio_queue *, int, int);
+void AudioMixerInit(struct audio_mixer *, struct audio_sink *);
+void AudioSoundInit(struct audio_sound *, int);
+bool AudioMix(struct audio_mixer *, int);
+bool AudioMixBlock(struct audio_mixer *, int);
+void AudioMixVoice(int32_t *, const int16_t *, int, int);
+void AudioMixerStart(struct audio_mixer *);
+void AudioMixerStop(struct audio_mixer *);
+#ifdef _WIN32
+DWORD WINAPI AudioMixerThread(LPVOID);
+#else
+void *AudioMixerThread(void *);
+#endif
+void AudioSinkNullOpen(struct audio_sink *);
+bool AudioSinkNullWrite(struct audio_sink *, const int16_t *, int);
+void AudioSinkNullClose(struct audio_sink *);
+bool AudioSinkWavOpen(struct audio_sink *, struct audio_wav_sink *, const char *);
+bool AudioSinkWavWrite(struct audio_sink *, const int16_t *, int);
+void AudioSinkWavClose(struct audio_sink *);
+void AudioWavHeader(uint8_t *, uint32_t);
+
+#endif /* AUDIO_H */
\ No newline at end of file
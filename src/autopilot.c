@@ -0,0 +1,227 @@
+/*=============================================================================
+    autopilot.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "game.h"
+#include "simulate.h"
+#include "autopilot.h"
+#include "bricks.h"
+
+/*-----------------------------------------------------------------------------
+    BallPredictLanding
+    Predict where the ball will next reach the top of the paddle, without
+    stepping the game. The ball is followed in closed form from one bounce
+    to the next: off the side and top walls, and off the live bricks in
+    view, which are assumed to break if they have a single hit point left
+    and to stay where they are on the screen. Returns false if the ball
+    does not come down within PREDICT_BOUNCES_MAX bounces.
+ ----------------------------------------------------------------------------*/
+bool BallPredictLanding(struct game_state *gameState, struct ball_prediction *prediction)
+{
+    struct rectangle rectBall = gameState->ball.rect;
+    struct vector_2d velocity = gameState->ball.velocity;
+    const struct brick_set *brickSet = &gameState->bricks;
+    const struct brick_vars *brick;
+    float cameraY = gameState->cameraY;
+    int brickFirst = 0, brickEnd = 0, rowFirst, rowLast;
+    int bricksHit[PREDICT_BOUNCES_MAX];
+    int brickNext;
+    float paddleTop, seconds, secondsNext, enterX, exitX, enterY, exitY, enter, exit;
+    bool brickNextLeftRight = false;
+    bool brickKnownBroken;
+    enum { wallLeftRight, wallTop, landing, brickFace } eventNext;
+    int bricksHitCount = 0;
+
+    paddleTop = gameState->paddle.rect.position.y + gameState->paddle.rect.height;
+    seconds = 0.0f;
+    prediction->valid = false;
+    if (BrickRowsOverlapping(brickSet, cameraY, cameraY + QVGA_HEIGHT, &rowFirst, &rowLast)) {
+        brickFirst = rowFirst * brickSet->base->columns;
+        brickEnd = (rowLast + 1) * brickSet->base->columns;
+    }
+
+    for (prediction->bounces = 0; prediction->bounces < PREDICT_BOUNCES_MAX; prediction->bounces++) {
+        if (rectBall.position.y <= paddleTop && velocity.y <= 0.0f) {
+            prediction->valid = true;
+            prediction->landingX = rectBall.position.x;
+            prediction->secondsToLanding = seconds;
+            return true;
+        }
+
+        /* Walls and the paddle plane. */
+        secondsNext = SIMULATE_NEVER;
+        eventNext = landing;
+        brickNext = -1;
+        if (velocity.x > 0.0f) {
+            secondsNext = ((QVGA_WIDTH - BALL_WIDTH) - rectBall.position.x) / velocity.x;
+            eventNext = wallLeftRight;
+        }
+        else if (velocity.x < 0.0f) {
+            secondsNext = rectBall.position.x / -velocity.x;
+            eventNext = wallLeftRight;
+        }
+        if (velocity.y > 0.0f && ((QVGA_HEIGHT - BALL_HEIGHT) - rectBall.position.y) / velocity.y < secondsNext) {
+            secondsNext = ((QVGA_HEIGHT - BALL_HEIGHT) - rectBall.position.y) / velocity.y;
+            eventNext = wallTop;
+        }
+        else if (velocity.y < 0.0f && (rectBall.position.y - paddleTop) / -velocity.y < secondsNext) {
+            secondsNext = (rectBall.position.y - paddleTop) / -velocity.y;
+            eventNext = landing;
+        }
+
+        /* Bricks. */
+        for (int brickIndex = brickFirst; brickIndex < brickEnd; brickIndex++) {
+            if (BrickIsBroken(brickSet, brickIndex))
+                continue;
+            brickKnownBroken = false;
+            for (int hit = 0; hit < bricksHitCount; hit++)
+                brickKnownBroken |= (bricksHit[hit] == brickIndex);
+            if (brickKnownBroken)
+                continue;
+            brick = &brickSet->base->bricks[brickIndex];
+            enterX = SweepAxis(
+                brick->rect.position.x - rectBall.width - rectBall.position.x,
+                brick->rect.position.x + brick->rect.width - rectBall.position.x,
+                velocity.x, &exitX);
+            enterY = SweepAxis(
+                (brick->rect.position.y - cameraY) - rectBall.height - rectBall.position.y,
+                (brick->rect.position.y - cameraY) + brick->rect.height - rectBall.position.y,
+                velocity.y, &exitY);
+            enter = CalcMax(enterX, enterY);
+            exit = CalcMin(exitX, exitY);
+            /* A brick the ball is already touching was just bounced off. */
+            if (enter > exit || enter <= 0.0f || enter >= secondsNext)
+                continue;
+            secondsNext = enter;
+            eventNext = brickFace;
+            brickNext = brickIndex;
+            brickNextLeftRight = enterX > enterY;
+        }
+
+        if (secondsNext >= SIMULATE_NEVER)
+            return false;
+
+        rectBall.position.x += velocity.x * secondsNext;
+        rectBall.position.y += velocity.y * secondsNext;
+        seconds += secondsNext;
+
+        switch (eventNext) {
+        case wallLeftRight:
+            velocity.x *= -1;
+            break;
+        case wallTop:
+            velocity.y *= -1;
+            break;
+        case landing:
+            rectBall.position.y = paddleTop;
+            break;
+        case brickFace:
+            if (brickNextLeftRight)
+                velocity.x *= -1;
+            else
+                velocity.y *= -1;
+            if (brickSet->base->bricks[brickNext].type != BRICK_TYPE_SOLID && BrickHitPoints(brickSet, brickNext) <= 1)
+                bricksHit[bricksHitCount++] = brickNext;
+            break;
+        }
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------------------------
+    AutopilotInit
+    Initialize the autopilot, switched off.
+ ----------------------------------------------------------------------------*/
+void AutopilotInit(struct autopilot *autopilot)
+{
+    autopilot->enabled = false;
+    for (int key = 0; key < NUM_KEYS; key++)
+        autopilot->keyboard[key] = false;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AutopilotToggle
+    Switch the autopilot on or off. Keys it holds are released when it is
+    switched off.
+ ----------------------------------------------------------------------------*/
+void AutopilotToggle(struct autopilot *autopilot, struct game_state *gameState, struct input_queue *inputQueue, uint64_t timestampUs)
+{
+    autopilot->enabled = !autopilot->enabled;
+
+    if (!autopilot->enabled) {
+        AutopilotSetKey(autopilot, gameState, inputQueue, timestampUs, GAME_KEY_LEFT, false);
+        AutopilotSetKey(autopilot, gameState, inputQueue, timestampUs, GAME_KEY_RIGHT, false);
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    AutopilotUpdate
+    Steer the paddle under the predicted landing point of the ball by
+    pressing and releasing the same keys a player would. Returns the number
+    of ticks (of the given length) after which it should be called again.
+ ----------------------------------------------------------------------------*/
+int AutopilotUpdate(struct autopilot *autopilot, struct game_state *gameState, struct input_queue *inputQueue, uint64_t timestampUs, float deltaTimeMs)
+{
+    struct ball_prediction prediction;
+    float targetX, distance, pixelsPerTick;
+    int ticks;
+
+    if (!autopilot->enabled)
+        return AUTOPILOT_DECISION_TICKS;
+
+    /* Center the paddle under the ball. Without a prediction, follow it. */
+    if (BallPredictLanding(gameState, &prediction))
+        targetX = prediction.landingX;
+    else
+        targetX = gameState->ball.rect.position.x;
+    targetX += (BALL_WIDTH - gameState->rules->paddleWidth) / 2;
+    targetX = ClampMin(targetX, 0.0f);
+    targetX = ClampMax(targetX, (QVGA_WIDTH - gameState->rules->paddleWidth));
+
+    distance = targetX - gameState->paddle.rect.position.x;
+    pixelsPerTick = gameState->rules->paddleSpeed * deltaTimeMs / (float)MS_PER_SECOND;
+
+    if (fabsf(distance) < pixelsPerTick) {
+        AutopilotSetKey(autopilot, gameState, inputQueue, timestampUs, GAME_KEY_LEFT, false);
+        AutopilotSetKey(autopilot, gameState, inputQueue, timestampUs, GAME_KEY_RIGHT, false);
+        return AUTOPILOT_DECISION_TICKS;
+    }
+
+    AutopilotSetKey(autopilot, gameState, inputQueue, timestampUs, GAME_KEY_LEFT, distance < 0.0f);
+    AutopilotSetKey(autopilot, gameState, inputQueue, timestampUs, GAME_KEY_RIGHT, distance > 0.0f);
+
+    /* Look again when the paddle arrives, or sooner. */
+    ticks = (int)(fabsf(distance) / pixelsPerTick);
+    if (ticks < 1)
+        ticks = 1;
+
+    return (ticks < AUTOPILOT_DECISION_TICKS) ? ticks : AUTOPILOT_DECISION_TICKS;
+}
+
+/*-----------------------------------------------------------------------------
+    AutopilotSetKey
+    Press or release a key if it changed. Keys go through the input queue
+    when there is one, or straight into the game state otherwise.
+ ----------------------------------------------------------------------------*/
+void AutopilotSetKey(struct autopilot *autopilot, struct game_state *gameState, struct input_queue *inputQueue, uint64_t timestampUs, int key, bool keyIsDown)
+{
+    if (autopilot->keyboard[key] == keyIsDown)
+        return;
+
+    autopilot->keyboard[key] = keyIsDown;
+    if (inputQueue)
+        GameKeyboardUpdate(inputQueue, key, keyIsDown, timestampUs);
+    else
+        GameApplyKey(gameState, key, keyIsDown);
+
+    return;
+}
\ No newline at end of file
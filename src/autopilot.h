@@ -0,0 +1,29 @@
+/*=============================================================================
+    autopilot.h
+ =============================================================================*/
+
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#define PREDICT_BOUNCES_MAX 16
+#define AUTOPILOT_DECISION_TICKS 6
+
+struct ball_prediction {
+    bool valid;
+    float landingX;
+    float secondsToLanding;
+    int bounces;
+};
+
+struct autopilot {
+    bool enabled;
+    bool keyboard[NUM_KEYS];
+};
+
+bool BallPredictLanding(struct game_state *, struct ball_prediction *);
+void AutopilotInit(struct autopilot *);
+void AutopilotToggle(struct autopilot *, struct game_state *, struct input_queue *, uint64_t);
+int AutopilotUpdate(struct autopilot *, struct game_state *, struct input_queue *, uint64_t, float);
+void AutopilotSetKey(struct autopilot *, struct game_state *, struct input_queue *, uint64_t, int, bool);
+
+#endif /* AUTOPILOT_H */
\ No newline at end of file
@@ -0,0 +1,238 @@
+/*=============================================================================
+    bricks.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "game.h"
+#include "bricks.h"
+
+/*-----------------------------------------------------------------------------
+    BrickSetInit
+    Give a game state its own brick storage, with room for a number of
+    bricks. This is done once for the game the player sees; clones share
+    its storage instead.
+ ----------------------------------------------------------------------------*/
+void BrickSetInit(struct brick_set *brickSet, void *memory, int capacity)
+{
+    brickSet->base = memory;
+    brickSet->base->refCount = 1;
+    brickSet->base->capacity = capacity;
+    brickSet->base->rows = 0;
+    brickSet->base->columns = 0;
+    brickSet->arena = NULL;
+    brickSet->changeCount = 0;
+    brickSet->changeMask = 0;
+    brickSet->outOfMemory = false;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    BrickSetLayout
+    Get a base to lay out a new grid of bricks in. The current base is
+    reused if nothing else refers to it, otherwise a new one is allocated
+    from the arena. Returns the base; its bricks must all be filled in.
+    Returns NULL, and marks the set out of memory, if the set has no arena
+    or it is full; the set keeps its old grid.
+ ----------------------------------------------------------------------------*/
+struct brick_base *BrickSetLayout(struct brick_set *brickSet, int rows, int columns)
+{
+    struct brick_base *base = brickSet->base;
+    int capacity = rows * columns;
+
+    if (AtomicLoadAcquire(&base->refCount) != 1 || base->capacity < capacity) {
+        base = brickSet->arena ? ArenaPush(brickSet->arena, BrickBaseSize(capacity)) : NULL;
+        if (!base) {
+            brickSet->outOfMemory = true;
+            return NULL;
+        }
+        base->refCount = 1;
+        base->capacity = capacity;
+        AtomicAdd(&brickSet->base->refCount, (uint32_t)-1);
+        brickSet->base = base;
+    }
+
+    base->rows = rows;
+    base->columns = columns;
+    brickSet->changeCount = 0;
+    brickSet->changeMask = 0;
+
+    return base;
+}
+
+/*-----------------------------------------------------------------------------
+    BrickHitPoints
+    Returns the hit points a brick has left. The mask tells which bricks
+    may have a change, so most bricks are read straight from the base.
+ ----------------------------------------------------------------------------*/
+int BrickHitPoints(const struct brick_set *brickSet, int index)
+{
+    if (brickSet->changeMask & ((uint64_t)1 << (index & 63))) {
+        for (int change = 0; change < brickSet->changeCount; change++) {
+            if (brickSet->changes[change].index == index)
+                return brickSet->changes[change].hitPoints;
+        }
+    }
+
+    return brickSet->base->bricks[index].hitPoints;
+}
+
+/*-----------------------------------------------------------------------------
+    BrickIsBroken
+    Returns true if a brick has no hit points left.
+ ----------------------------------------------------------------------------*/
+bool BrickIsBroken(const struct brick_set *brickSet, int index)
+{
+    return BrickHitPoints(brickSet, index) <= 0;
+}
+
+/*-----------------------------------------------------------------------------
+    BrickRowsOverlapping
+    Find the rows of bricks that overlap a band of world heights, with a
+    row to spare at each end so a ball touching a row's edge is never
+    missed. Only those rows need to be visited, however tall the level is.
+    Returns false if there are no such rows.
+ ----------------------------------------------------------------------------*/
+bool BrickRowsOverlapping(const struct brick_set *brickSet, float bottom, float top, int *rowFirst, int *rowLast)
+{
+    const struct brick_base *base = brickSet->base;
+    float gridBottom, brickHeight;
+
+    if (base->rows == 0)
+        return false;
+
+    gridBottom = base->bricks[0].rect.position.y;
+    brickHeight = (float)base->bricks[0].rect.height;
+    *rowFirst = (int)floorf((bottom - gridBottom) / brickHeight) - 1;
+    *rowLast = (int)floorf((top - gridBottom) / brickHeight) + 1;
+    if (*rowFirst < 0)
+        *rowFirst = 0;
+    if (*rowLast > base->rows - 1)
+        *rowLast = base->rows - 1;
+
+    return *rowFirst <= *rowLast;
+}
+
+/*-----------------------------------------------------------------------------
+    BrickSetHitPoints
+    Change the hit points of a brick. A base nothing else refers to is
+    written in place; a shared one is left alone and the change is recorded
+    in the set, which is flattened into a base of its own when it fills up.
+    Returns false, and marks the set out of memory, if the change was lost
+    because there was no arena, or no room in it, for the flattened base.
+ ----------------------------------------------------------------------------*/
+bool BrickSetHitPoints(struct brick_set *brickSet, int index, int hitPoints)
+{
+    for (int change = 0; change < brickSet->changeCount; change++) {
+        if (brickSet->changes[change].index == index) {
+            brickSet->changes[change].hitPoints = (int16_t)hitPoints;
+            return true;
+        }
+    }
+
+    if (AtomicLoadAcquire(&brickSet->base->refCount) != 1) {
+        if (brickSet->changeCount < BRICK_CHANGES_MAX) {
+            brickSet->changes[brickSet->changeCount].index = (uint16_t)index;
+            brickSet->changes[brickSet->changeCount].hitPoints = (int16_t)hitPoints;
+            brickSet->changeCount++;
+            brickSet->changeMask |= (uint64_t)1 << (index & 63);
+            return true;
+        }
+        if (!BrickSetFlatten(brickSet))
+            return false;
+    }
+
+    brickSet->base->bricks[index].hitPoints = hitPoints;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    BrickSetFlatten
+    Copy the shared base into the arena and apply the recorded changes to
+    the copy, which then belongs to this set alone. Returns false, and
+    marks the set out of memory, if the set has no arena or it is full;
+    the set is left as it was.
+ ----------------------------------------------------------------------------*/
+bool BrickSetFlatten(struct brick_set *brickSet)
+{
+    struct brick_base *shared = brickSet->base;
+    struct brick_base *base;
+    int capacity = shared->rows * shared->columns;
+
+    base = brickSet->arena ? ArenaPush(brickSet->arena, BrickBaseSize(capacity)) : NULL;
+    if (!base) {
+        brickSet->outOfMemory = true;
+        return false;
+    }
+    memcpy(base->bricks, shared->bricks, capacity * sizeof(struct brick_vars));
+    base->refCount = 1;
+    base->capacity = capacity;
+    base->rows = shared->rows;
+    base->columns = shared->columns;
+
+    for (int change = 0; change < brickSet->changeCount; change++)
+        base->bricks[brickSet->changes[change].index].hitPoints = brickSet->changes[change].hitPoints;
+
+    brickSet->base = base;
+    brickSet->changeCount = 0;
+    brickSet->changeMask = 0;
+    AtomicAdd(&shared->refCount, (uint32_t)-1);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    GameClone
+    Make a copy of a game state for a search to step on its own. Only the
+    small per game fields are copied; the bricks are shared until the clone
+    changes them, and anything it allocates comes from the given arena.
+    Clones emit no particles or sounds and count nothing. The
+    source must not be updated while its clones are in use; a game made
+    with BrickSetInit has no arena, so one that changes shared bricks is
+    marked out of memory. A clone that runs its arena out of room is marked out of memory and has gone wrong
+    from then on; the search should drop it, or end and start again with
+    more room.
+ ----------------------------------------------------------------------------*/
+void GameClone(struct game_state *clone, const struct game_state *source, struct memory_arena *arena)
+{
+    *clone = *source;
+    clone->bricks.arena = arena;
+    clone->particles = NULL;
+    clone->audio = NULL;
+    clone->telemetry = NULL;
+    AtomicAdd(&clone->bricks.base->refCount, 1);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    GameCloneRelease
+    Drop a clone before the search ends, so the states it shared bricks
+    with can write them in place again.
+ ----------------------------------------------------------------------------*/
+void GameCloneRelease(struct game_state *clone)
+{
+    AtomicAdd(&clone->bricks.base->refCount, (uint32_t)-1);
+    clone->bricks.base = NULL;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    GameSearchEnd
+    Free every clone made for a search, and everything they allocated, by
+    resetting the arena. The game the search started from owns its bricks
+    again afterwards.
+ ----------------------------------------------------------------------------*/
+void GameSearchEnd(struct game_state *root, struct memory_arena *arena)
+{
+    ArenaReset(arena);
+    AtomicStoreRelease(&root->bricks.base->refCount, 1);
+
+    return;
+}
\ No newline at end of file
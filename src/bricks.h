@@ -0,0 +1,19 @@
+/*=============================================================================
+    bricks.h
+ =============================================================================*/
+
+#ifndef BRICKS_H
+#define BRICKS_H
+
+void BrickSetInit(struct brick_set *, void *, int);
+struct brick_base *BrickSetLayout(struct brick_set *, int, int);
+int BrickHitPoints(const struct brick_set *, int);
+bool BrickIsBroken(const struct brick_set *, int);
+bool BrickRowsOverlapping(const struct brick_set *, float, float, int *, int *);
+bool BrickSetHitPoints(struct brick_set *, int, int);
+bool BrickSetFlatten(struct brick_set *);
+void GameClone(struct game_state *, const struct game_state *, struct memory_arena *);
+void GameCloneRelease(struct game_state *);
+void GameSearchEnd(struct game_state *, struct memory_arena *);
+
+#endif /* BRICKS_H */
\ No newline at end of file
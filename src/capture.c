@@ -0,0 +1,442 @@
+/*=============================================================================
+    capture.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+#include "game.h"
+#include "memory.h"
+#include "capture.h"
+
+/*-----------------------------------------------------------------------------
+    CaptureOpen
+    Start capturing frames of the given size: PNG stills if the path ends
+    in .png, or a Y4M video at a frame rate if it ends in .y4m. The
+    capture's buffers, of CaptureMemorySize, come from an arena. Starts the
+    capture thread. Returns false if the path is of neither kind or the
+    video cannot be created.
+ ----------------------------------------------------------------------------*/
+bool CaptureOpen(struct capture *capture, const char *path, int width, int height, int framesPerSecond, struct memory_arena *arena)
+{
+    const char *extension = strrchr(path, '.');
+    int pathLength = (int)strlen(path);
+    uint32_t crc;
+
+    memset(capture, 0, sizeof(*capture));
+    capture->width = width;
+    capture->height = height;
+    capture->frameSize = width * height * CAPTURE_BYTES_PER_PIXEL;
+
+    /* Room is left for the frame number added to still names. */
+    if (!extension || pathLength + 16 > CAPTURE_PATH_MAX)
+        return false;
+    if (strcmp(extension, ".png") == 0)
+        capture->format = CAPTURE_PNG;
+    else if (strcmp(extension, ".y4m") == 0)
+        capture->format = CAPTURE_Y4M;
+    else
+        return false;
+    memcpy(capture->path, path, pathLength + 1);
+    capture->pathStem = (int)(extension - path);
+
+    if (capture->format == CAPTURE_Y4M) {
+        capture->file = fopen(path, "wb");
+        if (!capture->file)
+            return false;
+        if (fprintf(capture->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, framesPerSecond) < 0)
+            capture->failed = true;
+    }
+
+    /* Slots are touched now, so their pages are not first faulted in by
+       the game thread. */
+    for (int slot = 0; slot < CAPTURE_SLOTS; slot++) {
+        capture->slots[slot] = ArenaPush(arena, capture->frameSize);
+        memset(capture->slots[slot], 0, capture->frameSize);
+    }
+    capture->raw = ArenaPush(arena, (size_t)height * (1 + width * 3));
+    capture->encoded = ArenaPush(arena, (capture->format == CAPTURE_PNG)
+        ? (size_t)CapturePngSizeMax(width, height)
+        : (size_t)CAPTURE_Y4M_FRAME_HEADER_SIZE + (size_t)width * height * 3);
+
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        crc = byte;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+        capture->crcTable[byte] = crc;
+    }
+
+#ifdef _WIN32
+    InitializeSRWLock(&capture->lock);
+    InitializeConditionVariable(&capture->wake);
+    capture->thread = CreateThread(NULL, 0, CaptureThread, capture, 0, NULL);
+#else
+    pthread_mutex_init(&capture->lock, NULL);
+    pthread_cond_init(&capture->wake, NULL);
+    pthread_create(&capture->thread, NULL, CaptureThread, capture);
+#endif
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureMemorySize
+    Returns the memory a capture needs from its arena for frames of the
+    given size, in either format.
+ ----------------------------------------------------------------------------*/
+size_t CaptureMemorySize(int width, int height)
+{
+    size_t frameSize = (size_t)width * height * CAPTURE_BYTES_PER_PIXEL;
+    size_t rawSize = (size_t)height * (1 + width * 3);
+    size_t videoFrameSize = CAPTURE_Y4M_FRAME_HEADER_SIZE + (size_t)width * height * 3;
+    size_t pngSize = (size_t)CapturePngSizeMax(width, height);
+
+    return CAPTURE_SLOTS * ARENA_SIZE(frameSize) + ARENA_SIZE(rawSize)
+        + ARENA_SIZE((pngSize > videoFrameSize) ? pngSize : videoFrameSize);
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureClose
+    Encode and write the frames still queued, then stop the capture thread
+    and close the video.
+ ----------------------------------------------------------------------------*/
+void CaptureClose(struct capture *capture)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&capture->lock);
+    capture->quit = 1;
+    WakeConditionVariable(&capture->wake);
+    ReleaseSRWLockExclusive(&capture->lock);
+    WaitForSingleObject(capture->thread, INFINITE);
+    CloseHandle(capture->thread);
+#else
+    pthread_mutex_lock(&capture->lock);
+    capture->quit = 1;
+    pthread_cond_signal(&capture->wake);
+    pthread_mutex_unlock(&capture->lock);
+    pthread_join(capture->thread, NULL);
+    pthread_mutex_destroy(&capture->lock);
+    pthread_cond_destroy(&capture->wake);
+#endif
+
+    if (capture->file && fclose(capture->file) != 0)
+        capture->failed = true;
+    capture->file = NULL;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureSubmit
+    Copy a frame into a free slot for the capture thread, or drop it if
+    every slot is taken. The buffer must be 32 bit pixels of the size the
+    capture was opened with, bottom row first. Stills are named after the
+    frame number given.
+    Called from the game thread only.
+ ----------------------------------------------------------------------------*/
+void CaptureSubmit(struct capture *capture, const struct bitmap_buffer *buffer, uint32_t frame)
+{
+    uint32_t writeIndex = capture->writeIndex;
+    int rowSize = capture->width * CAPTURE_BYTES_PER_PIXEL;
+    uint8_t *slot;
+
+    if (writeIndex - AtomicLoadAcquire(&capture->readIndex) == CAPTURE_SLOTS) {
+        capture->framesDropped++;
+        capture->dropsPending++;
+        return;
+    }
+
+    slot = capture->slots[writeIndex & CAPTURE_SLOT_MASK];
+    if (buffer->pitch == rowSize)
+        memcpy(slot, buffer->memory, capture->frameSize);
+    else {
+        for (int y = 0; y < capture->height; y++)
+            memcpy(slot + (size_t)y * rowSize, (const uint8_t *)buffer->memory + (size_t)y * buffer->pitch, rowSize);
+    }
+    capture->slotFrames[writeIndex & CAPTURE_SLOT_MASK] = frame;
+    capture->slotRepeats[writeIndex & CAPTURE_SLOT_MASK] = capture->dropsPending;
+    capture->dropsPending = 0;
+    AtomicStoreRelease(&capture->writeIndex, writeIndex + 1);
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&capture->lock);
+    WakeConditionVariable(&capture->wake);
+    ReleaseSRWLockExclusive(&capture->lock);
+#else
+    pthread_mutex_lock(&capture->lock);
+    pthread_cond_signal(&capture->wake);
+    pthread_mutex_unlock(&capture->lock);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureThread
+    Encode and write queued frames until told to stop with none left. Once
+    a write fails, frames are taken off the queue and thrown away.
+ ----------------------------------------------------------------------------*/
+#ifdef _WIN32
+DWORD WINAPI CaptureThread(LPVOID parameter)
+#else
+void *CaptureThread(void *parameter)
+#endif
+{
+    struct capture *capture = parameter;
+    uint32_t readIndex;
+
+    for (;;) {
+        readIndex = capture->readIndex;
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&capture->lock);
+        while (AtomicLoadAcquire(&capture->writeIndex) == readIndex && !capture->quit)
+            SleepConditionVariableSRW(&capture->wake, &capture->lock, INFINITE, 0);
+        ReleaseSRWLockExclusive(&capture->lock);
+#else
+        pthread_mutex_lock(&capture->lock);
+        while (AtomicLoadAcquire(&capture->writeIndex) == readIndex && !capture->quit)
+            pthread_cond_wait(&capture->wake, &capture->lock);
+        pthread_mutex_unlock(&capture->lock);
+#endif
+        if (AtomicLoadAcquire(&capture->writeIndex) == readIndex)
+            break;
+
+        if (!capture->failed) {
+            capture->failed = !CaptureWriteFrame(capture, capture->slots[readIndex & CAPTURE_SLOT_MASK],
+                capture->slotFrames[readIndex & CAPTURE_SLOT_MASK], capture->slotRepeats[readIndex & CAPTURE_SLOT_MASK]);
+            if (!capture->failed)
+                capture->framesWritten++;
+        }
+        AtomicStoreRelease(&capture->readIndex, readIndex + 1);
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureWriteFrame
+    Encode a frame and write it: a still to a file of its own, or the next
+    frame of the video, after the last one written again for every frame
+    dropped before it. Returns false if it could not be written.
+ ----------------------------------------------------------------------------*/
+bool CaptureWriteFrame(struct capture *capture, const uint8_t *pixels, uint32_t frame, int repeats)
+{
+    char stillPath[CAPTURE_PATH_MAX];
+    FILE *file;
+    bool written;
+
+    if (capture->format == CAPTURE_PNG) {
+        capture->encodedSize = CaptureEncodePng(capture, pixels, capture->encoded);
+        snprintf(stillPath, sizeof(stillPath), "%.*s_%06u%s",
+            capture->pathStem, capture->path, frame, capture->path + capture->pathStem);
+        file = fopen(stillPath, "wb");
+        if (!file)
+            return false;
+        written = (fwrite(capture->encoded, capture->encodedSize, 1, file) == 1);
+        if (fclose(file) != 0)
+            written = false;
+        if (written)
+            capture->bytesWritten += capture->encodedSize;
+        return written;
+    }
+
+    /* The last frame is still encoded until this one replaces it. */
+    for (int repeat = 0; repeat < repeats && capture->encodedSize > 0; repeat++) {
+        if (fwrite(capture->encoded, capture->encodedSize, 1, capture->file) != 1)
+            return false;
+        capture->bytesWritten += capture->encodedSize;
+    }
+    capture->encodedSize = CaptureEncodeY4m(pixels, capture->width, capture->height, capture->encoded);
+    if (fwrite(capture->encoded, capture->encodedSize, 1, capture->file) != 1)
+        return false;
+    capture->bytesWritten += capture->encodedSize;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureEncodePng
+    Encode BGRX pixels, bottom row first, as an RGB PNG file. The scanlines
+    are unfiltered and stored in the deflate stream uncompressed. Returns
+    the size of the file.
+ ----------------------------------------------------------------------------*/
+int CaptureEncodePng(struct capture *capture, const uint8_t *pixels, uint8_t *png)
+{
+    static const uint8_t signature[CAPTURE_PNG_SIGNATURE_SIZE] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    int width = capture->width;
+    int height = capture->height;
+    int rowSize = 1 + width * 3;
+    int rawSize = height * rowSize;
+    const uint8_t *pixel;
+    uint8_t *raw, *data;
+    int position, dataSize, blockSize;
+
+    for (int y = 0; y < height; y++) {
+        pixel = pixels + (size_t)(height - 1 - y) * width * CAPTURE_BYTES_PER_PIXEL;
+        raw = capture->raw + (size_t)y * rowSize;
+        *raw++ = 0;
+        for (int x = 0; x < width; x++) {
+            raw[0] = pixel[2];
+            raw[1] = pixel[1];
+            raw[2] = pixel[0];
+            raw += 3;
+            pixel += CAPTURE_BYTES_PER_PIXEL;
+        }
+    }
+
+    memcpy(png, signature, CAPTURE_PNG_SIGNATURE_SIZE);
+    position = CAPTURE_PNG_SIGNATURE_SIZE;
+
+    data = png + position + 8;
+    CapturePut32BigEndian(data, (uint32_t)width);
+    CapturePut32BigEndian(data + 4, (uint32_t)height);
+    data[8] = 8;
+    data[9] = 2;
+    data[10] = 0;
+    data[11] = 0;
+    data[12] = 0;
+    position += CapturePngChunk(capture, png + position, "IHDR", CAPTURE_PNG_IHDR_SIZE);
+
+    data = png + position + 8;
+    dataSize = 0;
+    data[dataSize++] = 0x78;
+    data[dataSize++] = 0x01;
+    for (int offset = 0; offset < rawSize; offset += blockSize) {
+        blockSize = rawSize - offset;
+        if (blockSize > CAPTURE_PNG_STORED_MAX)
+            blockSize = CAPTURE_PNG_STORED_MAX;
+        data[dataSize++] = (offset + blockSize == rawSize) ? 1 : 0;
+        data[dataSize++] = (uint8_t)blockSize;
+        data[dataSize++] = (uint8_t)(blockSize >> 8);
+        data[dataSize++] = (uint8_t)~blockSize;
+        data[dataSize++] = (uint8_t)(~blockSize >> 8);
+        memcpy(data + dataSize, capture->raw + offset, blockSize);
+        dataSize += blockSize;
+    }
+    CapturePut32BigEndian(data + dataSize, CaptureAdler(capture->raw, rawSize));
+    dataSize += 4;
+    position += CapturePngChunk(capture, png + position, "IDAT", dataSize);
+
+    position += CapturePngChunk(capture, png + position, "IEND", 0);
+
+    return position;
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureEncodeY4m
+    Encode BGRX pixels, bottom row first, as a Y4M frame of 4:4:4 planes,
+    top row first, in BT.601 studio range. Returns the size of the frame.
+ ----------------------------------------------------------------------------*/
+int CaptureEncodeY4m(const uint8_t *pixels, int width, int height, uint8_t *frame)
+{
+    int planeSize = width * height;
+    uint8_t *planeY = frame + CAPTURE_Y4M_FRAME_HEADER_SIZE;
+    uint8_t *planeU = planeY + planeSize;
+    uint8_t *planeV = planeU + planeSize;
+    const uint8_t *pixel;
+    int red, green, blue;
+
+    memcpy(frame, CAPTURE_Y4M_FRAME_HEADER, CAPTURE_Y4M_FRAME_HEADER_SIZE);
+    for (int y = 0; y < height; y++) {
+        pixel = pixels + (size_t)(height - 1 - y) * width * CAPTURE_BYTES_PER_PIXEL;
+        for (int x = 0; x < width; x++) {
+            blue = pixel[0];
+            green = pixel[1];
+            red = pixel[2];
+            *planeY++ = (uint8_t)(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+            *planeU++ = (uint8_t)(((-38 * red - 74 * green + 112 * blue + 128) >> 8) + 128);
+            *planeV++ = (uint8_t)(((112 * red - 94 * green - 18 * blue + 128) >> 8) + 128);
+            pixel += CAPTURE_BYTES_PER_PIXEL;
+        }
+    }
+
+    return CAPTURE_Y4M_FRAME_HEADER_SIZE + planeSize * 3;
+}
+
+/*-----------------------------------------------------------------------------
+    CapturePngSizeMax
+    Returns the size of a PNG file of the given size from CaptureEncodePng.
+ ----------------------------------------------------------------------------*/
+int CapturePngSizeMax(int width, int height)
+{
+    int rawSize = height * (1 + width * 3);
+    int blocks = (rawSize + CAPTURE_PNG_STORED_MAX - 1) / CAPTURE_PNG_STORED_MAX;
+
+    return CAPTURE_PNG_SIGNATURE_SIZE + CAPTURE_PNG_CHUNK_SIZE + CAPTURE_PNG_IHDR_SIZE
+        + CAPTURE_PNG_CHUNK_SIZE + CAPTURE_PNG_ZLIB_SIZE + blocks * CAPTURE_PNG_STORED_HEADER_SIZE + rawSize
+        + CAPTURE_PNG_CHUNK_SIZE;
+}
+
+/*-----------------------------------------------------------------------------
+    CapturePngChunk
+    Finish a PNG chunk whose data is already in place after room for its
+    length and type: fill those in and append its CRC. Returns the size of
+    the chunk.
+ ----------------------------------------------------------------------------*/
+int CapturePngChunk(struct capture *capture, uint8_t *chunk, const char *type, int dataSize)
+{
+    CapturePut32BigEndian(chunk, (uint32_t)dataSize);
+    memcpy(chunk + 4, type, 4);
+    CapturePut32BigEndian(chunk + 8 + dataSize, CaptureCrc(capture->crcTable, chunk + 4, 4 + dataSize));
+
+    return CAPTURE_PNG_CHUNK_SIZE + dataSize;
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureCrc
+    Returns the CRC-32 of a block of bytes, as PNG chunks use.
+ ----------------------------------------------------------------------------*/
+uint32_t CaptureCrc(const uint32_t *table, const uint8_t *bytes, int size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (int byte = 0; byte < size; byte++)
+        crc = table[(crc ^ bytes[byte]) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFF;
+}
+
+/*-----------------------------------------------------------------------------
+    CaptureAdler
+    Returns the Adler-32 checksum of a block of bytes, as zlib streams end
+    with. The sums are reduced every 5552 bytes, the most that cannot
+    overflow.
+ ----------------------------------------------------------------------------*/
+uint32_t CaptureAdler(const uint8_t *bytes, int size)
+{
+    uint32_t sumA = 1, sumB = 0;
+    int run;
+
+    while (size > 0) {
+        run = (size < 5552) ? size : 5552;
+        size -= run;
+        while (run-- > 0) {
+            sumA += *bytes++;
+            sumB += sumA;
+        }
+        sumA %= 65521;
+        sumB %= 65521;
+    }
+
+    return (sumB << 16) | sumA;
+}
+
+/*-----------------------------------------------------------------------------
+    CapturePut32BigEndian
+    Store a 32 bit value most significant byte first, as PNG does.
+ ----------------------------------------------------------------------------*/
+void CapturePut32BigEndian(uint8_t *bytes, uint32_t value)
+{
+    for (int byte = 0; byte < 4; byte++)
+        bytes[byte] = (uint8_t)(value >> (24 - byte * 8));
+
+    return;
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+/*=============================================================================
+    capture.h
+ =============================================================================*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "atomic.h"
+
+#define CAPTURE_BYTES_PER_PIXEL 4
+#define CAPTURE_PATH_MAX 1024
+/* Must be a power of two so the free running indices can be masked. */
+#define CAPTURE_SLOTS 8
+#define CAPTURE_SLOT_MASK (CAPTURE_SLOTS - 1)
+
+/* PNG deflate streams are written as stored blocks: nothing is
+   compressed, so encoding costs no more than a pass over the pixels. */
+#define CAPTURE_PNG_SIGNATURE_SIZE 8
+#define CAPTURE_PNG_CHUNK_SIZE 12
+#define CAPTURE_PNG_IHDR_SIZE 13
+#define CAPTURE_PNG_ZLIB_SIZE 6
+#define CAPTURE_PNG_STORED_MAX 65535
+#define CAPTURE_PNG_STORED_HEADER_SIZE 5
+#define CAPTURE_Y4M_FRAME_HEADER "FRAME\n"
+#define CAPTURE_Y4M_FRAME_HEADER_SIZE 6
+
+/* Stills are PNG files, one a frame, named after the path with the frame
+   number before the extension. Video is a single Y4M file of 8 bit 4:4:4
+   BT.601 frames; a frame dropped between two others is filled in with the
+   one before, so the video keeps time. */
+enum capture_format {
+    CAPTURE_PNG,
+    CAPTURE_Y4M
+};
+
+/* Frames are copied in by the game thread and encoded and written by a
+   thread of the capture's own, single producer, single consumer. A frame
+   submitted while every slot is taken is dropped, so the game never waits
+   on the disk. Frames are copied rather than swapped in, so the same
+   frame can be handed to a stream encoder afterwards. */
+struct capture {
+    enum capture_format format;
+    int width;
+    int height;
+    int frameSize;
+    uint8_t *slots[CAPTURE_SLOTS];
+    uint32_t slotFrames[CAPTURE_SLOTS];
+    int slotRepeats[CAPTURE_SLOTS];
+    volatile uint32_t writeIndex;
+    volatile uint32_t readIndex;
+    volatile uint32_t quit;
+    int dropsPending;
+    int framesDropped;
+    uint8_t *raw;
+    uint8_t *encoded;
+    int encodedSize;
+    int framesWritten;
+    uint64_t bytesWritten;
+    bool failed;
+    char path[CAPTURE_PATH_MAX];
+    int pathStem;
+    FILE *file;
+    uint32_t crcTable[256];
+#ifdef _WIN32
+    HANDLE thread;
+    SRWLOCK lock;
+    CONDITION_VARIABLE wake;
+#else
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+#endif
+};
+
+struct bitmap_buffer;
+struct memory_arena;
+
+bool CaptureOpen(struct capture *, const char *, int, int, int, struct memory_arena *);
+size_t CaptureMemorySize(int, int);
+void CaptureClose(struct capture *);
+void CaptureSubmit(struct capture *, const struct bitmap_buffer *, uint32_t);
+#ifdef _WIN32
+DWORD WINAPI CaptureThread(LPVOID);
+#else
+void *CaptureThread(void *);
+#endif
+bool CaptureWriteFrame(struct capture *, const uint8_t *, uint32_t, int);
+int CaptureEncodePng(struct capture *, const uint8_t *, uint8_t *);
+int CaptureEncodeY4m(const uint8_t *, int, int, uint8_t *);
+int CapturePngSizeMax(int, int);
+int CapturePngChunk(struct capture *, uint8_t *, const char *, int);
+uint32_t CaptureCrc(const uint32_t *, const uint8_t *, int);
+uint32_t CaptureAdler(const uint8_t *, int);
+void CapturePut32BigEndian(uint8_t *, uint32_t);
+
+#endif /* CAPTURE_H */
\ No newline at end of file
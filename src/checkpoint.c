@@ -0,0 +1,410 @@
+/*=============================================================================
+    checkpoint.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include "game.h"
+#include "bricks.h"
+#include "checkpoint.h"
+#include "hash.h"
+
+/*-----------------------------------------------------------------------------
+    CheckpointCreate
+    Create a checkpoint file with room for a number of records of games
+    with the given brick grid, level and rules (as CheckpointGameHash
+    hashes them), and map it for appending. If the file already exists, as
+    when many processes start appending at once, it is opened for
+    appending instead, provided it is for the same game. Returns false on
+    failure.
+ ----------------------------------------------------------------------------*/
+bool CheckpointCreate(struct checkpoint_store *store, const char *path, uint32_t capacity, int rows, int columns, uint64_t gameHash)
+{
+    uint32_t recordSize = CheckpointRecordSize(rows, columns);
+
+    memset(store, 0, sizeof(*store));
+    store->size = CHECKPOINT_HEADER_SIZE + (uint64_t)capacity * recordSize;
+    store->writable = true;
+
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    store->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+    bool exists = (store->file == INVALID_HANDLE_VALUE && GetLastError() == ERROR_FILE_EXISTS);
+    if (store->file == INVALID_HANDLE_VALUE && !exists)
+        return false;
+#else
+    store->file = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    bool exists = (store->file < 0 && errno == EEXIST);
+    if (store->file < 0 && !exists)
+        return false;
+#endif
+
+    /* The process that made the file may still be filling in the header. */
+    if (exists) {
+        for (int attempt = 1; !CheckpointOpen(store, path, true); attempt++) {
+            if (attempt == CHECKPOINT_OPEN_ATTEMPTS)
+                return false;
+#ifdef _WIN32
+            Sleep(1);
+#else
+            usleep(1000);
+#endif
+        }
+        if (store->header->rows != rows || store->header->columns != columns || store->header->gameHash != gameHash) {
+            CheckpointClose(store);
+            return false;
+        }
+        return true;
+    }
+
+#ifdef _WIN32
+    size.QuadPart = (LONGLONG)store->size;
+    if (!SetFilePointerEx(store->file, size, NULL, FILE_BEGIN) || !SetEndOfFile(store->file)) {
+        CloseHandle(store->file);
+        DeleteFileA(path);
+        return false;
+    }
+#else
+    if (ftruncate(store->file, (off_t)store->size) != 0) {
+        close(store->file);
+        unlink(path);
+        return false;
+    }
+#endif
+
+    if (!CheckpointMap(store))
+        return false;
+
+    /* The magic goes in last, so a process that opens the file while it is
+       being created sees it as not valid yet rather than half written. */
+    store->header->version = CHECKPOINT_VERSION;
+    store->header->headerSize = CHECKPOINT_HEADER_SIZE;
+    store->header->recordSize = recordSize;
+    store->header->capacity = capacity;
+    store->header->rows = (uint16_t)rows;
+    store->header->columns = (uint16_t)columns;
+    store->header->claimed = 0;
+    store->header->gameHash = gameHash;
+    AtomicStoreRelease((volatile uint32_t *)&store->header->magic, CHECKPOINT_MAGIC);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointOpen
+    Map an existing checkpoint file, read only or for appending. Only the
+    header is checked; records are read in place as they are used, and
+    paged in by the system only then. Returns false if the file cannot be
+    opened or is not a checkpoint file this version can read.
+ ----------------------------------------------------------------------------*/
+bool CheckpointOpen(struct checkpoint_store *store, const char *path, bool writable)
+{
+    const struct checkpoint_header *header;
+
+    memset(store, 0, sizeof(*store));
+    store->writable = writable;
+
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    store->file = CreateFileA(path, writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (store->file == INVALID_HANDLE_VALUE)
+        return false;
+    if (!GetFileSizeEx(store->file, &size)) {
+        CloseHandle(store->file);
+        return false;
+    }
+    store->size = (uint64_t)size.QuadPart;
+#else
+    struct stat fileStat;
+
+    store->file = open(path, writable ? O_RDWR : O_RDONLY);
+    if (store->file < 0)
+        return false;
+    if (fstat(store->file, &fileStat) != 0) {
+        close(store->file);
+        return false;
+    }
+    store->size = (uint64_t)fileStat.st_size;
+#endif
+
+    if (store->size < CHECKPOINT_HEADER_SIZE) {
+#ifdef _WIN32
+        CloseHandle(store->file);
+#else
+        close(store->file);
+#endif
+        return false;
+    }
+
+    if (!CheckpointMap(store))
+        return false;
+
+    header = store->header;
+    if (AtomicLoadAcquire((volatile uint32_t *)&header->magic) != CHECKPOINT_MAGIC
+        || header->version != CHECKPOINT_VERSION
+        || header->headerSize != CHECKPOINT_HEADER_SIZE
+        || header->recordSize != CheckpointRecordSize(header->rows, header->columns)
+        || store->size < CHECKPOINT_HEADER_SIZE + (uint64_t)header->capacity * header->recordSize) {
+        CheckpointClose(store);
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointMap
+    Map the whole of a store's open file, shared, so records appended by
+    other processes are seen. Closes the file and returns false on failure.
+ ----------------------------------------------------------------------------*/
+bool CheckpointMap(struct checkpoint_store *store)
+{
+#ifdef _WIN32
+    store->mapping = CreateFileMappingA(store->file, NULL, store->writable ? PAGE_READWRITE : PAGE_READONLY,
+        (DWORD)(store->size >> 32), (DWORD)store->size, NULL);
+    if (!store->mapping) {
+        CloseHandle(store->file);
+        return false;
+    }
+    store->header = MapViewOfFile(store->mapping, store->writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    if (!store->header) {
+        CloseHandle(store->mapping);
+        CloseHandle(store->file);
+        return false;
+    }
+#else
+    void *memory = mmap(NULL, store->size, store->writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+        MAP_SHARED, store->file, 0);
+    if (memory == MAP_FAILED) {
+        close(store->file);
+        return false;
+    }
+    /* Readers jump around the file, so reading ahead of them only pushes
+       other records out of the page cache. */
+    if (!store->writable)
+        madvise(memory, store->size, MADV_RANDOM);
+    store->header = memory;
+#endif
+
+    store->records = (uint8_t *)store->header + CHECKPOINT_HEADER_SIZE;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointClose
+    Unmap and close a checkpoint file. Records written to it are left for
+    the system to write back.
+ ----------------------------------------------------------------------------*/
+void CheckpointClose(struct checkpoint_store *store)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(store->header);
+    CloseHandle(store->mapping);
+    CloseHandle(store->file);
+#else
+    munmap(store->header, store->size);
+    close(store->file);
+#endif
+    store->header = NULL;
+    store->records = NULL;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointRecordSize
+    Returns the size of a record for a grid of bricks.
+ ----------------------------------------------------------------------------*/
+uint32_t CheckpointRecordSize(int rows, int columns)
+{
+    uint32_t size = (uint32_t)sizeof(struct checkpoint_record) + (uint32_t)(rows * columns);
+
+    return (size + CHECKPOINT_RECORD_ALIGNMENT - 1) & ~(uint32_t)(CHECKPOINT_RECORD_ALIGNMENT - 1);
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointGameHash
+    Returns a hash of what a game is played on and by: its rules, and its
+    level's grid and cells if it has a level (the built in layout is set
+    by the rules).
+ ----------------------------------------------------------------------------*/
+uint64_t CheckpointGameHash(const struct game_state *gameState)
+{
+    const struct level_header *level = gameState->level;
+    const struct level_cell *cell;
+    uint64_t hash = HashMix(RulesHash(gameState->rules));
+
+    if (!level)
+        return hash;
+
+    hash = HashMix(hash ^ ((uint64_t)level->rows | (uint64_t)level->columns << 16
+        | (uint64_t)level->brickWidth << 32 | (uint64_t)level->brickHeight << 48));
+    hash = HashMix(hash ^ ((uint64_t)level->originX | (uint64_t)level->originY << 16));
+    for (int row = 0; row < level->rows; row++) {
+        for (int column = 0; column < level->columns; column++) {
+            cell = LevelCell(level, row, column);
+            hash = HashMix(hash ^ ((uint64_t)cell->type | (uint64_t)cell->color << 8 | (uint64_t)cell->hitPoints << 16));
+        }
+    }
+
+    return hash;
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointAppend
+    Save a game state as the next record of a store. Safe to call from any
+    number of threads and processes at once. Returns the index of the
+    record, or CHECKPOINT_NONE if the store is full or is for another grid
+    of bricks.
+ ----------------------------------------------------------------------------*/
+uint32_t CheckpointAppend(struct checkpoint_store *store, const struct game_state *gameState)
+{
+    struct checkpoint_header *header = store->header;
+    const struct brick_set *brickSet = &gameState->bricks;
+    struct checkpoint_record *record;
+    uint32_t index, flags;
+    int brickCount, hitPoints;
+
+    if (brickSet->base->rows != header->rows || brickSet->base->columns != header->columns)
+        return CHECKPOINT_NONE;
+
+    index = AtomicAdd(&header->claimed, 1) - 1;
+    if (index >= header->capacity)
+        return CHECKPOINT_NONE;
+
+    flags = 0;
+    if (gameState->paused)
+        flags |= CHECKPOINT_PAUSED;
+    if (gameState->pausedUser)
+        flags |= CHECKPOINT_PAUSED_USER;
+    if (gameState->versus)
+        flags |= CHECKPOINT_VERSUS;
+    for (int key = 0; key < NUM_KEYS; key++) {
+        if (gameState->keyboard[key])
+            flags |= 1u << (CHECKPOINT_KEYS_SHIFT + key);
+    }
+
+    record = (struct checkpoint_record *)(store->records + (uint64_t)index * header->recordSize);
+    record->flags = flags;
+    record->countdown = gameState->countdown;
+    record->ballX = gameState->ball.rect.position.x;
+    record->ballY = gameState->ball.rect.position.y;
+    record->ballVelocityX = gameState->ball.velocity.x;
+    record->ballVelocityY = gameState->ball.velocity.y;
+    record->paddleX = gameState->paddle.rect.position.x;
+    record->opponentX = gameState->opponent.rect.position.x;
+    record->lives = gameState->lives;
+    record->score = gameState->score;
+    record->opponentLives = gameState->opponentLives;
+    record->opponentScore = gameState->opponentScore;
+    record->ballOwner = gameState->ballOwner;
+    record->cameraY = gameState->cameraY;
+    record->reserved = 0;
+    brickCount = header->rows * header->columns;
+    for (int brickIndex = 0; brickIndex < brickCount; brickIndex++) {
+        hitPoints = BrickHitPoints(brickSet, brickIndex);
+        record->hitPoints[brickIndex] = (uint8_t)((hitPoints < 0) ? 0 : (hitPoints > 255) ? 255 : hitPoints);
+    }
+
+    AtomicStoreRelease(&record->sequence, index + 1);
+
+    return index;
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointCount
+    Returns the number of records claimed so far. A record that is still
+    being written is counted, but CheckpointGet will not return it yet.
+ ----------------------------------------------------------------------------*/
+uint32_t CheckpointCount(const struct checkpoint_store *store)
+{
+    uint32_t claimed = AtomicLoadAcquire(&store->header->claimed);
+
+    return (claimed < store->header->capacity) ? claimed : store->header->capacity;
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointGet
+    Returns a record, in place in the mapped file, or NULL if the index is
+    out of range or the record has not been written in full.
+ ----------------------------------------------------------------------------*/
+const struct checkpoint_record *CheckpointGet(const struct checkpoint_store *store, uint32_t index)
+{
+    struct checkpoint_record *record;
+
+    if (index >= store->header->capacity)
+        return NULL;
+
+    record = (struct checkpoint_record *)(store->records + (uint64_t)index * store->header->recordSize);
+    if (AtomicLoadAcquire(&record->sequence) != index + 1)
+        return NULL;
+
+    return record;
+}
+
+/*-----------------------------------------------------------------------------
+    CheckpointRestore
+    Put a game state back as it was when a record was saved. The game must
+    already be laid out on the level the record was saved from, under the
+    same rules; only the bricks' hit points are put back. Returns false if
+    there is no such record, or the grid, level or rules differ.
+ ----------------------------------------------------------------------------*/
+bool CheckpointRestore(const struct checkpoint_store *store, uint32_t index, struct game_state *gameState)
+{
+    const struct checkpoint_record *record = CheckpointGet(store, index);
+    struct brick_set *brickSet = &gameState->bricks;
+    int brickCount;
+
+    if (!record || brickSet->base->rows != store->header->rows || brickSet->base->columns != store->header->columns
+        || CheckpointGameHash(gameState) != store->header->gameHash)
+        return false;
+
+    gameState->paused = (record->flags & CHECKPOINT_PAUSED) != 0;
+    gameState->pausedUser = (record->flags & CHECKPOINT_PAUSED_USER) != 0;
+    gameState->versus = (record->flags & CHECKPOINT_VERSUS) != 0;
+    for (int key = 0; key < NUM_KEYS; key++)
+        gameState->keyboard[key] = (record->flags & (1u << (CHECKPOINT_KEYS_SHIFT + key))) != 0;
+    gameState->countdown = record->countdown;
+    gameState->ball.rect.position.x = record->ballX;
+    gameState->ball.rect.position.y = record->ballY;
+    gameState->ball.velocity.x = record->ballVelocityX;
+    gameState->ball.velocity.y = record->ballVelocityY;
+    gameState->paddle.rect.position.x = record->paddleX;
+    gameState->opponent.rect.position.x = record->opponentX;
+    gameState->lives = record->lives;
+    gameState->score = record->score;
+    gameState->opponentLives = record->opponentLives;
+    gameState->opponentScore = record->opponentScore;
+    gameState->ballOwner = record->ballOwner;
+    gameState->cameraY = record->cameraY;
+    gameState->frameChanged = true;
+
+    brickCount = store->header->rows * store->header->columns;
+    for (int brickIndex = 0; brickIndex < brickCount; brickIndex++) {
+        if (BrickHitPoints(brickSet, brickIndex) != record->hitPoints[brickIndex])
+            BrickSetHitPoints(brickSet, brickIndex, record->hitPoints[brickIndex]);
+    }
+
+    /* The camera aims at the lowest row left as the record has it. */
+    gameState->scrollRow = 0;
+    CameraTrack(gameState);
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+/*=============================================================================
+    checkpoint.h
+ =============================================================================*/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "atomic.h"
+
+/* Checkpoint files are memory mapped and used in place, like level files,
+   so every field is fixed size, naturally aligned and little-endian, with
+   no padding the compiler could add. A file is a checkpoint_header padded
+   to CHECKPOINT_HEADER_SIZE, then capacity records of recordSize bytes: a
+   checkpoint_record followed by one byte of hit points per brick, padded
+   to 8 bytes. The file is made its full size when it is created; on file
+   systems with sparse files, records take no space until written. The
+   sizes are checked when this is compiled, as a compiler that padded the
+   structures would make files other builds cannot read. */
+#define CHECKPOINT_MAGIC 0x434B4C42 /* "BLKC" */
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_HEADER_STRUCT_SIZE 32
+#define CHECKPOINT_RECORD_STRUCT_SIZE 64
+#define CHECKPOINT_HEADER_SIZE 4096
+#define CHECKPOINT_RECORD_ALIGNMENT 8
+#define CHECKPOINT_NONE 0xFFFFFFFF
+#define CHECKPOINT_OPEN_ATTEMPTS 1000
+
+#define CHECKPOINT_PAUSED 0x1
+#define CHECKPOINT_PAUSED_USER 0x2
+#define CHECKPOINT_VERSUS 0x4
+/* The keys held, one bit each from here. */
+#define CHECKPOINT_KEYS_SHIFT 8
+
+/* Writers claim records by adding to claimed, so any number of threads or
+   processes can append to a file at once. A record is only complete once
+   its sequence is its index plus one, which is written last. gameHash
+   tells the level and rules the records were saved under apart from
+   others with the same grid. */
+struct checkpoint_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t recordSize;
+    uint32_t capacity;
+    uint16_t rows;
+    uint16_t columns;
+    volatile uint32_t claimed;
+    uint64_t gameHash;
+};
+
+struct checkpoint_record {
+    volatile uint32_t sequence;
+    uint32_t flags;
+    float countdown;
+    float ballX;
+    float ballY;
+    float ballVelocityX;
+    float ballVelocityY;
+    float paddleX;
+    float opponentX;
+    int32_t lives;
+    int32_t score;
+    int32_t opponentLives;
+    int32_t opponentScore;
+    int32_t ballOwner;
+    float cameraY;
+    uint32_t reserved;
+    uint8_t hitPoints[];
+};
+
+typedef char checkpoint_header_size_check[(sizeof(struct checkpoint_header) == CHECKPOINT_HEADER_STRUCT_SIZE) ? 1 : -1];
+typedef char checkpoint_record_size_check[(sizeof(struct checkpoint_record) == CHECKPOINT_RECORD_STRUCT_SIZE
+    && offsetof(struct checkpoint_record, hitPoints) == CHECKPOINT_RECORD_STRUCT_SIZE) ? 1 : -1];
+
+struct checkpoint_store {
+    struct checkpoint_header *header;
+    uint8_t *records;
+    uint64_t size;
+    bool writable;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int file;
+#endif
+};
+
+struct game_state;
+
+bool CheckpointCreate(struct checkpoint_store *, const char *, uint32_t, int, int, uint64_t);
+bool CheckpointOpen(struct checkpoint_store *, const char *, bool);
+bool CheckpointMap(struct checkpoint_store *);
+void CheckpointClose(struct checkpoint_store *);
+uint32_t CheckpointRecordSize(int, int);
+uint64_t CheckpointGameHash(const struct game_state *);
+uint32_t CheckpointAppend(struct checkpoint_store *, const struct game_state *);
+uint32_t CheckpointCount(const struct checkpoint_store *);
+const struct checkpoint_record *CheckpointGet(const struct checkpoint_store *, uint32_t);
+bool CheckpointRestore(const struct checkpoint_store *, uint32_t, struct game_state *);
+
+#endif /* CHECKPOINT_H */
\ No newline at end of file
@@ -6,69 +6,57 @@
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <float.h>
 
 #include "game.h"
 #include "text.h"
+#include "bricks.h"
+#include "render.h"
+#include "sprite.h"
+#include "particles.h"
+#include "audio.h"
+#include "telemetry.h"
+#include "kernels.h"
 
 /*-----------------------------------------------------------------------------
     GameInit
-    Initialize the game state.
+    Initialize the game state. The bricks are laid out from a level, or the
+    built in layout if the level is NULL. A game state without rules is
+    given the defaults.
  ----------------------------------------------------------------------------*/
-void GameInit(struct game_state *gameState)
+void GameInit(struct game_state *gameState, const struct level_header *level)
 {
+    if (!gameState->rules)
+        gameState->rules = &game_rules_default;
+
+    gameState->games++;
     gameState->paused = true;
     gameState->pausedUser = false;
-    gameState->countdown = COUNTDOWN_TIME;
+    gameState->countdown = gameState->rules->countdownTime;
+    gameState->frameChanged = true;
 
     gameState->paddle.rect.position.x = PADDLE_INIT_X;
     gameState->paddle.rect.position.y = PADDLE_INIT_Y;
-    gameState->paddle.rect.width = PADDLE_WIDTH;
+    gameState->paddle.rect.width = gameState->rules->paddleWidth;
     gameState->paddle.rect.height = PADDLE_HEIGHT;
     gameState->paddle.color = COLOR_WHITE;
 
+    if (gameState->versus) {
+        gameState->opponent.rect.position.x = PADDLE_INIT_X;
+        gameState->opponent.rect.position.y = OPPONENT_INIT_Y;
+        gameState->opponent.rect.width = gameState->rules->paddleWidth;
+        gameState->opponent.rect.height = PADDLE_HEIGHT;
+        gameState->opponent.color = COLOR_WHITE;
+        gameState->opponentLives = gameState->rules->lives;
+        gameState->opponentScore = 0;
+    }
+    gameState->ballOwner = 0;
+
     BallInit(gameState);
 
-    float brickPositionY = BRICK_POSITION_Y_FIRST_COLUMN;
-    float brickPositionX;
-    enum brick_colors color;
-    for (int brickRow = 0; brickRow < BRICK_ROWS; brickRow++) {
-        brickPositionX = 0.0f;
-        color = brickRow;
-        for (int brickColumn = 0; brickColumn < BRICK_COLUMNS; brickColumn++) {
-            gameState->bricks[brickRow][brickColumn].rect.position.x = brickPositionX;
-            gameState->bricks[brickRow][brickColumn].rect.position.y = brickPositionY;
-            gameState->bricks[brickRow][brickColumn].rect.width = BRICK_WIDTH;
-            gameState->bricks[brickRow][brickColumn].rect.height = BRICK_HEIGHT;
-            switch (color) {
-            case RED:
-                gameState->bricks[brickRow][brickColumn].color = COLOR_RED;
-                break;
-            case ORANGE:
-                gameState->bricks[brickRow][brickColumn].color = COLOR_ORANGE;
-                break;
-            case YELLOW:
-                gameState->bricks[brickRow][brickColumn].color = COLOR_YELLOW;
-                break;
-            case GREEN:
-                gameState->bricks[brickRow][brickColumn].color = COLOR_GREEN;
-                break;
-            case BLUE:
-                gameState->bricks[brickRow][brickColumn].color = COLOR_BLUE;
-                break;
-            case INDIGO:
-                gameState->bricks[brickRow][brickColumn].color = COLOR_INDIGO;
-                break;
-            case VIOLET:
-                gameState->bricks[brickRow][brickColumn].color = COLOR_VIOLET;
-                break;
-            }
-            gameState->bricks[brickRow][brickColumn].broken = false;
-            brickPositionX += (float)BRICK_WIDTH;
-        }
-        brickPositionY += (float)BRICK_HEIGHT;
-    }
+    BricksInit(gameState, level);
 
-    gameState->lives = LIVES_INIT;
+    gameState->lives = gameState->rules->lives;
     gameState->score = 0;
 
     gameState->cursor.x = 0;
@@ -78,14 +66,157 @@ void GameInit(struct game_state *gameState)
     return;
 }
 
+/*-----------------------------------------------------------------------------
+    BricksInit
+    Lay out the bricks from a level. The level is used in place, so it must
+    stay mapped for as long as the game state refers to it. Without a level
+    the built in layout is used: rows of single hit bricks, a colour to a
+    row, as the rules lay them out.
+    The camera starts at the bottom; only a level taller than the screen
+    lets it scroll, and never in versus mode, where the top of the screen
+    is the opponent's. A clone with no room left for a new grid keeps its
+    old one, and is marked out of memory.
+ ----------------------------------------------------------------------------*/
+void BricksInit(struct game_state *gameState, const struct level_header *level)
+{
+    struct level_cell defaultCell;
+    const struct level_cell *cell;
+    const struct game_rules *rules = gameState->rules;
+    struct brick_base *base;
+    struct brick_vars *brick;
+    float originX, originY;
+    int brickRows, brickColumns, brickWidth, brickHeight;
+
+    gameState->level = level;
+
+    if (level) {
+        brickRows = level->rows;
+        brickColumns = level->columns;
+        brickWidth = level->brickWidth;
+        brickHeight = level->brickHeight;
+        originX = (float)level->originX;
+        originY = (float)level->originY;
+    }
+    else {
+        brickRows = rules->brickRows;
+        brickColumns = rules->brickColumns;
+        brickWidth = rules->brickWidth;
+        brickHeight = rules->brickHeight;
+        originX = 0.0f;
+        originY = rules->brickFirstRowY;
+    }
+
+    base = BrickSetLayout(&gameState->bricks, brickRows, brickColumns);
+    if (!base)
+        return;
+    gameState->kernels = BrickKernelsSelect(brickColumns);
+
+    for (int brickRow = 0; brickRow < brickRows; brickRow++) {
+        for (int brickColumn = 0; brickColumn < brickColumns; brickColumn++) {
+            if (level)
+                cell = LevelCell(level, brickRow, brickColumn);
+            else {
+                defaultCell.type = BRICK_TYPE_NORMAL;
+                defaultCell.color = (uint8_t)(brickRow % NUM_BRICK_COLORS);
+                defaultCell.hitPoints = 1;
+                cell = &defaultCell;
+            }
+            brick = &base->bricks[brickRow * brickColumns + brickColumn];
+            brick->rect.position.x = originX + (float)(brickColumn * brickWidth);
+            brick->rect.position.y = originY + (float)(brickRow * brickHeight);
+            brick->rect.width = brickWidth;
+            brick->rect.height = brickHeight;
+            brick->color = BrickColor(cell->color);
+            brick->type = cell->type;
+            if (cell->type == BRICK_TYPE_NONE)
+                brick->hitPoints = 0;
+            else
+                brick->hitPoints = (cell->hitPoints > 0) ? cell->hitPoints : 1;
+        }
+    }
+
+    gameState->cameraY = 0.0f;
+    gameState->cameraTarget = 0.0f;
+    gameState->cameraMax = 0.0f;
+    if (!gameState->versus && originY + (float)(brickRows * brickHeight) > QVGA_HEIGHT)
+        gameState->cameraMax = originY + (float)(brickRows * brickHeight) - QVGA_HEIGHT;
+    gameState->scrollRow = 0;
+    CameraTrack(gameState);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    CameraTrack
+    Find the lowest row that still has bricks to break, and aim the camera
+    to bring it down to where the first row started. Rows are only ever
+    cleared, so the search goes on from the row found last time; set
+    scrollRow to 0 first if bricks may have come back.
+ ----------------------------------------------------------------------------*/
+void CameraTrack(struct game_state *gameState)
+{
+    const struct brick_set *brickSet = &gameState->bricks;
+    const struct brick_base *base = brickSet->base;
+    int brickIndex;
+    bool rowCleared = true;
+
+    if (gameState->cameraMax <= 0.0f)
+        return;
+
+    while (gameState->scrollRow < base->rows && rowCleared) {
+        for (int column = 0; column < base->columns && rowCleared; column++) {
+            brickIndex = gameState->scrollRow * base->columns + column;
+            if (base->bricks[brickIndex].type != BRICK_TYPE_SOLID && !BrickIsBroken(brickSet, brickIndex))
+                rowCleared = false;
+        }
+        if (rowCleared)
+            gameState->scrollRow++;
+    }
+
+    if (gameState->scrollRow == base->rows)
+        gameState->cameraTarget = gameState->cameraMax;
+    else
+        gameState->cameraTarget = ClampMax(base->bricks[gameState->scrollRow * base->columns].rect.position.y
+            - base->bricks[0].rect.position.y, gameState->cameraMax);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    BrickColor
+    Returns the palette colour of a brick colour. Unknown colours are white.
+ ----------------------------------------------------------------------------*/
+uint8_t BrickColor(int color)
+{
+    switch (color) {
+    case RED:
+        return COLOR_RED;
+    case ORANGE:
+        return COLOR_ORANGE;
+    case YELLOW:
+        return COLOR_YELLOW;
+    case GREEN:
+        return COLOR_GREEN;
+    case BLUE:
+        return COLOR_BLUE;
+    case INDIGO:
+        return COLOR_INDIGO;
+    case VIOLET:
+        return COLOR_VIOLET;
+    default:
+        return COLOR_WHITE;
+    }
+}
+
 /*-----------------------------------------------------------------------------
     BallSetVelocity
-    Sets the x/y velocity of the ball based on an angle.
+    Sets the x/y velocity of the ball based on an angle, at the speed the
+    rules set.
  ----------------------------------------------------------------------------*/
 void BallSetVelocity(struct game_state *gameState, double angle)
 {
-    gameState->ball.velocity.x = BALL_SPEED_PIXELS_PER_SECOND * (float)cos(angle);
-    gameState->ball.velocity.y = BALL_SPEED_PIXELS_PER_SECOND * (float)sin(angle);
+    gameState->ball.velocity.x = gameState->rules->ballSpeed * (float)cos(angle);
+    gameState->ball.velocity.y = gameState->rules->ballSpeed * (float)sin(angle);
     return;
 }
 
@@ -99,7 +230,7 @@ void BallInit(struct game_state *gameState)
     gameState->ball.rect.position.y = BALL_INIT_Y;
     gameState->ball.rect.width = BALL_WIDTH;
     gameState->ball.rect.height = BALL_HEIGHT;
-    BallSetVelocity(gameState, BALL_INIT_ANGLE_RADIANS);
+    BallSetVelocity(gameState, DegreesToRadians(gameState->rules->ballAngleInit));
     gameState->ball.color = COLOR_WHITE;
 
     return;
@@ -108,18 +239,39 @@ void BallInit(struct game_state *gameState)
 /*-----------------------------------------------------------------------------
     GameUpdate
     Update the game state based on the time elapsed since the last update.
+    frameChanged is set if the update changed anything GameRender draws.
  ----------------------------------------------------------------------------*/
-void GameUpdate(float deltaTimeMs, struct game_state *gameState)
+void GameUpdate(float deltaTimeMs, struct game_state *gameState, struct input_queue *inputQueue)
 {
+    float secondElapsed = (deltaTimeMs / (float)MS_PER_SECOND);
+    float countdownBefore;
+    uint64_t tickEndUs = gameState->tickTimeUs + (uint64_t)(deltaTimeMs * US_PER_MS);
+
+    if (gameState->telemetry)
+        TelemetryTick(gameState->telemetry, 1);
+
+    /* Input is consumed even while paused so the unpause key is seen. This
+       also moves the paddle. */
+    GameProcessInput(gameState, inputQueue, secondElapsed, tickEndUs);
+
     if (gameState->pausedUser)
         return;
 
-    float secondElapsed = (deltaTimeMs / (float)MS_PER_SECOND);
+    if (gameState->particles && gameState->particles->count > 0) {
+        ParticlesUpdate(gameState->particles, secondElapsed);
+        gameState->frameChanged = true;
+    }
 
     if (gameState->paused) {
         if (gameState->countdown >= 0.0f) {
+            countdownBefore = gameState->countdown;
             gameState->countdown -= secondElapsed;
             gameState->countdown = ClampMin(gameState->countdown, 0.0f);
+            /* Tick on every whole second, and when it runs out. */
+            if ((int)countdownBefore != (int)gameState->countdown || (countdownBefore > 0.0f && gameState->countdown == 0.0f)) {
+                GamePlaySound(gameState, SOUND_COUNTDOWN, AUDIO_VOLUME_FULL / 2);
+                gameState->frameChanged = true;
+            }
         }
         if (gameState->countdown == 0.0f)
             gameState->paused = false;
@@ -127,17 +279,12 @@ void GameUpdate(float deltaTimeMs, struct game_state *gameState)
         return;
     }
 
-    /* Update paddle. */
-    if (gameState->keyboard[GAME_KEY_LEFT] && !(gameState->keyboard[GAME_KEY_RIGHT])) {
-        gameState->paddle.rect.position.x -= PADDLE_SPEED_PIXELS_PER_SECOND * secondElapsed;
-        gameState->paddle.rect.position.x = ClampMin(gameState->paddle.rect.position.x, 0.0f);
-    }
-    else if (gameState->keyboard[GAME_KEY_RIGHT] && !(gameState->keyboard[GAME_KEY_LEFT])) {
-        gameState->paddle.rect.position.x += PADDLE_SPEED_PIXELS_PER_SECOND * secondElapsed;
-        gameState->paddle.rect.position.x = ClampMax(gameState->paddle.rect.position.x, (QVGA_WIDTH - PADDLE_WIDTH));
-    }
+    /* Scroll towards the lowest row left to break. */
+    if (gameState->cameraY < gameState->cameraTarget)
+        gameState->cameraY = ClampMax(gameState->cameraY + gameState->rules->cameraSpeed * secondElapsed, gameState->cameraTarget);
 
     /* Update ball. */
+    gameState->frameChanged = true;
     gameState->ball.rect.position.x += gameState->ball.velocity.x * secondElapsed;
     gameState->ball.rect.position.x = ClampMin(gameState->ball.rect.position.x, 0.0f);
     gameState->ball.rect.position.x = ClampMax(gameState->ball.rect.position.x, (QVGA_WIDTH - BALL_WIDTH));
@@ -147,22 +294,51 @@ void GameUpdate(float deltaTimeMs, struct game_state *gameState)
     gameState->ball.rect.position.y = ClampMax(gameState->ball.rect.position.y, (QVGA_HEIGHT - BALL_HEIGHT));
 
     if (gameState->ball.rect.position.y == 0.0f) {
+        GamePlaySound(gameState, SOUND_LIFE_LOST, AUDIO_VOLUME_FULL);
+        if (gameState->telemetry) {
+            TelemetryLifeLost(gameState->telemetry, gameState->ball.rect.position.x);
+            if (gameState->lives == 0)
+                TelemetryGameEnd(gameState->telemetry);
+        }
         if (gameState->lives > 0) {
             gameState->lives -= 1;
             BallInit(gameState);
             gameState->paused = true;
-            gameState->countdown = COUNTDOWN_TIME;
+            gameState->countdown = gameState->rules->countdownTime;
         }
         else
-            GameInit(gameState);
+            GameInit(gameState, gameState->level);
+
+        return;
+    }
+
+    /* In versus mode the top of the screen is the opponent's to defend. */
+    if (gameState->versus && gameState->ball.rect.position.y == (QVGA_HEIGHT - BALL_HEIGHT)) {
+        GamePlaySound(gameState, SOUND_LIFE_LOST, AUDIO_VOLUME_FULL);
+        if (gameState->opponentLives > 0) {
+            gameState->opponentLives -= 1;
+            BallInit(gameState);
+            gameState->paused = true;
+            gameState->countdown = gameState->rules->countdownTime;
+        }
+        else {
+            if (gameState->telemetry)
+                TelemetryGameEnd(gameState->telemetry);
+            GameInit(gameState, gameState->level);
+        }
 
         return;
     }
 
     /* Check for collisions. */
     struct rectangle rectBall;
+    struct rectangle rectBallWorld;
     struct rectangle rectPaddle;
+    struct brick_contacts contacts;
     struct rectangle rectBrick;
+    struct brick_set *brickSet = &gameState->bricks;
+    int brickIndex, hitPoints;
+    int *score;
 
     rectBall = gameState->ball.rect;
     rectPaddle = gameState->paddle.rect;
@@ -173,21 +349,44 @@ void GameUpdate(float deltaTimeMs, struct game_state *gameState)
     if (rectBall.position.y == 0.0f || rectBall.position.y == (QVGA_HEIGHT - BALL_WIDTH))
         gameState->ball.velocity.y *= -1;
 
-    /* Paddle. */
-    if (DetectCollisionRectangle(rectBall, rectPaddle))
-        BallBouncePaddle(gameState, rectBall, rectPaddle);
-
-    /* Bricks. */
-    for (int brickRow = 0; brickRow < BRICK_ROWS; brickRow++) {
-        for (int brickColumn = 0; brickColumn < BRICK_COLUMNS; brickColumn++) {
-            rectBrick = gameState->bricks[brickRow][brickColumn].rect;
-            if (!gameState->bricks[brickRow][brickColumn].broken) {
-                if (DetectCollisionRectangle(rectBall, rectBrick)) {
-                    gameState->bricks[brickRow][brickColumn].broken = true;
-                    if (gameState->score < SCORE_MAX)
-                        gameState->score += SCORE_POINTS_PER_BRICK;
-                    BallBounceBrick(gameState, rectBall, rectBrick);
+    /* Paddles. Bricks score for whoever hit the ball last. */
+    if (DetectCollisionRectangle(rectBall, rectPaddle) && BallBouncePaddle(gameState, rectBall, rectPaddle))
+        gameState->ballOwner = 0;
+    if (gameState->versus && DetectCollisionRectangle(rectBall, gameState->opponent.rect)
+        && BallBounceOpponent(gameState, rectBall, gameState->opponent.rect))
+        gameState->ballOwner = 1;
+
+    /* Bricks. Every brick the ball touches is gathered first, then the
+       ball bounces once off all of them together. Only the brick it hit
+       hardest takes a hit; solid bricks only reflect the ball. Bricks are
+       in the world, so the ball is moved there to meet them. */
+    rectBallWorld = rectBall;
+    rectBallWorld.position.y += gameState->cameraY;
+    BricksGatherContacts(gameState, rectBallWorld, &contacts);
+    if (contacts.count > 0) {
+        brickIndex = BallBounceBricks(gameState, rectBallWorld, &contacts);
+        if (gameState->telemetry)
+            TelemetryBrickHit(gameState->telemetry, brickSet, brickIndex);
+        if (brickSet->base->bricks[brickIndex].type != BRICK_TYPE_SOLID) {
+            hitPoints = BrickHitPoints(brickSet, brickIndex) - 1;
+            /* A clone out of room loses the hit, and nothing comes of it. */
+            if (!BrickSetHitPoints(brickSet, brickIndex, hitPoints))
+                return;
+            GamePlaySound(gameState, SOUND_BRICK, (hitPoints <= 0) ? AUDIO_VOLUME_FULL / 2 : AUDIO_VOLUME_FULL / 4);
+            if (hitPoints <= 0) {
+                score = (gameState->ballOwner == 1) ? &gameState->opponentScore : &gameState->score;
+                *score += gameState->rules->scorePerBrick;
+                if (*score > gameState->rules->scoreMax)
+                    *score = gameState->rules->scoreMax;
+                if (gameState->particles) {
+                    rectBrick = brickSet->base->bricks[brickIndex].rect;
+                    rectBrick.position.y -= gameState->cameraY;
+                    ParticlesEmitBrick(gameState->particles,
+                        rectBrick,
+                        (uint8_t)brickSet->base->bricks[brickIndex].color,
+                        gameState->ball.velocity);
                 }
+                CameraTrack(gameState);
             }
         }
     }
@@ -195,42 +394,154 @@ void GameUpdate(float deltaTimeMs, struct game_state *gameState)
     return;
 }
 
+/*-----------------------------------------------------------------------------
+    GameSecondsIdle
+    Returns how long the frame will certainly stay as it is if no more
+    input arrives, so the platform can stop rendering and wait: forever
+    while the player has paused, and until the countdown's next whole
+    second while nothing else moves. Returns 0 if the frame may change on
+    the next tick, or input is waiting for it.
+ ----------------------------------------------------------------------------*/
+float GameSecondsIdle(const struct game_state *gameState, struct input_queue *inputQueue)
+{
+    struct input_event event;
+
+    if (inputQueue && InputQueuePeek(inputQueue, &event))
+        return 0.0f;
+
+    if (gameState->pausedUser)
+        return GAME_IDLE_FOREVER;
+
+    if (gameState->particles && gameState->particles->count > 0)
+        return 0.0f;
+
+    if (gameState->paused && gameState->countdown > 0.0f)
+        return gameState->countdown - floorf(gameState->countdown);
+
+    return 0.0f;
+}
+
+/*-----------------------------------------------------------------------------
+    GameProcessInput
+    Consume the queued input events that happened before the end of the
+    current tick, in order. The paddle is moved for the exact part of the
+    tick that each key state was held, so a press and release inside a
+    single tick still moves the paddle.
+ ----------------------------------------------------------------------------*/
+void GameProcessInput(struct game_state *gameState, struct input_queue *inputQueue, float secondElapsed, uint64_t tickEndUs)
+{
+    struct input_event event;
+    uint64_t segmentStartUs = gameState->tickTimeUs;
+    uint64_t tickLengthUs = tickEndUs - gameState->tickTimeUs;
+
+    while (inputQueue && InputQueuePeek(inputQueue, &event)) {
+        if (event.timestampUs > tickEndUs)
+            break;
+        /* Events stamped before the tick started are applied at its start. */
+        if (event.timestampUs > segmentStartUs) {
+            PaddleMove(gameState, secondElapsed * (float)(event.timestampUs - segmentStartUs) / (float)tickLengthUs);
+            segmentStartUs = event.timestampUs;
+        }
+        GameApplyKey(gameState, event.key, event.keyIsDown);
+        gameState->inputLastId = event.id;
+        InputQueuePop(inputQueue);
+    }
+
+    if (segmentStartUs == gameState->tickTimeUs)
+        PaddleMove(gameState, secondElapsed);
+    else if (tickEndUs > segmentStartUs)
+        PaddleMove(gameState, secondElapsed * (float)(tickEndUs - segmentStartUs) / (float)tickLengthUs);
+
+    gameState->tickTimeUs = tickEndUs;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    PaddleMove
+    Move the paddle for a number of seconds based on the keys held.
+ ----------------------------------------------------------------------------*/
+void PaddleMove(struct game_state *gameState, float secondsHeld)
+{
+    if (gameState->pausedUser || gameState->paused)
+        return;
+
+    if (gameState->keyboard[GAME_KEY_LEFT] && !(gameState->keyboard[GAME_KEY_RIGHT])) {
+        gameState->paddle.rect.position.x -= gameState->rules->paddleSpeed * secondsHeld;
+        gameState->paddle.rect.position.x = ClampMin(gameState->paddle.rect.position.x, 0.0f);
+    }
+    else if (gameState->keyboard[GAME_KEY_RIGHT] && !(gameState->keyboard[GAME_KEY_LEFT])) {
+        gameState->paddle.rect.position.x += gameState->rules->paddleSpeed * secondsHeld;
+        gameState->paddle.rect.position.x = ClampMax(gameState->paddle.rect.position.x, (QVGA_WIDTH - gameState->rules->paddleWidth));
+    }
+
+    if (!gameState->versus)
+        return;
+
+    if (gameState->keyboard[GAME_KEY_OPPONENT_LEFT] && !(gameState->keyboard[GAME_KEY_OPPONENT_RIGHT])) {
+        gameState->opponent.rect.position.x -= gameState->rules->paddleSpeed * secondsHeld;
+        gameState->opponent.rect.position.x = ClampMin(gameState->opponent.rect.position.x, 0.0f);
+    }
+    else if (gameState->keyboard[GAME_KEY_OPPONENT_RIGHT] && !(gameState->keyboard[GAME_KEY_OPPONENT_LEFT])) {
+        gameState->opponent.rect.position.x += gameState->rules->paddleSpeed * secondsHeld;
+        gameState->opponent.rect.position.x = ClampMax(gameState->opponent.rect.position.x, (QVGA_WIDTH - gameState->rules->paddleWidth));
+    }
+
+    return;
+}
+
 /*-----------------------------------------------------------------------------
     GameRender
-    Render the current game state to a bitmap buffer.
+    Render the current game state to a list of drawing commands, which
+    RenderFrame rasterizes into palette colours at any output size. The
+    paddle, ball and bricks are sprites, drawn in their colours when the
+    frame is rendered without an atlas.
  ----------------------------------------------------------------------------*/
-void GameRender(struct game_state *gameState, struct bitmap_buffer *bitmapBuffer)
+void GameRender(struct game_state *gameState, struct render_list *renderList)
 {
-    /* Clear bitmap to black. */
-    #ifdef __APPLE__
-        const uint32_t black = COLOR_BLACK;
-        const void *pattern;
-        pattern = &black;
-        memset_pattern4(bitmapBuffer->memory, pattern, bitmapBuffer->memorySize);
-    #else
-        memset(bitmapBuffer->memory, 0x00, bitmapBuffer->memorySize);
-    #endif
-
-    /* Draw paddle. */
-    DrawRectangle(
+    struct brick_set *brickSet;
+    struct rectangle rectBrick;
+    int brickIndex, rowFirst, rowLast;
+
+    /* Clear to black. */
+    RenderListInit(renderList, (int)QVGA_WIDTH, (int)QVGA_HEIGHT, COLOR_BLACK);
+    renderList->particles = gameState->particles;
+
+    /* Draw paddles. */
+    DrawSprite(
         gameState->paddle.rect,
+        SPRITE_PADDLE,
         gameState->paddle.color,
-        bitmapBuffer);
+        renderList);
+
+    if (gameState->versus) {
+        DrawSprite(
+            gameState->opponent.rect,
+            SPRITE_PADDLE,
+            gameState->opponent.color,
+            renderList);
+    }
 
     /* Draw ball. */
-    DrawRectangle(
+    DrawSprite(
         gameState->ball.rect,
+        SPRITE_BALL,
         gameState->ball.color,
-        bitmapBuffer);
-
-    /* Draw bricks. */
-    for (int brickRow = 0; brickRow < BRICK_ROWS; brickRow++) {
-        for (int brickColumn = 0; brickColumn < BRICK_COLUMNS; brickColumn++) {
-            if (gameState->bricks[brickRow][brickColumn].broken == false) {
-                DrawRectangle(
-                    gameState->bricks[brickRow][brickColumn].rect,
-                    gameState->bricks[brickRow][brickColumn].color,
-                    bitmapBuffer);
+        renderList);
+
+    /* Draw bricks. Only the rows in view are visited, and moved from the
+       world to the screen. */
+    brickSet = &gameState->bricks;
+    if (BrickRowsOverlapping(brickSet, gameState->cameraY, gameState->cameraY + QVGA_HEIGHT, &rowFirst, &rowLast)) {
+        for (brickIndex = rowFirst * brickSet->base->columns; brickIndex < (rowLast + 1) * brickSet->base->columns; brickIndex++) {
+            if (BrickIsBroken(brickSet, brickIndex) == false) {
+                rectBrick = brickSet->base->bricks[brickIndex].rect;
+                rectBrick.position.y -= gameState->cameraY;
+                DrawSprite(
+                    rectBrick,
+                    SPRITE_BRICK + brickSet->base->bricks[brickIndex].color,
+                    brickSet->base->bricks[brickIndex].color,
+                    renderList);
             }
         }
     }
@@ -239,31 +550,58 @@ void GameRender(struct game_state *gameState, struct bitmap_buffer *bitmapBuffer
     if (gameState->countdown > 0.0f) {
         gameState->cursor.x = COUNTDOWN_LABEL_X;
         gameState->cursor.y = COUNTDOWN_LABEL_Y;
-        DrawString("GET READY", &gameState->cursor, COLOR_WHITE, bitmapBuffer);
+        DrawString("GET READY", &gameState->cursor, COLOR_WHITE, renderList);
 
         gameState->cursor.x = COUNTDOWN_NUM_X;
         gameState->cursor.y = COUNTDOWN_NUM_Y;
-        DrawDigit((int)gameState->countdown, &gameState->cursor, COLOR_WHITE, bitmapBuffer);
+        DrawDigit((int)gameState->countdown, &gameState->cursor, COLOR_WHITE, renderList);
     }
 
-    /* Draw lives. */
+    /* Draw lives and score. In versus mode the opponent's are at the top,
+       at the opponent's end. */
     gameState->cursor.x = LIVES_X;
-    gameState->cursor.y = LIVES_Y;
-    DrawDigit(gameState->lives, &gameState->cursor, COLOR_WHITE, bitmapBuffer);
+    gameState->cursor.y = gameState->versus ? VERSUS_HUD_Y : LIVES_Y;
+    DrawDigit(gameState->lives, &gameState->cursor, COLOR_WHITE, renderList);
 
-    /* Draw score. */
     gameState->cursor.x = SCORE_X;
-    gameState->cursor.y = SCORE_Y;
-    DrawNumber(gameState->score, SCORE_DIGITS, &gameState->cursor, COLOR_WHITE, bitmapBuffer);
+    gameState->cursor.y = gameState->versus ? VERSUS_HUD_Y : SCORE_Y;
+    DrawNumber(gameState->score, SCORE_DIGITS, &gameState->cursor, COLOR_WHITE, renderList);
+
+    if (gameState->versus) {
+        gameState->cursor.x = LIVES_X;
+        gameState->cursor.y = LIVES_Y;
+        DrawDigit(gameState->opponentLives, &gameState->cursor, COLOR_WHITE, renderList);
+
+        gameState->cursor.x = SCORE_X;
+        gameState->cursor.y = SCORE_Y;
+        DrawNumber(gameState->opponentScore, SCORE_DIGITS, &gameState->cursor, COLOR_WHITE, renderList);
+    }
 
     return;
 }
 
 /*-----------------------------------------------------------------------------
     GameKeyboardUpdate
+    Queue a key press/release for the next GameUpdate. The timestamp is in
+    microseconds on the same clock the platform uses for tickTimeUs. Returns
+    the id of the queued event, or 0 if the queue is full.
+ ----------------------------------------------------------------------------*/
+uint32_t GameKeyboardUpdate(struct input_queue *inputQueue, int key, bool keyIsDown, uint64_t timestampUs)
+{
+    struct input_event event;
+
+    event.timestampUs = timestampUs;
+    event.key = key;
+    event.keyIsDown = keyIsDown;
+
+    return InputQueuePush(inputQueue, &event);
+}
+
+/*-----------------------------------------------------------------------------
+    GameApplyKey
     Update the keyboard state when a key is pressed/released.
  ----------------------------------------------------------------------------*/
-void GameKeyboardUpdate(struct game_state *gameState, int key, bool keyIsDown)
+void GameApplyKey(struct game_state *gameState, int key, bool keyIsDown)
 {
     if (key == GAME_KEY_ESCAPE && keyIsDown)
         gameState->pausedUser = !gameState->pausedUser;
@@ -273,23 +611,38 @@ void GameKeyboardUpdate(struct game_state *gameState, int key, bool keyIsDown)
     return;
 }
 
+/*-----------------------------------------------------------------------------
+    GamePlaySound
+    Ask for a sound to be played, if the game state has an audio queue. The
+    sound is dropped rather than waited for if the queue is full.
+ ----------------------------------------------------------------------------*/
+void GamePlaySound(struct game_state *gameState, int sound, int volume)
+{
+    if (gameState->audio)
+        AudioPlay(gameState->audio, sound, volume);
+
+    return;
+}
+
 /*-----------------------------------------------------------------------------
     DrawRectangle
-    Draw a solid rectangle in a bitmap buffer.
+    Draw a solid rectangle.
  ----------------------------------------------------------------------------*/
-void DrawRectangle(struct rectangle rect, uint32_t color, struct bitmap_buffer *bitmapBuffer)
+void DrawRectangle(struct rectangle rect, uint8_t color, struct render_list *renderList)
 {
-    uint8_t *row = bitmapBuffer->memory;
-    row += bitmapBuffer->pitch * (int)rect.position.y;
-    for (int rectY = 0; rectY < rect.height; rectY++) {
-        uint32_t *pixel = (uint32_t *)row;
-        pixel += (int)rect.position.x;
-        for (int rectX = 0; rectX < rect.width; rectX++) {
-            *pixel = color;
-            pixel++;
-        }
-        row += bitmapBuffer->pitch;
-    }
+    RenderPushRectangle(renderList, (int)rect.position.x, (int)rect.position.y, rect.width, rect.height, color);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    DrawSprite
+    Draw a sprite stretched over a rectangle, or a solid rectangle of the
+    given colour if sprites are not drawn.
+ ----------------------------------------------------------------------------*/
+void DrawSprite(struct rectangle rect, int sprite, uint8_t color, struct render_list *renderList)
+{
+    RenderPushSprite(renderList, sprite, (int)rect.position.x, (int)rect.position.y, rect.width, rect.height, color);
 
     return;
 }
@@ -339,13 +692,14 @@ void CalculateImpactState(struct impact_state *impact, struct game_state *gameSt
 
 /*-----------------------------------------------------------------------------
     BallBouncePaddle
-    Reflect the ball off the paddle.
+    Reflect the ball off the paddle. Returns true if the ball bounced.
  ----------------------------------------------------------------------------*/
-void BallBouncePaddle(struct game_state *gameState, struct rectangle rectBall, struct rectangle rectPaddle)
+bool BallBouncePaddle(struct game_state *gameState, struct rectangle rectBall, struct rectangle rectPaddle)
 {
+    const struct game_rules *rules = gameState->rules;
     struct impact_state impact;
     float ballPosRelativePaddle, ballRatioPaddle, ballNewAngle;
-    int deadZoneMin, deadZoneMax;
+    int deadZoneCenter;
 
     CalculateImpactState(&impact, gameState, rectBall, rectPaddle);
 
@@ -353,47 +707,111 @@ void BallBouncePaddle(struct game_state *gameState, struct rectangle rectBall, s
         /* The game is too easy if the ball can be reflected straight
            vertically off the center of the paddle, so add a dead zone in the
            center of the paddle making the ball bounce off at an angle */
-        ballPosRelativePaddle = (PADDLE_WIDTH + BALL_WIDTH) - (rectBall.position.x - (rectPaddle.position.x - BALL_WIDTH));
-        if (ballPosRelativePaddle > PADDLE_DEAD_ZONE_LEFT && ballPosRelativePaddle < PADDLE_DEAD_ZONE_RIGHT) {
-            if (ballPosRelativePaddle < PADDLE_DEAD_ZONE_CENTER)
-                ballPosRelativePaddle -= PADDLE_DEAD_ZONE_RADIUS;
+        ballPosRelativePaddle = (rules->paddleWidth + BALL_WIDTH) - (rectBall.position.x - (rectPaddle.position.x - BALL_WIDTH));
+        if (gameState->telemetry)
+            TelemetryPaddleHit(gameState->telemetry, ballPosRelativePaddle, rules->paddleWidth);
+        deadZoneCenter = (rules->paddleWidth + BALL_WIDTH) / 2;
+        if (ballPosRelativePaddle > deadZoneCenter - rules->paddleDeadZoneRadius && ballPosRelativePaddle < deadZoneCenter + rules->paddleDeadZoneRadius) {
+            if (ballPosRelativePaddle < deadZoneCenter)
+                ballPosRelativePaddle -= rules->paddleDeadZoneRadius;
             else
-                ballPosRelativePaddle += PADDLE_DEAD_ZONE_RADIUS;
+                ballPosRelativePaddle += rules->paddleDeadZoneRadius;
         }
-        ballRatioPaddle = ballPosRelativePaddle / (PADDLE_WIDTH + BALL_WIDTH);
-        ballNewAngle = ballRatioPaddle * (BALL_ANGLE_DEGREES_REFLECT_PADDLE_MAX - BALL_ANGLE_DEGREES_REFLECT_PADDLE_MIN) + BALL_ANGLE_DEGREES_REFLECT_PADDLE_MIN;
+        ballRatioPaddle = ballPosRelativePaddle / (rules->paddleWidth + BALL_WIDTH);
+        ballNewAngle = ballRatioPaddle * (rules->ballAngleReflectMax - rules->ballAngleReflectMin) + rules->ballAngleReflectMin;
         BallSetVelocity(gameState, DegreesToRadians(ballNewAngle));
     }
     else if (impact.impactLeft && impact.ballMovingRight)
         gameState->ball.velocity.x *= -1;
     else if (impact.impactRight && impact.ballMovingLeft)
         gameState->ball.velocity.x *= -1;
+    else
+        return false;
 
-    return;
+    GamePlaySound(gameState, SOUND_PADDLE, AUDIO_VOLUME_FULL / 2);
+
+    return true;
 }
 
 /*-----------------------------------------------------------------------------
-    BallBounceBrick
-    Reflect the ball off a brick.
+    BallBounceOpponent
+    Reflect the ball off the opponent's paddle, which is the player's
+    paddle upside down: the ball, the paddle and the ball's vertical speed
+    are mirrored, bounced and mirrored back. Returns true if the ball
+    bounced.
  ----------------------------------------------------------------------------*/
-void BallBounceBrick(struct game_state *gameState, struct rectangle rectBall, struct rectangle rectBrick)
+bool BallBounceOpponent(struct game_state *gameState, struct rectangle rectBall, struct rectangle rectPaddle)
 {
-    struct impact_state impact;
+    bool bounced;
 
-    CalculateImpactState(&impact, gameState, rectBall, rectBrick);
+    rectBall.position.y = QVGA_HEIGHT - rectBall.position.y - rectBall.height;
+    rectPaddle.position.y = QVGA_HEIGHT - rectPaddle.position.y - rectPaddle.height;
+    gameState->ball.velocity.y *= -1;
+    bounced = BallBouncePaddle(gameState, rectBall, rectPaddle);
+    gameState->ball.velocity.y *= -1;
 
-    if (impact.impactLeft && impact.ballMovingRight)
-        gameState->ball.velocity.x *= -1;
-    else if (impact.impactRight && impact.ballMovingLeft)
-        gameState->ball.velocity.x *= -1;
-    else if (impact.impactTop && impact.ballMovingDown)
-        gameState->ball.velocity.y *= -1;
-    else if (impact.impactBottom && impact.ballMovingUp)
-        gameState->ball.velocity.y *= -1;
+    return bounced;
+}
+
+/*-----------------------------------------------------------------------------
+    BricksGatherContacts
+    Count the live bricks the ball overlaps, and find the brick it
+    overlaps the most and the bounding box of all the overlaps. The ball is in world
+    pixels, and only the rows around it are looked at, by the kernel for
+    the width of the grid.
+ ----------------------------------------------------------------------------*/
+void BricksGatherContacts(struct game_state *gameState, struct rectangle rectBall, struct brick_contacts *contacts)
+{
+    const struct brick_set *brickSet = &gameState->bricks;
+    int rowFirst, rowLast;
+
+    contacts->count = 0;
+    contacts->primary = -1;
+    contacts->left = FLT_MAX;
+    contacts->bottom = FLT_MAX;
+    contacts->right = -FLT_MAX;
+    contacts->top = -FLT_MAX;
+
+    if (!BrickRowsOverlapping(brickSet, rectBall.position.y, rectBall.position.y + rectBall.height, &rowFirst, &rowLast))
+        return;
+    gameState->kernels->gatherContacts(brickSet, rectBall, rowFirst, rowLast, contacts);
 
     return;
 }
 
+/*-----------------------------------------------------------------------------
+    BallBounceBricks
+    Reflect the ball off all the bricks it touches at once. The overlaps
+    are merged into one region: a region taller than it is wide is a hit
+    on the left or right, otherwise on the top or bottom, and the ball only
+    turns around if it moves towards the region. Two bricks side by side
+    therefore reflect the ball once instead of twice. Returns the primary
+    brick.
+ ----------------------------------------------------------------------------*/
+int BallBounceBricks(struct game_state *gameState, struct rectangle rectBall, const struct brick_contacts *contacts)
+{
+    float ballCenterX = rectBall.position.x + (float)rectBall.width * 0.5f;
+    float ballCenterY = rectBall.position.y + (float)rectBall.height * 0.5f;
+    float regionCenterX = (contacts->left + contacts->right) * 0.5f;
+    float regionCenterY = (contacts->bottom + contacts->top) * 0.5f;
+    float velocityX = gameState->ball.velocity.x;
+    float velocityY = gameState->ball.velocity.y;
+    int impactLeftRight, flipX, flipY;
+
+    impactLeftRight = (contacts->top - contacts->bottom) > (contacts->right - contacts->left);
+    flipX = impactLeftRight &
+        (((regionCenterX >= ballCenterX) & (velocityX > 0.0f)) |
+         ((regionCenterX <= ballCenterX) & (velocityX < 0.0f)));
+    flipY = (impactLeftRight ^ 1) &
+        (((regionCenterY <= ballCenterY) & (velocityY < 0.0f)) |
+         ((regionCenterY >= ballCenterY) & (velocityY > 0.0f)));
+
+    gameState->ball.velocity.x = velocityX * (float)(1 - 2 * flipX);
+    gameState->ball.velocity.y = velocityY * (float)(1 - 2 * flipY);
+
+    return contacts->primary;
+}
+
 /*-----------------------------------------------------------------------------
     CalcMin
     Return the minimum of two floats.
@@ -6,20 +6,28 @@
 #define GAME_H
 
 #include "text.h"
+#include "input.h"
+#include "level.h"
+#include "memory.h"
+#include "palette.h"
+#include "rules.h"
 
 #define PI 3.14159265359
 
 #define MS_PER_SECOND 1000
 
-#define NUM_KEYS 3
+#define NUM_KEYS 5
 #define GAME_KEY_LEFT 0
 #define GAME_KEY_RIGHT 1
 #define GAME_KEY_ESCAPE 2
+#define GAME_KEY_OPPONENT_LEFT 3
+#define GAME_KEY_OPPONENT_RIGHT 4
 
+/* The tunables below that struct game_rules has fields for are only its
+   defaults; the game reads the rules. */
 #define BALL_INIT_X 0.0f
 #define BALL_INIT_Y 115.0f
 #define BALL_INIT_ANGLE_DEGREES 330.0
-#define BALL_INIT_ANGLE_RADIANS (BALL_INIT_ANGLE_DEGREES * (PI/180.0))
 #define BALL_ANGLE_DEGREES_REFLECT_PADDLE_MIN 45.0
 #define BALL_ANGLE_DEGREES_REFLECT_PADDLE_MAX 135.0
 #define BALL_WIDTH 8
@@ -31,16 +39,24 @@
 #define PADDLE_WIDTH 64
 #define PADDLE_HEIGHT 8
 #define PADDLE_DEAD_ZONE_RADIUS 16
-#define PADDLE_DEAD_ZONE_CENTER ((PADDLE_WIDTH + BALL_WIDTH) / 2)
-#define PADDLE_DEAD_ZONE_LEFT (PADDLE_DEAD_ZONE_CENTER - PADDLE_DEAD_ZONE_RADIUS)
-#define PADDLE_DEAD_ZONE_RIGHT (PADDLE_DEAD_ZONE_CENTER + PADDLE_DEAD_ZONE_RADIUS)
 #define PADDLE_SPEED_PIXELS_PER_SECOND 90.0f
+#define OPPONENT_INIT_Y (QVGA_HEIGHT - PADDLE_INIT_Y - PADDLE_HEIGHT)
 
 #define BRICK_WIDTH 16
 #define BRICK_HEIGHT 8
 #define BRICK_ROWS 7
 #define BRICK_COLUMNS 20
+/* Levels can be many screens tall, so there can be far more rows than fit
+   on the screen. */
+#define BRICK_ROWS_MAX 240
+#define BRICK_COLUMNS_MAX 40
+#define BRICK_CAPACITY_MAX (BRICK_ROWS_MAX * BRICK_COLUMNS_MAX)
 #define BRICK_POSITION_Y_FIRST_COLUMN 140.0f
+#define BRICK_CHANGES_MAX 16
+#define BrickBaseSize(capacity) (sizeof(struct brick_base) + (size_t)(capacity) * sizeof(struct brick_vars))
+
+/* The camera only ever scrolls up, as rows of bricks are cleared. */
+#define CAMERA_SPEED_PIXELS_PER_SECOND 30.0f
 
 #define LIVES_INIT 3
 #define LIVES_X 0
@@ -51,6 +67,7 @@
 #define SCORE_MAX 999
 #define SCORE_X 295
 #define SCORE_Y 231
+#define VERSUS_HUD_Y 1
 
 #define COUNTDOWN_TIME 3.5f
 #define COUNTDOWN_LABEL_X 124
@@ -58,30 +75,9 @@
 #define COUNTDOWN_NUM_X 156
 #define COUNTDOWN_NUM_Y 66
 
-#ifdef __APPLE__
-    #define COLOR_BLACK 0xFF000000
-    #define COLOR_WHITE 0xFFFFFFFF
-    #define COLOR_RED 0xFF0000FF
-    #define COLOR_ORANGE 0xFF00A5FF
-    #define COLOR_YELLOW 0xFF00FFFF
-    #define COLOR_GREEN 0xFF00FF00
-    #define COLOR_BLUE 0xFFFF0000
-    #define COLOR_INDIGO 0xFF82004B
-    #define COLOR_VIOLET 0xFFC9388D
-#elif _WIN32
-    #define COLOR_WHITE 0x00FFFFFF
-    #define COLOR_RED 0x00FF0000
-    #define COLOR_ORANGE 0x00FFA500
-    #define COLOR_YELLOW 0x00FFFF00
-    #define COLOR_GREEN 0x0000FF00
-    #define COLOR_BLUE 0x000000FF
-    #define COLOR_INDIGO 0x004B0082
-    #define COLOR_VIOLET 0x008D38C9
-#else
-    #error "Unknown compiler."
-#endif
-
-#define DegreesToRadians(degrees) (degrees * ((PI/180.0)))
+#define GAME_IDLE_FOREVER 1.0e30f
+
+#define DegreesToRadians(degrees) ((degrees) * ((PI/180.0)))
 
 enum brick_colors {
     RED,
@@ -90,7 +86,8 @@ enum brick_colors {
     GREEN,
     BLUE,
     INDIGO,
-    VIOLET
+    VIOLET,
+    NUM_BRICK_COLORS
 };
 
 struct vector_2d {
@@ -126,7 +123,37 @@ struct ball_vars {
 struct brick_vars {
     struct rectangle rect;
     int color;
-    bool broken;
+    int hitPoints;
+    enum brick_type type;
+};
+
+/* The brick layout and hit points, shared by every game state cloned from
+   the same game. A base is only written in place while a single game state
+   refers to it. */
+struct brick_base {
+    volatile uint32_t refCount;
+    int capacity;
+    int rows;
+    int columns;
+    struct brick_vars bricks[];
+};
+
+struct brick_change {
+    uint16_t index;
+    int16_t hitPoints;
+};
+
+/* A game state's view of the bricks: a shared base plus the hit points it
+   changed since, kept until the change list is full. A brick is broken
+   when it has no hit points left. A set is out of memory once a change
+   was lost because its arena had no room for a base of its own. */
+struct brick_set {
+    struct brick_base *base;
+    struct memory_arena *arena;
+    int changeCount;
+    uint64_t changeMask;
+    bool outOfMemory;
+    struct brick_change changes[BRICK_CHANGES_MAX];
 };
 
 struct impact_state {
@@ -145,30 +172,96 @@ struct impact_state {
     bool ballMovingDown;
 };
 
+/* How many bricks the ball overlaps in one tick, and the bounding box of
+   the overlaps. The primary brick is the one with the largest overlap. */
+struct brick_contacts {
+    int count;
+    int primary;
+    float left;
+    float bottom;
+    float right;
+    float top;
+};
+
+struct brick_kernels;
+struct render_list;
+struct particle_system;
+struct audio_queue;
+struct telemetry;
+
+/* Particles and sounds are only for show. A game state without a particle
+   system or an audio queue, such as a clone, emits none; likewise only a
+   game state with a telemetry block counts what happens in play. In versus mode a
+   second player defends the top of the screen with the opponent paddle;
+   it is set before GameInit and kept from game to game, as is the count
+   of games started, which tells when a game has ended. frameChanged is
+   set whenever the drawn frame changes, and cleared by the platform once
+   it has drawn it.
+
+   The ball and paddles are in screen pixels, but the bricks are in world
+   pixels, which only differ on levels taller than the screen. cameraY is
+   the world height of the bottom of the screen; it rises towards
+   cameraTarget, which keeps scrollRow, the lowest row with bricks left to
+   break, where the level's first row started, until it reaches
+   cameraMax.
+
+   The rules are set before GameInit, which uses the defaults if there are
+   none; kernels are the brick loops for the width of the grid, picked by
+   BricksInit. */
 struct game_state {
+    const struct game_rules *rules;
+    const struct brick_kernels *kernels;
     bool paused;
     bool pausedUser;
     float countdown;
+    bool frameChanged;
     bool keyboard[NUM_KEYS];
+    uint64_t tickTimeUs;
+    uint32_t inputLastId;
     struct paddle_vars paddle;
     struct ball_vars ball;
-    struct brick_vars bricks[BRICK_ROWS][BRICK_COLUMNS];
+    bool versus;
+    struct paddle_vars opponent;
+    int opponentLives;
+    int opponentScore;
+    int ballOwner;
+    const struct level_header *level;
+    struct brick_set bricks;
+    float cameraY;
+    float cameraTarget;
+    float cameraMax;
+    int scrollRow;
+    struct particle_system *particles;
+    struct audio_queue *audio;
+    struct telemetry *telemetry;
     int lives;
     int score;
+    uint32_t games;
     struct text_cursor cursor;
 };
 
-void GameInit(struct game_state *);
+void GameInit(struct game_state *, const struct level_header *);
+void BricksInit(struct game_state *, const struct level_header *);
+uint8_t BrickColor(int);
 void BallSetVelocity(struct game_state *, double);
 void BallInit(struct game_state *);
-void GameUpdate(float, struct game_state *);
-void GameRender(struct game_state *, struct bitmap_buffer *);
-void GameKeyboardUpdate(struct game_state *, int, bool);
-void DrawRectangle(struct rectangle, uint32_t, struct bitmap_buffer *);
+void CameraTrack(struct game_state *);
+void GameUpdate(float, struct game_state *, struct input_queue *);
+float GameSecondsIdle(const struct game_state *, struct input_queue *);
+void GameProcessInput(struct game_state *, struct input_queue *, float, uint64_t);
+void GameRender(struct game_state *, struct render_list *);
+uint32_t GameKeyboardUpdate(struct input_queue *, int, bool, uint64_t);
+void GameApplyKey(struct game_state *, int, bool);
+void PaddleMove(struct game_state *, float);
+void GamePlaySound(struct game_state *, int, int);
+void DrawRectangle(struct rectangle, uint8_t, struct render_list *);
+void DrawSprite(struct rectangle, int, uint8_t, struct render_list *);
 bool DetectCollisionRectangle(struct rectangle, struct rectangle);
 void CalculateImpactState(struct impact_state *, struct game_state *, struct rectangle, struct rectangle);
-void BallBouncePaddle(struct game_state *, struct rectangle, struct rectangle);
-void BallBounceBrick(struct game_state *, struct rectangle, struct rectangle);
+bool BallBouncePaddle(struct game_state *, struct rectangle, struct rectangle);
+bool BallBounceOpponent(struct game_state *, struct rectangle, struct rectangle);
+void BricksGatherContacts(struct game_state *, struct rectangle, struct brick_contacts *);
+int BallBounceBricks(struct game_state *, struct rectangle, const struct brick_contacts *);
 float CalcMin(float, float);
 float CalcMax(float, float);
 float ClampMin(float, float);
@@ -0,0 +1,178 @@
+/*=============================================================================
+    hash.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define HASH_SSE2
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define HASH_NEON
+#endif
+
+#include "game.h"
+#include "hash.h"
+
+#define HASH_PRIME32 0x9E3779B1u
+#define HASH_PRIME64_1 0x9E3779B185EBCA87ull
+#define HASH_PRIME64_2 0xC2B2AE3D27D4EB4Full
+
+/* Keys XORed into each lane, so that zero pixels still stir the hash. */
+static const uint64_t hash_secret[HASH_LANES] = {
+    0xBE4BA423396CFEB8ull, 0x1CAD21F72C81017Cull, 0xDB979083E96DD4DEull, 0x1F67B3B7A4A44072ull,
+    0x78E5C0CC4EE679CBull, 0x2172FFCC7DD05A82ull, 0x8E2443F7744608B8ull, 0x4C263A81E69035E0ull
+};
+
+/*-----------------------------------------------------------------------------
+    HashFrame
+    Returns a 64 bit hash of a frame's pixels, for telling whether two
+    frames are the same. Padding at the ends of rows is left out. Every
+    build gets the same hash for the same frame, whether it hashes with
+    SIMD or not.
+ ----------------------------------------------------------------------------*/
+uint64_t HashFrame(const struct bitmap_buffer *buffer, int bytesPerPixel)
+{
+    uint64_t accumulators[HASH_LANES] = {
+        HASH_PRIME32, HASH_PRIME64_1, HASH_PRIME64_2, HASH_PRIME64_1 ^ HASH_PRIME64_2,
+        HASH_PRIME64_2 * 3, HASH_PRIME64_1 * 5, HASH_PRIME32 * 7, HASH_PRIME64_1 + HASH_PRIME64_2
+    };
+    int rowSize = buffer->width * bytesPerPixel;
+    int stripeCount = rowSize / HASH_STRIPE_SIZE;
+    const uint8_t *row = buffer->memory;
+    uint64_t hash;
+
+    for (int y = 0; y < buffer->height; y++) {
+        HashStripes(accumulators, row, stripeCount);
+        /* The last few bytes of a row, if it is not a whole number of
+           stripes. */
+        for (int index = stripeCount * HASH_STRIPE_SIZE; index < rowSize; index++)
+            accumulators[index % HASH_LANES] = (accumulators[index % HASH_LANES] ^ row[index]) * HASH_PRIME64_1;
+        HashScramble(accumulators);
+        row += buffer->pitch;
+    }
+
+    hash = HashMix(((uint64_t)buffer->width << 32 | (uint32_t)buffer->height) ^ HASH_PRIME64_2);
+    for (int lane = 0; lane < HASH_LANES; lane++)
+        hash = HashMix(hash ^ accumulators[lane]);
+
+    return hash;
+}
+
+/*-----------------------------------------------------------------------------
+    HashStripes
+    Accumulate stripes of 64 bytes. Each lane adds the product of the two
+    halves of its keyed input, and the neighbouring lane's input as is, so
+    that no input is lost to a zero product.
+ ----------------------------------------------------------------------------*/
+void HashStripes(uint64_t *accumulators, const uint8_t *bytes, int stripeCount)
+{
+#if defined(HASH_SSE2)
+    __m128i sums[HASH_LANES / 2];
+    __m128i keys[HASH_LANES / 2];
+    __m128i data, keyed, product;
+
+    for (int pair = 0; pair < HASH_LANES / 2; pair++) {
+        sums[pair] = _mm_loadu_si128((const __m128i *)(accumulators + pair * 2));
+        keys[pair] = _mm_loadu_si128((const __m128i *)(hash_secret + pair * 2));
+    }
+    for (int stripe = 0; stripe < stripeCount; stripe++) {
+        for (int pair = 0; pair < HASH_LANES / 2; pair++) {
+            data = _mm_loadu_si128((const __m128i *)(bytes + pair * 16));
+            keyed = _mm_xor_si128(data, keys[pair]);
+            product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            sums[pair] = _mm_add_epi64(sums[pair], product);
+            sums[pair] = _mm_add_epi64(sums[pair], _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2)));
+        }
+        bytes += HASH_STRIPE_SIZE;
+    }
+    for (int pair = 0; pair < HASH_LANES / 2; pair++)
+        _mm_storeu_si128((__m128i *)(accumulators + pair * 2), sums[pair]);
+#elif defined(HASH_NEON)
+    uint64x2_t sums[HASH_LANES / 2];
+    uint64x2_t keys[HASH_LANES / 2];
+    uint64x2_t data, keyed;
+
+    for (int pair = 0; pair < HASH_LANES / 2; pair++) {
+        sums[pair] = vld1q_u64(accumulators + pair * 2);
+        keys[pair] = vld1q_u64(hash_secret + pair * 2);
+    }
+    for (int stripe = 0; stripe < stripeCount; stripe++) {
+        for (int pair = 0; pair < HASH_LANES / 2; pair++) {
+            data = vreinterpretq_u64_u8(vld1q_u8(bytes + pair * 16));
+            keyed = veorq_u64(data, keys[pair]);
+            sums[pair] = vaddq_u64(sums[pair], vmull_u32(vmovn_u64(keyed), vshrn_n_u64(keyed, 32)));
+            sums[pair] = vaddq_u64(sums[pair], vextq_u64(data, data, 1));
+        }
+        bytes += HASH_STRIPE_SIZE;
+    }
+    for (int pair = 0; pair < HASH_LANES / 2; pair++)
+        vst1q_u64(accumulators + pair * 2, sums[pair]);
+#else
+    uint64_t data[HASH_LANES];
+    uint64_t keyed;
+
+    for (int stripe = 0; stripe < stripeCount; stripe++) {
+        for (int lane = 0; lane < HASH_LANES; lane++)
+            data[lane] = HashLoad64(bytes + lane * 8);
+        for (int lane = 0; lane < HASH_LANES; lane++) {
+            keyed = data[lane] ^ hash_secret[lane];
+            accumulators[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32) + data[lane ^ 1];
+        }
+        bytes += HASH_STRIPE_SIZE;
+    }
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    HashScramble
+    Stir the high bits of each lane into its low bits, between rows, so
+    they are not only ever added to.
+ ----------------------------------------------------------------------------*/
+void HashScramble(uint64_t *accumulators)
+{
+    uint64_t lane;
+
+    for (int index = 0; index < HASH_LANES; index++) {
+        lane = accumulators[index];
+        lane ^= lane >> 47;
+        lane ^= hash_secret[index];
+        accumulators[index] = lane * HASH_PRIME32;
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    HashMix
+    Returns a 64 bit value with its bits thoroughly mixed.
+ ----------------------------------------------------------------------------*/
+uint64_t HashMix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= HASH_PRIME64_2;
+    value ^= value >> 29;
+    value *= HASH_PRIME64_1;
+    value ^= value >> 32;
+
+    return value;
+}
+
+/*-----------------------------------------------------------------------------
+    HashLoad64
+    Read 64 bits from any alignment, little endian as on every platform
+    the game runs on.
+ ----------------------------------------------------------------------------*/
+uint64_t HashLoad64(const uint8_t *bytes)
+{
+    uint64_t value;
+
+    memcpy(&value, bytes, sizeof(value));
+
+    return value;
+}
\ No newline at end of file
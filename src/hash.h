@@ -0,0 +1,22 @@
+/*=============================================================================
+    hash.h
+ =============================================================================*/
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+
+/* Frames are hashed 64 bytes at a time, in eight 64 bit lanes. */
+#define HASH_LANES 8
+#define HASH_STRIPE_SIZE (HASH_LANES * 8)
+
+struct bitmap_buffer;
+
+uint64_t HashFrame(const struct bitmap_buffer *, int);
+void HashStripes(uint64_t *, const uint8_t *, int);
+void HashScramble(uint64_t *);
+uint64_t HashMix(uint64_t);
+uint64_t HashLoad64(const uint8_t *);
+
+#endif /* HASH_H */
\ No newline at end of file
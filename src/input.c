@@ -0,0 +1,74 @@
+/*=============================================================================
+    input.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "input.h"
+
+/*-----------------------------------------------------------------------------
+    InputQueueInit
+    Initialize an empty input queue.
+ ----------------------------------------------------------------------------*/
+void InputQueueInit(struct input_queue *inputQueue)
+{
+    inputQueue->writeIndex = 0;
+    inputQueue->readIndex = 0;
+    inputQueue->nextEventId = 1;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    InputQueuePush
+    Add an event to the back of the queue and tag it with an id. Returns the
+    id, or 0 if the queue is full. Only called by the producer.
+ ----------------------------------------------------------------------------*/
+uint32_t InputQueuePush(struct input_queue *inputQueue, struct input_event *event)
+{
+    uint32_t writeIndex = inputQueue->writeIndex;
+    uint32_t readIndex = AtomicLoadAcquire(&inputQueue->readIndex);
+
+    if (writeIndex - readIndex >= INPUT_QUEUE_SIZE)
+        return 0;
+
+    event->id = inputQueue->nextEventId++;
+    if (inputQueue->nextEventId == 0)
+        inputQueue->nextEventId = 1;
+
+    inputQueue->events[writeIndex & INPUT_QUEUE_MASK] = *event;
+    AtomicStoreRelease(&inputQueue->writeIndex, writeIndex + 1);
+
+    return event->id;
+}
+
+/*-----------------------------------------------------------------------------
+    InputQueuePeek
+    Copy the event at the front of the queue without removing it. Returns
+    false if the queue is empty. Only called by the consumer.
+ ----------------------------------------------------------------------------*/
+bool InputQueuePeek(struct input_queue *inputQueue, struct input_event *event)
+{
+    uint32_t readIndex = inputQueue->readIndex;
+    uint32_t writeIndex = AtomicLoadAcquire(&inputQueue->writeIndex);
+
+    if (readIndex == writeIndex)
+        return false;
+
+    *event = inputQueue->events[readIndex & INPUT_QUEUE_MASK];
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    InputQueuePop
+    Remove the event at the front of the queue. Only called by the consumer
+    after a successful InputQueuePeek.
+ ----------------------------------------------------------------------------*/
+void InputQueuePop(struct input_queue *inputQueue)
+{
+    AtomicStoreRelease(&inputQueue->readIndex, inputQueue->readIndex + 1);
+
+    return;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+/*=============================================================================
+    input.h
+ =============================================================================*/
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "atomic.h"
+
+#define US_PER_MS 1000
+#define US_PER_SECOND 1000000
+
+/* Must be a power of two so the free running indices can be masked. */
+#define INPUT_QUEUE_SIZE 256
+#define INPUT_QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+struct input_event {
+    uint64_t timestampUs;
+    uint32_t id;
+    int key;
+    bool keyIsDown;
+};
+
+/* Single producer (the platform's input handler), single consumer
+   (GameUpdate). The producer only writes writeIndex and nextEventId and the
+   consumer only writes readIndex, so no locks are needed. */
+struct input_queue {
+    struct input_event events[INPUT_QUEUE_SIZE];
+    volatile uint32_t writeIndex;
+    volatile uint32_t readIndex;
+    uint32_t nextEventId;
+};
+
+void InputQueueInit(struct input_queue *);
+uint32_t InputQueuePush(struct input_queue *, struct input_event *);
+bool InputQueuePeek(struct input_queue *, struct input_event *);
+void InputQueuePop(struct input_queue *);
+
+#endif /* INPUT_H */
\ No newline at end of file
@@ -0,0 +1,81 @@
+/*=============================================================================
+    kernels.c
+    Brick kernels for the common grid widths: the built in layout's 20
+    columns and the widths levelgen.c lays out. Each width is an
+    instantiation of kernels_template.c.
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "bricks.h"
+#include "simulate.h"
+#include "kernels.h"
+
+#define KERNEL_PASTE(name, suffix) name##suffix
+#define KERNEL_EXPAND(name, suffix) KERNEL_PASTE(name, suffix)
+#define KERNEL_NAME(name) KERNEL_EXPAND(name, KERNEL_SUFFIX)
+
+/* A row of a constant width is unrolled in full; BRICK_COLUMNS_MAX is
+   the most columns a row can have. */
+#if defined(__GNUC__)
+    #define KERNEL_UNROLL _Pragma("GCC unroll 40")
+#else
+    #define KERNEL_UNROLL
+#endif
+
+#define KERNEL_SUFFIX 8
+#define KERNEL_COLUMNS 8
+#include "kernels_template.c"
+#undef KERNEL_SUFFIX
+#undef KERNEL_COLUMNS
+
+#define KERNEL_SUFFIX 10
+#define KERNEL_COLUMNS 10
+#include "kernels_template.c"
+#undef KERNEL_SUFFIX
+#undef KERNEL_COLUMNS
+
+#define KERNEL_SUFFIX 16
+#define KERNEL_COLUMNS 16
+#include "kernels_template.c"
+#undef KERNEL_SUFFIX
+#undef KERNEL_COLUMNS
+
+#define KERNEL_SUFFIX 20
+#define KERNEL_COLUMNS 20
+#include "kernels_template.c"
+#undef KERNEL_SUFFIX
+#undef KERNEL_COLUMNS
+
+#undef KERNEL_UNROLL
+#define KERNEL_UNROLL
+#define KERNEL_SUFFIX Any
+#define KERNEL_COLUMNS (brickSet->base->columns)
+#include "kernels_template.c"
+#undef KERNEL_SUFFIX
+#undef KERNEL_COLUMNS
+
+static const struct brick_kernels brickKernels[] = {
+    {20, BricksGatherContacts20, BricksSweep20},
+    {16, BricksGatherContacts16, BricksSweep16},
+    {10, BricksGatherContacts10, BricksSweep10},
+    {8, BricksGatherContacts8, BricksSweep8},
+    {0, BricksGatherContactsAny, BricksSweepAny}
+};
+
+/*-----------------------------------------------------------------------------
+    BrickKernelsSelect
+    Returns the kernels for a grid with a number of columns: its own if it
+    has them, otherwise the ones for any width.
+ ----------------------------------------------------------------------------*/
+const struct brick_kernels *BrickKernelsSelect(int columns)
+{
+    const struct brick_kernels *kernels = brickKernels;
+
+    while (kernels->columns != 0 && kernels->columns != columns)
+        kernels++;
+
+    return kernels;
+}
\ No newline at end of file
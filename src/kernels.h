@@ -0,0 +1,30 @@
+/*=============================================================================
+    kernels.h
+ =============================================================================*/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+/* The brick loops that run every tick, picked by the width of the brick
+   grid. The common widths have kernels of their own, built from
+   kernels_template.c with the column count a constant, so their loops
+   over a row unroll; the last entry in the table serves any width. */
+struct brick_kernels {
+    int columns;
+    void (*gatherContacts)(const struct brick_set *, struct rectangle, int, int, struct brick_contacts *);
+    float (*sweep)(const struct brick_set *, struct rectangle, float, float, int, int);
+};
+
+const struct brick_kernels *BrickKernelsSelect(int);
+void BricksGatherContacts8(const struct brick_set *, struct rectangle, int, int, struct brick_contacts *);
+void BricksGatherContacts10(const struct brick_set *, struct rectangle, int, int, struct brick_contacts *);
+void BricksGatherContacts16(const struct brick_set *, struct rectangle, int, int, struct brick_contacts *);
+void BricksGatherContacts20(const struct brick_set *, struct rectangle, int, int, struct brick_contacts *);
+void BricksGatherContactsAny(const struct brick_set *, struct rectangle, int, int, struct brick_contacts *);
+float BricksSweep8(const struct brick_set *, struct rectangle, float, float, int, int);
+float BricksSweep10(const struct brick_set *, struct rectangle, float, float, int, int);
+float BricksSweep16(const struct brick_set *, struct rectangle, float, float, int, int);
+float BricksSweep20(const struct brick_set *, struct rectangle, float, float, int, int);
+float BricksSweepAny(const struct brick_set *, struct rectangle, float, float, int, int);
+
+#endif /* KERNELS_H */
\ No newline at end of file
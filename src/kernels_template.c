@@ -0,0 +1,79 @@
+/*=============================================================================
+    kernels_template.c
+    The brick kernels, written once and included by kernels.c for every
+    grid width that has kernels of its own. KERNEL_NAME adds the width to
+    each name, and KERNEL_COLUMNS is the number of columns: a constant,
+    except in the kernels that serve any width. Nothing here has an
+    include guard, on purpose.
+ =============================================================================*/
+
+/*-----------------------------------------------------------------------------
+    BricksGatherContacts (kernel)
+    Gather the contacts of the ball with the live bricks in a range of
+    rows, into contacts already emptied by BricksGatherContacts. Bricks are
+    visited row by row from the bottom, left to right, as the flat loop
+    visited them, so the same brick wins a tie for the largest overlap.
+ ----------------------------------------------------------------------------*/
+void KERNEL_NAME(BricksGatherContacts)(const struct brick_set *brickSet, struct rectangle rectBall, int rowFirst, int rowLast, struct brick_contacts *contacts)
+{
+    const struct brick_vars *bricks = brickSet->base->bricks;
+    const int columns = KERNEL_COLUMNS;
+    struct rectangle rectBrick;
+    float left, bottom, right, top, area;
+    float areaMax = -1.0f;
+    int brickIndex;
+
+    for (int row = rowFirst; row <= rowLast; row++) {
+        KERNEL_UNROLL
+        for (int column = 0; column < columns; column++) {
+            brickIndex = row * columns + column;
+            rectBrick = bricks[brickIndex].rect;
+            if (!DetectCollisionRectangle(rectBall, rectBrick) || BrickIsBroken(brickSet, brickIndex))
+                continue;
+
+            left = CalcMax(rectBall.position.x, rectBrick.position.x);
+            bottom = CalcMax(rectBall.position.y, rectBrick.position.y);
+            right = CalcMin(rectBall.position.x + rectBall.width, rectBrick.position.x + rectBrick.width);
+            top = CalcMin(rectBall.position.y + rectBall.height, rectBrick.position.y + rectBrick.height);
+            area = (right - left) * (top - bottom);
+
+            contacts->count++;
+            if (area > areaMax) {
+                areaMax = area;
+                contacts->primary = brickIndex;
+            }
+            contacts->left = CalcMin(contacts->left, left);
+            contacts->bottom = CalcMin(contacts->bottom, bottom);
+            contacts->right = CalcMax(contacts->right, right);
+            contacts->top = CalcMax(contacts->top, top);
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    BricksSweep (kernel)
+    Returns the first (fractional) tick at which a ball moving by a fixed
+    step every tick reaches a live brick in a range of rows, or
+    SIMULATE_NEVER.
+ ----------------------------------------------------------------------------*/
+float KERNEL_NAME(BricksSweep)(const struct brick_set *brickSet, struct rectangle rectBall, float stepX, float stepY, int rowFirst, int rowLast)
+{
+    const struct brick_vars *bricks = brickSet->base->bricks;
+    const int columns = KERNEL_COLUMNS;
+    float eventTick = SIMULATE_NEVER;
+    int brickIndex;
+
+    for (int row = rowFirst; row <= rowLast; row++) {
+        KERNEL_UNROLL
+        for (int column = 0; column < columns; column++) {
+            brickIndex = row * columns + column;
+            if (BrickIsBroken(brickSet, brickIndex))
+                continue;
+            eventTick = CalcMin(eventTick, SweepEnterTick(rectBall, stepX, stepY, bricks[brickIndex].rect));
+        }
+    }
+
+    return eventTick;
+}
\ No newline at end of file
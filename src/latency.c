@@ -0,0 +1,250 @@
+/*=============================================================================
+    latency.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "input.h"
+#include "latency.h"
+
+static const char *const latency_span_names[LATENCY_SPANS] = {
+    "input->update",
+    "update->render",
+    "render->present",
+    "input->present"
+};
+
+/*-----------------------------------------------------------------------------
+    LatencyTraceInit
+    Initialize the tracer. If a path is given, every completed event is also
+    written to it in the Chrome trace event format (chrome://tracing).
+ ----------------------------------------------------------------------------*/
+void LatencyTraceInit(struct latency_tracer *tracer, const char *tracePath)
+{
+    memset(tracer, 0, sizeof(*tracer));
+
+    if (tracePath) {
+        tracer->traceFile = fopen(tracePath, "w");
+        if (tracer->traceFile)
+            fprintf(tracer->traceFile, "[\n");
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyTraceClose
+    Finish and close the trace file.
+ ----------------------------------------------------------------------------*/
+void LatencyTraceClose(struct latency_tracer *tracer)
+{
+    if (tracer->traceFile) {
+        fprintf(tracer->traceFile, "\n]\n");
+        fclose(tracer->traceFile);
+        tracer->traceFile = NULL;
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyTraceInput
+    Start following an input event. Called with the id returned by
+    GameKeyboardUpdate and the timestamp the event was queued with.
+ ----------------------------------------------------------------------------*/
+void LatencyTraceInput(struct latency_tracer *tracer, uint32_t id, uint64_t timeUs)
+{
+    struct latency_record *record;
+
+    if (id == 0)
+        return;
+
+    record = &tracer->records[id & LATENCY_RECORDS_MASK];
+    memset(record, 0, sizeof(*record));
+    record->id = id;
+    record->timeUs[LATENCY_STAGE_INPUT] = timeUs;
+    tracer->lastId[LATENCY_STAGE_INPUT] = id;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyTraceMark
+    Mark every event that reached the previous stage, up to and including
+    the given id, as having reached a stage. Events that complete the
+    present stage are added to the histograms.
+ ----------------------------------------------------------------------------*/
+void LatencyTraceMark(struct latency_tracer *tracer, enum latency_stage stage, uint32_t lastId, uint64_t timeUs)
+{
+    struct latency_record *record;
+    uint32_t id = tracer->lastId[stage] + 1;
+
+    if ((int32_t)(lastId - tracer->lastId[stage]) <= 0)
+        return;
+
+    /* Older events have been overwritten in the ring. */
+    if (lastId - id >= LATENCY_RECORDS)
+        id = lastId - LATENCY_RECORDS + 1;
+
+    for (; (int32_t)(lastId - id) >= 0; id++) {
+        record = &tracer->records[id & LATENCY_RECORDS_MASK];
+        if (record->id != id || record->timeUs[stage - 1] == 0)
+            continue;
+        record->timeUs[stage] = timeUs;
+        if (stage == LATENCY_STAGE_PRESENT) {
+            for (int span = 0; span < LATENCY_SPANS; span++) {
+                struct latency_histogram *histogram = &tracer->histograms[span];
+                uint64_t spanUs;
+                if (span == LATENCY_SPAN_TOTAL)
+                    spanUs = record->timeUs[LATENCY_STAGE_PRESENT] - record->timeUs[LATENCY_STAGE_INPUT];
+                else
+                    spanUs = record->timeUs[span + 1] - record->timeUs[span];
+                uint32_t bucket = (uint32_t)(spanUs / LATENCY_BUCKET_US);
+                if (bucket >= LATENCY_BUCKETS)
+                    bucket = LATENCY_BUCKETS - 1;
+                histogram->buckets[bucket]++;
+                histogram->count++;
+                histogram->sumUs += spanUs;
+                if (spanUs > histogram->maxUs)
+                    histogram->maxUs = spanUs;
+            }
+            LatencyTraceWriteEvent(tracer, record);
+            tracer->eventsSinceReport++;
+        }
+    }
+
+    tracer->lastId[stage] = lastId;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyTraceUpdate
+    Called after the update loop with the id of the last input event
+    GameUpdate consumed.
+ ----------------------------------------------------------------------------*/
+void LatencyTraceUpdate(struct latency_tracer *tracer, uint32_t lastId, uint64_t timeUs)
+{
+    LatencyTraceMark(tracer, LATENCY_STAGE_UPDATE, lastId, timeUs);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyTraceRender
+    Called after GameRender. The frame shows every event already updated.
+ ----------------------------------------------------------------------------*/
+void LatencyTraceRender(struct latency_tracer *tracer, uint64_t timeUs)
+{
+    LatencyTraceMark(tracer, LATENCY_STAGE_RENDER, tracer->lastId[LATENCY_STAGE_UPDATE], timeUs);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyTracePresent
+    Called once the frame has been handed to the display.
+ ----------------------------------------------------------------------------*/
+void LatencyTracePresent(struct latency_tracer *tracer, uint64_t timeUs)
+{
+    LatencyTraceMark(tracer, LATENCY_STAGE_PRESENT, tracer->lastId[LATENCY_STAGE_RENDER], timeUs);
+    tracer->frame++;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyTraceWriteEvent
+    Write the stages of a completed event to the trace file.
+ ----------------------------------------------------------------------------*/
+void LatencyTraceWriteEvent(struct latency_tracer *tracer, struct latency_record *record)
+{
+    if (!tracer->traceFile)
+        return;
+
+    for (int span = 0; span < LATENCY_SPAN_TOTAL; span++) {
+        fprintf(tracer->traceFile,
+            "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%llu,"
+            "\"args\":{\"id\":%u,\"frame\":%u}}",
+            (tracer->traceEvents > 0) ? ",\n" : "",
+            latency_span_names[span],
+            (unsigned long long)record->timeUs[span],
+            (unsigned long long)(record->timeUs[span + 1] - record->timeUs[span]),
+            record->id,
+            tracer->frame);
+        tracer->traceEvents++;
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyHistogramPercentile
+    Returns the upper bound of the bucket that holds a percentile (0-1),
+    limited to the largest value seen.
+ ----------------------------------------------------------------------------*/
+uint64_t LatencyHistogramPercentile(struct latency_histogram *histogram, float percentile)
+{
+    uint32_t target = (uint32_t)(percentile * histogram->count);
+    uint32_t count = 0;
+
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        count += histogram->buckets[bucket];
+        if (count > target && (uint64_t)(bucket + 1) * LATENCY_BUCKET_US < histogram->maxUs)
+            return (uint64_t)(bucket + 1) * LATENCY_BUCKET_US;
+        if (count > target)
+            return histogram->maxUs;
+    }
+
+    return histogram->maxUs;
+}
+
+/*-----------------------------------------------------------------------------
+    LatencyTraceReport
+    Write a per-stage summary and the end-to-end histogram to a buffer.
+    Returns the number of characters written.
+ ----------------------------------------------------------------------------*/
+int LatencyTraceReport(struct latency_tracer *tracer, char *buffer, int bufferSize)
+{
+    struct latency_histogram *histogram;
+    int length = 0;
+
+    tracer->eventsSinceReport = 0;
+
+    length += snprintf(buffer + length, bufferSize - length,
+        "latency (ms)      events   mean    p50    p95    p99    max\n");
+    for (int span = 0; span < LATENCY_SPANS && length < bufferSize; span++) {
+        histogram = &tracer->histograms[span];
+        if (histogram->count == 0)
+            continue;
+        length += snprintf(buffer + length, bufferSize - length,
+            "%-16s %7u %6.2f %6.2f %6.2f %6.2f %6.2f\n",
+            latency_span_names[span],
+            histogram->count,
+            (float)histogram->sumUs / histogram->count / US_PER_MS,
+            (float)LatencyHistogramPercentile(histogram, 0.50f) / US_PER_MS,
+            (float)LatencyHistogramPercentile(histogram, 0.95f) / US_PER_MS,
+            (float)LatencyHistogramPercentile(histogram, 0.99f) / US_PER_MS,
+            (float)histogram->maxUs / US_PER_MS);
+    }
+
+    histogram = &tracer->histograms[LATENCY_SPAN_TOTAL];
+    for (int bucket = 0; bucket < LATENCY_BUCKETS && length < bufferSize; bucket++) {
+        if (histogram->buckets[bucket] == 0)
+            continue;
+        length += snprintf(buffer + length, bufferSize - length,
+            "%6.2f-%6.2f%s %7u\n",
+            (float)(bucket * LATENCY_BUCKET_US) / US_PER_MS,
+            (float)((bucket + 1) * LATENCY_BUCKET_US) / US_PER_MS,
+            (bucket == LATENCY_BUCKETS - 1) ? "+" : " ",
+            histogram->buckets[bucket]);
+    }
+
+    if (length > bufferSize)
+        length = bufferSize;
+
+    return length;
+}
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*=============================================================================
+    latency.h
+ =============================================================================*/
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdio.h>
+
+/* Must be a power of two so event ids can be masked into the ring. */
+#define LATENCY_RECORDS 1024
+#define LATENCY_RECORDS_MASK (LATENCY_RECORDS - 1)
+#define LATENCY_BUCKET_US 250
+#define LATENCY_BUCKETS 256
+#define LATENCY_REPORT_EVENTS 100
+#define LATENCY_REPORT_SIZE 4096
+
+enum latency_stage {
+    LATENCY_STAGE_INPUT,
+    LATENCY_STAGE_UPDATE,
+    LATENCY_STAGE_RENDER,
+    LATENCY_STAGE_PRESENT,
+    LATENCY_STAGES
+};
+
+/* The spans measured between stages, plus the end-to-end total. */
+enum latency_span {
+    LATENCY_SPAN_INPUT_UPDATE,
+    LATENCY_SPAN_UPDATE_RENDER,
+    LATENCY_SPAN_RENDER_PRESENT,
+    LATENCY_SPAN_TOTAL,
+    LATENCY_SPANS
+};
+
+struct latency_record {
+    uint32_t id;
+    uint64_t timeUs[LATENCY_STAGES];
+};
+
+struct latency_histogram {
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+    uint64_t sumUs;
+    uint64_t maxUs;
+};
+
+/* Follows each input event from the moment the platform sees it until the
+   first frame that shows its effect is presented. Stages are marked in
+   order, so every event up to the newest one that reached a stage is
+   considered to have reached it as well. Not thread safe; all calls are
+   made from the thread that runs the game loop. */
+struct latency_tracer {
+    struct latency_record records[LATENCY_RECORDS];
+    uint32_t lastId[LATENCY_STAGES];
+    uint32_t frame;
+    struct latency_histogram histograms[LATENCY_SPANS];
+    uint32_t eventsSinceReport;
+    FILE *traceFile;
+    uint32_t traceEvents;
+};
+
+void LatencyTraceInit(struct latency_tracer *, const char *);
+void LatencyTraceClose(struct latency_tracer *);
+void LatencyTraceInput(struct latency_tracer *, uint32_t, uint64_t);
+void LatencyTraceMark(struct latency_tracer *, enum latency_stage, uint32_t, uint64_t);
+void LatencyTraceUpdate(struct latency_tracer *, uint32_t, uint64_t);
+void LatencyTraceRender(struct latency_tracer *, uint64_t);
+void LatencyTracePresent(struct latency_tracer *, uint64_t);
+void LatencyTraceWriteEvent(struct latency_tracer *, struct latency_record *);
+int LatencyTraceReport(struct latency_tracer *, char *, int);
+uint64_t LatencyHistogramPercentile(struct latency_histogram *, float);
+
+#endif /* LATENCY_H */
\ No newline at end of file
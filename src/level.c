@@ -0,0 +1,94 @@
+/*=============================================================================
+    level.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "level.h"
+
+/*-----------------------------------------------------------------------------
+    LevelValidate
+    Check that a block of memory holds a level that fits in the game. Only
+    the header is inspected. Returns the level, or NULL if it is invalid.
+ ----------------------------------------------------------------------------*/
+const struct level_header *LevelValidate(const void *memory, uint64_t size)
+{
+    const struct level_header *level = memory;
+
+    if (size < sizeof(struct level_header) || ((uintptr_t)memory & 3) != 0)
+        return NULL;
+    if (level->magic != LEVEL_MAGIC || level->version != LEVEL_VERSION)
+        return NULL;
+    if (level->headerSize < sizeof(struct level_header) || (level->headerSize & 3) != 0)
+        return NULL;
+    if (level->rows == 0 || level->rows > BRICK_ROWS_MAX)
+        return NULL;
+    if (level->columns == 0 || level->columns > BRICK_COLUMNS_MAX)
+        return NULL;
+    if (level->brickWidth == 0 || level->brickHeight == 0)
+        return NULL;
+    if (level->originX + level->columns * level->brickWidth > QVGA_WIDTH)
+        return NULL;
+    if (level->originY + level->rows * level->brickHeight > QVGA_HEIGHT * LEVEL_SCREENS_MAX)
+        return NULL;
+    if (size < level->headerSize + (uint64_t)level->rows * level->columns * sizeof(struct level_cell))
+        return NULL;
+
+    return level;
+}
+
+/*-----------------------------------------------------------------------------
+    LevelPackGet
+    Look up a level in a level pack by index. Returns the level, or NULL if
+    the pack or the level is invalid.
+ ----------------------------------------------------------------------------*/
+const struct level_header *LevelPackGet(const void *memory, uint64_t size, uint32_t index)
+{
+    const struct level_pack_header *pack = memory;
+    const uint64_t *offsets;
+    uint64_t offset;
+
+    if (size < sizeof(struct level_pack_header) || ((uintptr_t)memory & 7) != 0)
+        return NULL;
+    if (pack->magic != LEVEL_PACK_MAGIC || pack->version != LEVEL_VERSION)
+        return NULL;
+    if (pack->headerSize < sizeof(struct level_pack_header) || (pack->headerSize & 7) != 0)
+        return NULL;
+    if (index >= pack->levelCount || size < pack->headerSize + (uint64_t)pack->levelCount * sizeof(uint64_t))
+        return NULL;
+
+    offsets = (const uint64_t *)((const uint8_t *)memory + pack->headerSize);
+    offset = offsets[index];
+    if (offset >= size)
+        return NULL;
+
+    return LevelValidate((const uint8_t *)memory + offset, size - offset);
+}
+
+/*-----------------------------------------------------------------------------
+    LevelLoad
+    Find a level in a mapped file, which may hold a single level or a level
+    pack. The index is only used for packs.
+ ----------------------------------------------------------------------------*/
+const struct level_header *LevelLoad(const void *memory, uint64_t size, uint32_t index)
+{
+    if (size >= sizeof(uint32_t) && *(const uint32_t *)memory == LEVEL_PACK_MAGIC)
+        return LevelPackGet(memory, size, index);
+
+    return LevelValidate(memory, size);
+}
+
+/*-----------------------------------------------------------------------------
+    LevelCell
+    Returns the cell at a row and column of a validated level.
+ ----------------------------------------------------------------------------*/
+const struct level_cell *LevelCell(const struct level_header *level, int row, int column)
+{
+    const struct level_cell *cells;
+
+    cells = (const struct level_cell *)((const uint8_t *)level + level->headerSize);
+
+    return &cells[row * level->columns + column];
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+/*=============================================================================
+    level.h
+ =============================================================================*/
+
+#ifndef LEVEL_H
+#define LEVEL_H
+
+/* Level files are meant to be memory mapped and used in place, so every
+   field is fixed size, naturally aligned and little-endian. A level is a
+   level_header followed by rows * columns level_cells in row-major order,
+   starting with the bottom row. A level pack is a level_pack_header,
+   followed by levelCount 64-bit offsets (from the start of the pack) to
+   levels stored back to back. Only the headers are checked on load; cells
+   are read as they are used. A level must fit across the screen, but may
+   be taller than it. */
+#define LEVEL_MAGIC 0x4C4B4C42 /* "BLKL" */
+#define LEVEL_PACK_MAGIC 0x504B4C42 /* "BLKP" */
+#define LEVEL_VERSION 1
+/* Levels taller than the screen scroll, up to this many screens. */
+#define LEVEL_SCREENS_MAX 32
+
+enum brick_type {
+    BRICK_TYPE_NONE,
+    BRICK_TYPE_NORMAL,
+    BRICK_TYPE_SOLID
+};
+
+struct level_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint16_t rows;
+    uint16_t columns;
+    uint16_t brickWidth;
+    uint16_t brickHeight;
+    uint16_t originX;
+    uint16_t originY;
+    uint32_t reserved;
+};
+
+struct level_cell {
+    uint8_t type;
+    uint8_t color;
+    uint8_t hitPoints;
+    uint8_t flags;
+};
+
+struct level_pack_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    uint32_t levelCount;
+    uint32_t reserved;
+};
+
+const struct level_header *LevelValidate(const void *, uint64_t);
+const struct level_header *LevelPackGet(const void *, uint64_t, uint32_t);
+const struct level_header *LevelLoad(const void *, uint64_t, uint32_t);
+const struct level_cell *LevelCell(const struct level_header *, int, int);
+
+#endif /* LEVEL_H */
\ No newline at end of file
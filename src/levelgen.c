@@ -0,0 +1,282 @@
+/*=============================================================================
+    levelgen.c
+    Levels made from a seed, and a way to tell how hard they are: each is
+    played a number of times by a simple scripted player, headless and as
+    fast as the simulation allows.
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "game.h"
+#include "level.h"
+#include "levelgen.h"
+#include "bricks.h"
+#include "simulate.h"
+
+/*-----------------------------------------------------------------------------
+    LevelGenerate
+    Make a level from a seed in memory of LEVELGEN_SIZE_MAX bytes, aligned
+    to 8 bytes. The seed picks the grid, the pattern the bricks are laid
+    out in, how many take more than one hit and how many are solid; the
+    layout is mirrored left to right. The same seed always makes the same
+    level. Returns the level.
+ ----------------------------------------------------------------------------*/
+const struct level_header *LevelGenerate(void *memory, uint32_t seed)
+{
+    static const int columnChoices[] = {8, 10, 16, 20};
+    struct level_header *level = memory;
+    struct level_cell *cells, *cell;
+    enum levelgen_pattern pattern;
+    uint32_t random = (seed * 0x9E3779B1u) ^ 0x5BD1E995u;
+    int rows, columns, originRange, bricks;
+    float density, multiHit, solid;
+
+    /* xorshift never leaves zero. */
+    if (random == 0)
+        random = 1;
+
+    pattern = (enum levelgen_pattern)(LevelRandom(&random) % NUM_LEVELGEN_PATTERNS);
+    rows = LEVELGEN_ROWS_MIN + (int)(LevelRandom(&random) % (LEVELGEN_ROWS_MAX - LEVELGEN_ROWS_MIN + 1));
+    columns = columnChoices[LevelRandom(&random) % (sizeof(columnChoices) / sizeof(columnChoices[0]))];
+    density = 0.5f + 0.45f * LevelRandomUnit(&random);
+    multiHit = 0.4f * LevelRandomUnit(&random);
+    solid = 0.08f * LevelRandomUnit(&random);
+    originRange = QVGA_HEIGHT - LEVELGEN_TOP_MARGIN - rows * LEVELGEN_BRICK_HEIGHT - LEVELGEN_ORIGIN_Y_MIN + 1;
+
+    memset(memory, 0, LEVELGEN_SIZE_MAX);
+    level->magic = LEVEL_MAGIC;
+    level->version = LEVEL_VERSION;
+    level->headerSize = sizeof(struct level_header);
+    level->rows = (uint16_t)rows;
+    level->columns = (uint16_t)columns;
+    level->brickWidth = (uint16_t)(QVGA_WIDTH / columns);
+    level->brickHeight = LEVELGEN_BRICK_HEIGHT;
+    level->originX = 0;
+    level->originY = (uint16_t)(LEVELGEN_ORIGIN_Y_MIN + (int)(LevelRandom(&random) % originRange));
+
+    cells = (struct level_cell *)((uint8_t *)memory + level->headerSize);
+    bricks = 0;
+    for (int row = 0; row < rows; row++) {
+        for (int column = 0; column < (columns + 1) / 2; column++) {
+            cell = &cells[row * columns + column];
+            if (LevelGenerateCell(pattern, row, column, rows, columns, density, &random)) {
+                cell->type = (LevelRandomUnit(&random) < solid) ? BRICK_TYPE_SOLID : BRICK_TYPE_NORMAL;
+                cell->color = (uint8_t)(row % NUM_BRICK_COLORS);
+                cell->hitPoints = 1;
+                if (LevelRandomUnit(&random) < multiHit)
+                    cell->hitPoints += 1 + (uint8_t)(LevelRandom(&random) % (LEVELGEN_HIT_POINTS_MAX - 1));
+                bricks += (cell->type == BRICK_TYPE_NORMAL);
+            }
+            cells[row * columns + columns - 1 - column] = *cell;
+        }
+    }
+
+    /* Every level has something to break. */
+    if (bricks == 0) {
+        cells[0].type = BRICK_TYPE_NORMAL;
+        cells[0].hitPoints = 1;
+    }
+
+    return level;
+}
+
+/*-----------------------------------------------------------------------------
+    LevelGenerateCell
+    Returns true if a pattern has a brick at a row and column of the left
+    half of a grid. Rows count from the bottom.
+ ----------------------------------------------------------------------------*/
+bool LevelGenerateCell(enum levelgen_pattern pattern, int row, int column, int rows, int columns, float density, uint32_t *random)
+{
+    int fromCenter;
+
+    switch (pattern) {
+    case LEVELGEN_PATTERN_CHECKER:
+        return ((row + column) & 1) == 0;
+    case LEVELGEN_PATTERN_PYRAMID:
+        /* Widest at the bottom. */
+        fromCenter = (columns - 1) / 2 - column;
+        return fromCenter * rows < (rows - row) * ((columns + 1) / 2);
+    case LEVELGEN_PATTERN_STRIPES:
+        return (row & 1) == 0;
+    case LEVELGEN_PATTERN_SCATTER:
+        return LevelRandomUnit(random) < density;
+    default:
+        return true;
+    }
+}
+
+/*-----------------------------------------------------------------------------
+    LevelRandom
+    Returns the next number from an xorshift generator.
+ ----------------------------------------------------------------------------*/
+uint32_t LevelRandom(uint32_t *random)
+{
+    *random ^= *random << 13;
+    *random ^= *random >> 17;
+    *random ^= *random << 5;
+
+    return *random;
+}
+
+/*-----------------------------------------------------------------------------
+    LevelRandomUnit
+    Returns the next number in [0, 1) from an xorshift generator.
+ ----------------------------------------------------------------------------*/
+float LevelRandomUnit(uint32_t *random)
+{
+    return (float)(LevelRandom(random) >> 8) * (1.0f / 16777216.0f);
+}
+
+/*-----------------------------------------------------------------------------
+    LevelSize
+    Returns the size of a level's header and cells.
+ ----------------------------------------------------------------------------*/
+uint64_t LevelSize(const struct level_header *level)
+{
+    return level->headerSize + (uint64_t)level->rows * level->columns * sizeof(struct level_cell);
+}
+
+/*-----------------------------------------------------------------------------
+    LevelEvaluate
+    Play a level a number of times, each with a differently seeded player
+    and for at most a number of ticks, and sum up how it went. The game
+    state needs its own bricks but nothing else, though it is played by
+    its rules if it has any; it is left as the last play ended.
+ ----------------------------------------------------------------------------*/
+void LevelEvaluate(struct level_evaluation *evaluation, struct game_state *gameState, const struct level_header *level,
+    int plays, int ticksMax, float deltaTimeMs)
+{
+    int ticks, livesLost;
+
+    evaluation->rows = level->rows;
+    evaluation->columns = level->columns;
+    evaluation->bricks = 0;
+    for (int row = 0; row < level->rows; row++) {
+        for (int column = 0; column < level->columns; column++)
+            evaluation->bricks += (LevelCell(level, row, column)->type == BRICK_TYPE_NORMAL);
+    }
+    evaluation->plays = plays;
+    evaluation->cleared = 0;
+    evaluation->livesLost = 0;
+    evaluation->ticksToClear = 0;
+
+    for (int play = 0; play < plays; play++) {
+        if (LevelPlay(gameState, level, evaluation->seed * 0x9E3779B1u + (uint32_t)play * 0x85EBCA6Bu + 1,
+                ticksMax, deltaTimeMs, &ticks, &livesLost)) {
+            evaluation->cleared++;
+            evaluation->ticksToClear += ticks;
+        }
+        evaluation->livesLost += livesLost;
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    LevelPlay
+    Play a level from the start until it is cleared, the last life is
+    lost or a number of ticks have passed. The player moves the paddle
+    under the ball, aiming a little to one side or the other, chosen again
+    every time the ball leaves the paddle. Between decisions the game
+    fast forwards. Returns true if the level was cleared, with the ticks it
+    took and the lives lost on the way.
+ ----------------------------------------------------------------------------*/
+bool LevelPlay(struct game_state *gameState, const struct level_header *level, uint32_t seed, int ticksMax,
+    float deltaTimeMs, int *ticks, int *livesLost)
+{
+    uint32_t random = seed ? seed : 1;
+    uint32_t games;
+    int lives, score;
+    float aim = 0.0f, distance;
+    bool ballRising = false, left, right;
+
+    for (int key = 0; key < NUM_KEYS; key++)
+        gameState->keyboard[key] = false;
+    GameInit(gameState, level);
+    games = gameState->games;
+    lives = gameState->lives;
+    score = gameState->score;
+    *livesLost = 0;
+
+    for (*ticks = 0; *ticks < ticksMax; *ticks += LEVEL_PLAY_DECISION_TICKS) {
+        distance = (gameState->ball.rect.position.x + BALL_WIDTH / 2.0f + aim)
+            - (gameState->paddle.rect.position.x + gameState->rules->paddleWidth / 2.0f);
+        left = distance < -LEVEL_PLAY_DEAD_BAND;
+        right = distance > LEVEL_PLAY_DEAD_BAND;
+        if (gameState->keyboard[GAME_KEY_LEFT] != left)
+            GameApplyKey(gameState, GAME_KEY_LEFT, left);
+        if (gameState->keyboard[GAME_KEY_RIGHT] != right)
+            GameApplyKey(gameState, GAME_KEY_RIGHT, right);
+
+        GameFastForward(deltaTimeMs, gameState, LEVEL_PLAY_DECISION_TICKS);
+
+        if (gameState->games != games) {
+            *livesLost = gameState->rules->lives + 1;
+            return false;
+        }
+        if (gameState->lives < lives) {
+            *livesLost += lives - gameState->lives;
+            lives = gameState->lives;
+        }
+        if (gameState->score != score) {
+            score = gameState->score;
+            if (LevelBricksLeft(&gameState->bricks) == 0) {
+                *ticks += LEVEL_PLAY_DECISION_TICKS;
+                return true;
+            }
+        }
+
+        if (!ballRising && gameState->ball.velocity.y > 0.0f)
+            aim = (LevelRandomUnit(&random) * 2.0f - 1.0f) * LevelPlayAimSpread(gameState->rules->paddleWidth);
+        ballRising = gameState->ball.velocity.y > 0.0f;
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------------------------
+    LevelBricksLeft
+    Returns how many bricks are left to break. Solid bricks never break,
+    so they are not counted.
+ ----------------------------------------------------------------------------*/
+int LevelBricksLeft(const struct brick_set *brickSet)
+{
+    int brickCount = brickSet->base->rows * brickSet->base->columns;
+    int bricksLeft = 0;
+
+    for (int brickIndex = 0; brickIndex < brickCount; brickIndex++) {
+        if (brickSet->base->bricks[brickIndex].type != BRICK_TYPE_SOLID && !BrickIsBroken(brickSet, brickIndex))
+            bricksLeft++;
+    }
+
+    return bricksLeft;
+}
+
+/*-----------------------------------------------------------------------------
+    LevelEvaluationCompare
+    Order evaluations from the easiest level to the hardest, for qsort: the
+    most often cleared first, then the quickest to clear, then the fewest
+    lives lost. Evaluations must be of the same number of plays.
+ ----------------------------------------------------------------------------*/
+int LevelEvaluationCompare(const void *elementA, const void *elementB)
+{
+    const struct level_evaluation *evaluationA = elementA;
+    const struct level_evaluation *evaluationB = elementB;
+    uint64_t ticksA, ticksB;
+
+    if (evaluationA->cleared != evaluationB->cleared)
+        return (evaluationA->cleared > evaluationB->cleared) ? -1 : 1;
+
+    /* Mean ticks to clear, compared without dividing. */
+    ticksA = evaluationA->ticksToClear * (uint64_t)(evaluationB->cleared ? evaluationB->cleared : 1);
+    ticksB = evaluationB->ticksToClear * (uint64_t)(evaluationA->cleared ? evaluationA->cleared : 1);
+    if (ticksA != ticksB)
+        return (ticksA < ticksB) ? -1 : 1;
+
+    if (evaluationA->livesLost != evaluationB->livesLost)
+        return (evaluationA->livesLost < evaluationB->livesLost) ? -1 : 1;
+
+    return (evaluationA->index < evaluationB->index) ? -1 : (evaluationA->index > evaluationB->index);
+}
\ No newline at end of file
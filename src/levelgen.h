@@ -0,0 +1,71 @@
+/*=============================================================================
+    levelgen.h
+ =============================================================================*/
+
+#ifndef LEVELGEN_H
+#define LEVELGEN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "level.h"
+
+/* Generated levels are one screen, a few rows below the score and lives,
+   in grids whose bricks span the screen exactly. */
+#define LEVELGEN_ROWS_MIN 3
+#define LEVELGEN_ROWS_MAX 12
+#define LEVELGEN_COLUMNS_MAX 20
+#define LEVELGEN_BRICK_HEIGHT 8
+#define LEVELGEN_ORIGIN_Y_MIN 96
+#define LEVELGEN_TOP_MARGIN 24
+#define LEVELGEN_HIT_POINTS_MAX 3
+/* Room for any generated level, a multiple of 8 so levels can be packed
+   back to back. */
+#define LEVELGEN_SIZE_MAX ((sizeof(struct level_header) \
+    + LEVELGEN_ROWS_MAX * LEVELGEN_COLUMNS_MAX * sizeof(struct level_cell) + 7) & ~(size_t)7)
+
+/* The evaluating player steers every few ticks, towards a point on the
+   paddle it picks at random after every return, so each play of a level
+   goes differently and some balls are missed. */
+#define LEVEL_PLAY_DECISION_TICKS 6
+#define LevelPlayAimSpread(paddleWidth) (((paddleWidth) + BALL_WIDTH) * 0.45f)
+#define LEVEL_PLAY_DEAD_BAND 2.0f
+
+enum levelgen_pattern {
+    LEVELGEN_PATTERN_FULL,
+    LEVELGEN_PATTERN_CHECKER,
+    LEVELGEN_PATTERN_PYRAMID,
+    LEVELGEN_PATTERN_STRIPES,
+    LEVELGEN_PATTERN_SCATTER,
+    NUM_LEVELGEN_PATTERNS
+};
+
+/* How a level fared over a number of plays. Ticks to clear are summed over
+   the plays that cleared it, lives lost over all of them; a play that
+   runs out of lives loses one more than it started with. */
+struct level_evaluation {
+    uint32_t index;
+    uint32_t seed;
+    int rows;
+    int columns;
+    int bricks;
+    int plays;
+    int cleared;
+    int livesLost;
+    uint64_t ticksToClear;
+};
+
+struct game_state;
+struct brick_set;
+
+const struct level_header *LevelGenerate(void *, uint32_t);
+bool LevelGenerateCell(enum levelgen_pattern, int, int, int, int, float, uint32_t *);
+uint32_t LevelRandom(uint32_t *);
+float LevelRandomUnit(uint32_t *);
+uint64_t LevelSize(const struct level_header *);
+void LevelEvaluate(struct level_evaluation *, struct game_state *, const struct level_header *, int, int, float);
+bool LevelPlay(struct game_state *, const struct level_header *, uint32_t, int, float, int *, int *);
+int LevelBricksLeft(const struct brick_set *);
+int LevelEvaluationCompare(const void *, const void *);
+
+#endif /* LEVELGEN_H */
\ No newline at end of file
@@ -0,0 +1,150 @@
+/*=============================================================================
+    blocks.h
+    The game as a library, for programs that drive it rather than play it,
+    such as training scripts. The library never allocates: the caller
+    hands it a block of memory of BlocksMemorySize bytes and frees it when
+    done. The state and the frame are kept in that memory, at addresses
+    that never change, and are updated in place by BlocksStep and
+    BlocksRender, so a caller can wrap them (e.g. as NumPy arrays) once and
+    read them after every step without copying or converting anything.
+
+    Games run side by side on many threads can each count what happens in
+    play, and merge their counts into one total when they like. The merge
+    takes no lock, so threads never wait on each other for it.
+
+    Every type in the interface has a fixed size, and the interface only
+    changes with BLOCKS_ABI_VERSION. A caller passes the version it was
+    built against in its configuration and is refused by any other.
+ =============================================================================*/
+
+#ifndef BLOCKS_H
+#define BLOCKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32) && defined(BLOCKS_BUILD)
+    #define BLOCKS_API __declspec(dllexport)
+#elif defined(_WIN32) && !defined(BLOCKS_STATIC)
+    #define BLOCKS_API __declspec(dllimport)
+#elif defined(__GNUC__)
+    #define BLOCKS_API __attribute__((visibility("default")))
+#else
+    #define BLOCKS_API
+#endif
+
+#define BLOCKS_ABI_VERSION 3
+
+#define BLOCKS_UPDATES_PER_SECOND 60
+#define BLOCKS_BRICKS_MAX 9600
+#define BLOCKS_FRAME_SIZE_MAX 4096
+#define BLOCKS_PALETTE_SIZE 16
+#define BLOCKS_BRICK_ROWS_MAX 240
+#define BLOCKS_BRICK_COLUMNS_MAX 40
+#define BLOCKS_TELEMETRY_GAME_TICKS_BUCKETS 32
+#define BLOCKS_TELEMETRY_PADDLE_BUCKETS 72
+#define BLOCKS_TELEMETRY_LIFE_BUCKETS 320
+
+/* Keys held through a step, as bits. */
+#define BLOCKS_ACTION_LEFT 0x1
+#define BLOCKS_ACTION_RIGHT 0x2
+
+/* Frames are only rendered if they have a size. The level is a level file
+   or level pack, which must stay in memory as long as the game; without
+   one the built in layout is used. Particles are only simulated when
+   frames are rendered, and make every step a tick at a time. With
+   telemetry the game counts what happens in play, for
+   BlocksTelemetryMerge. */
+struct blocks_config {
+    uint32_t abiVersion;
+    int32_t frameWidth;
+    int32_t frameHeight;
+    int32_t sprites;
+    int32_t particles;
+    uint32_t seed;
+    const void *level;
+    uint64_t levelSize;
+    uint32_t levelIndex;
+    int32_t telemetry;
+};
+
+/* The state of the game, flattened to 32 bit fields. Positions are in game
+   pixels, 320 by 240, from the bottom left. games counts the games
+   started, so it changes when a game ends, and scoreFinal is the score the
+   last game ended with. hitPoints has brickRows * brickColumns entries,
+   row by row from the bottom; a brick with none left is broken. Levels
+   taller than the screen scroll: cameraY is how far the screen has
+   scrolled up the level, so a brick in row r is drawn cameraY lower than
+   a screen's level would draw it. */
+struct blocks_state {
+    uint32_t tick;
+    uint32_t games;
+    int32_t paused;
+    float countdown;
+    int32_t lives;
+    int32_t score;
+    int32_t scoreFinal;
+    float ballX;
+    float ballY;
+    float ballVelocityX;
+    float ballVelocityY;
+    float paddleX;
+    float paddleY;
+    float cameraY;
+    int32_t brickRows;
+    int32_t brickColumns;
+    int32_t bricksLeft;
+    int32_t hitPoints[BLOCKS_BRICKS_MAX];
+};
+
+/* The last frame rendered. pixels holds 4 bytes a pixel in B, G, R, X
+   order and indices the palette index of every pixel, without sprites;
+   both have the bottom row first. palette maps indices to pixels. */
+struct blocks_frame {
+    const uint8_t *pixels;
+    const uint8_t *indices;
+    const uint32_t *palette;
+    int32_t width;
+    int32_t height;
+    int32_t pitch;
+    uint32_t tick;
+};
+
+/* Counts of what happened in play. gameTicks counts the games that ended
+   by their length in ticks, a power of two to a bucket, so bucket n holds
+   games of 2^n up to 2^(n+1) ticks. paddleHits counts bounces off the top
+   of the paddle by where the ball struck, one pixel to a bucket from the
+   right end, ball included; the dead zone is buckets 20 to 51. livesLost
+   counts lives by where the ball left the screen, one pixel to a bucket,
+   and brickHits counts hits on every brick by row (from the bottom) and
+   column. */
+struct blocks_telemetry {
+    uint64_t ticks;
+    uint64_t gamesEnded;
+    uint64_t gameTicks[BLOCKS_TELEMETRY_GAME_TICKS_BUCKETS];
+    uint64_t paddleHits[BLOCKS_TELEMETRY_PADDLE_BUCKETS];
+    uint64_t livesLost[BLOCKS_TELEMETRY_LIFE_BUCKETS];
+    uint64_t brickHits[BLOCKS_BRICK_ROWS_MAX][BLOCKS_BRICK_COLUMNS_MAX];
+};
+
+struct blocks;
+
+BLOCKS_API uint32_t BlocksAbiVersion(void);
+BLOCKS_API size_t BlocksMemorySize(const struct blocks_config *);
+BLOCKS_API struct blocks *BlocksCreate(void *, size_t, const struct blocks_config *);
+BLOCKS_API void BlocksReset(struct blocks *);
+BLOCKS_API int32_t BlocksStep(struct blocks *, uint32_t, int32_t);
+BLOCKS_API const struct blocks_frame *BlocksRender(struct blocks *);
+BLOCKS_API const struct blocks_state *BlocksState(const struct blocks *);
+BLOCKS_API void BlocksTelemetryMerge(struct blocks *, struct blocks_telemetry *);
+BLOCKS_API int32_t BlocksTelemetryWrite(const struct blocks_telemetry *, const char *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOCKS_H */
\ No newline at end of file
@@ -0,0 +1,359 @@
+/*=============================================================================
+    blocks_lib.c
+    The game built as a shared or static library with a C interface; see
+    blocks.h. Nothing here is platform specific: the library has no window,
+    no sound and no clock, and the caller decides when time passes.
+ =============================================================================*/
+
+#define BLOCKS_BUILD
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "blocks_lib.h"
+
+#include "../atomic.c"
+#include "../input.c"
+#include "../text.c"
+#include "../palette.c"
+#include "../render.c"
+#include "../sprite.c"
+#include "../particles.c"
+#include "../audio.c"
+#include "../level.c"
+#include "../memory.c"
+#include "../game.c"
+#include "../rules.c"
+#include "../bricks.c"
+#include "../simulate.c"
+#include "../kernels.c"
+#include "../telemetry.c"
+
+#if BLOCKS_BRICKS_MAX != BRICK_CAPACITY_MAX || BLOCKS_PALETTE_SIZE != PALETTE_SIZE \
+    || BLOCKS_BRICK_ROWS_MAX != BRICK_ROWS_MAX || BLOCKS_BRICK_COLUMNS_MAX != BRICK_COLUMNS_MAX
+    #error "blocks.h is out of step with the game"
+#endif
+
+/* The public telemetry is the game's own counters, field for field. */
+#if BLOCKS_TELEMETRY_GAME_TICKS_BUCKETS != TELEMETRY_GAME_TICKS_BUCKETS \
+    || BLOCKS_TELEMETRY_PADDLE_BUCKETS != TELEMETRY_PADDLE_BUCKETS \
+    || BLOCKS_TELEMETRY_LIFE_BUCKETS != TELEMETRY_LIFE_BUCKETS
+    #error "blocks.h is out of step with the game's telemetry"
+#endif
+
+/*-----------------------------------------------------------------------------
+    BlocksAbiVersion
+    Returns the version of the interface the library was built with.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API uint32_t BlocksAbiVersion(void)
+{
+    return BLOCKS_ABI_VERSION;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksMemorySize
+    Returns how many bytes of memory a game with a configuration needs, or
+    0 if the configuration is not valid for this library.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API size_t BlocksMemorySize(const struct blocks_config *config)
+{
+    if (!BlocksConfigValid(config))
+        return 0;
+
+    /* The caller's memory may start anywhere. */
+    return ARENA_ALIGNMENT + ARENA_SIZE(sizeof(struct blocks))
+        + BlocksPermanentSize(config) + ARENA_SIZE(sizeof(struct render_list));
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksCreate
+    Start a game in a block of the caller's memory, at least as big as
+    BlocksMemorySize. Nothing else is allocated, so the game is done with
+    when the memory is freed. Returns NULL if the configuration is not
+    valid or the memory is too small.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API struct blocks *BlocksCreate(void *memory, size_t memorySize, const struct blocks_config *config)
+{
+    struct blocks *blocks;
+    struct memory_arena arena;
+    size_t permanentSize = BlocksPermanentSize(config);
+    size_t frameSize;
+
+    if (!memory || BlocksMemorySize(config) == 0 || memorySize < BlocksMemorySize(config))
+        return NULL;
+
+    /* Align the start, then split the memory after the library's own
+       struct into the permanent and transient regions. */
+    ArenaInit(&arena, (uint8_t *)memory + (ARENA_ALIGNMENT - (uintptr_t)memory % ARENA_ALIGNMENT) % ARENA_ALIGNMENT,
+        memorySize - ARENA_ALIGNMENT);
+    blocks = ArenaPush(&arena, sizeof(struct blocks));
+    memset(blocks, 0, sizeof(struct blocks));
+    ArenaInit(&blocks->permanent, ArenaPush(&arena, permanentSize), permanentSize);
+    ArenaInit(&blocks->transient, ArenaPush(&arena, sizeof(struct render_list)), sizeof(struct render_list));
+
+    blocks->level = NULL;
+    if (config->level) {
+        blocks->level = LevelLoad(config->level, config->levelSize, config->levelIndex);
+        if (!blocks->level)
+            return NULL;
+    }
+    blocks->seed = config->seed;
+
+    blocks->gameState = ArenaPush(&blocks->permanent, sizeof(struct game_state));
+    memset(blocks->gameState, 0, sizeof(struct game_state));
+    BrickSetInit(&blocks->gameState->bricks, ArenaPush(&blocks->permanent, BrickBaseSize(BRICK_CAPACITY_MAX)), BRICK_CAPACITY_MAX);
+    if (config->telemetry)
+        blocks->gameState->telemetry = TelemetryInit(ArenaPush(&blocks->permanent, TELEMETRY_MEMORY_SIZE));
+
+    /* Frames are expanded to pixels as if they were presented. */
+    if (config->frameWidth > 0) {
+        if (config->particles)
+            blocks->gameState->particles = ArenaPush(&blocks->permanent, sizeof(struct particle_system));
+        frameSize = (size_t)config->frameWidth * config->frameHeight;
+        blocks->gameBitmapBuffer.memory = ArenaPush(&blocks->permanent, frameSize);
+        blocks->gameBitmapBuffer.memorySize = (int)frameSize;
+        blocks->gameBitmapBuffer.width = config->frameWidth;
+        blocks->gameBitmapBuffer.height = config->frameHeight;
+        blocks->gameBitmapBuffer.pitch = config->frameWidth;
+        blocks->frameBitmapBuffer.memory = ArenaPush(&blocks->permanent, frameSize * BYTES_PER_PIXEL);
+        blocks->frameBitmapBuffer.memorySize = (int)(frameSize * BYTES_PER_PIXEL);
+        blocks->frameBitmapBuffer.width = config->frameWidth;
+        blocks->frameBitmapBuffer.height = config->frameHeight;
+        blocks->frameBitmapBuffer.pitch = config->frameWidth * BYTES_PER_PIXEL;
+        memset(blocks->gameBitmapBuffer.memory, 0, frameSize);
+        memset(blocks->frameBitmapBuffer.memory, 0, frameSize * BYTES_PER_PIXEL);
+        PaletteInit(&blocks->palette, PIXEL_FORMAT_BGRX);
+        if (config->sprites) {
+            blocks->spriteAtlas = ArenaPush(&blocks->permanent, sizeof(struct sprite_atlas));
+            SpriteAtlasInit(blocks->spriteAtlas, &blocks->palette);
+        }
+        blocks->frame.pixels = blocks->frameBitmapBuffer.memory;
+        blocks->frame.indices = blocks->gameBitmapBuffer.memory;
+        blocks->frame.palette = blocks->palette.colors;
+        blocks->frame.width = config->frameWidth;
+        blocks->frame.height = config->frameHeight;
+        blocks->frame.pitch = blocks->frameBitmapBuffer.pitch;
+    }
+
+    BlocksReset(blocks);
+
+    return blocks;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksReset
+    Start a new game on the same level. The tick and game counts carry on,
+    as does the telemetry, but the game given up is not counted as ended.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API void BlocksReset(struct blocks *blocks)
+{
+    struct game_state *gameState = blocks->gameState;
+
+    if (gameState->particles)
+        ParticleSystemInit(gameState->particles, blocks->seed);
+    if (gameState->telemetry)
+        gameState->telemetry->gameTicks = 0;
+    for (int key = 0; key < NUM_KEYS; key++)
+        gameState->keyboard[key] = false;
+    GameInit(gameState, blocks->level);
+    BlocksUpdateState(blocks, true);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksStep
+    Advance the game by a number of ticks with a set of keys held. Quiet
+    stretches are jumped over as the headless runner does. The step ends
+    early when a game ends, so the next game never starts with the last
+    one's keys. Returns the number of ticks stepped.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API int32_t BlocksStep(struct blocks *blocks, uint32_t actions, int32_t ticks)
+{
+    struct game_state *gameState = blocks->gameState;
+    uint32_t games = gameState->games;
+    int32_t stepped = 0;
+    int quietTicks, score;
+    bool left = (actions & BLOCKS_ACTION_LEFT) != 0;
+    bool right = (actions & BLOCKS_ACTION_RIGHT) != 0;
+
+    if (gameState->keyboard[GAME_KEY_LEFT] != left)
+        GameApplyKey(gameState, GAME_KEY_LEFT, left);
+    if (gameState->keyboard[GAME_KEY_RIGHT] != right)
+        GameApplyKey(gameState, GAME_KEY_RIGHT, right);
+
+    while (stepped < ticks && gameState->games == games) {
+        quietTicks = GameQuietTicks(MS_PER_UPDATE, gameState, ticks - stepped);
+        if (quietTicks > 0) {
+            GameSkipTicks(MS_PER_UPDATE, gameState, quietTicks);
+            stepped += quietTicks;
+        }
+        else {
+            score = gameState->score;
+            GameUpdate(MS_PER_UPDATE, gameState, NULL);
+            stepped++;
+            if (gameState->games != games)
+                blocks->state.scoreFinal = score;
+        }
+    }
+
+    blocks->state.tick += (uint32_t)stepped;
+    BlocksUpdateState(blocks, gameState->games != games);
+
+    return stepped;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksRender
+    Render the game as it is now into the frame. Returns the frame, or NULL
+    if the game was configured without frames.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API const struct blocks_frame *BlocksRender(struct blocks *blocks)
+{
+    struct render_list *renderList;
+
+    if (!blocks->frame.pixels)
+        return NULL;
+
+    ArenaReset(&blocks->transient);
+    renderList = ArenaPush(&blocks->transient, sizeof(struct render_list));
+    GameRender(blocks->gameState, renderList);
+    RenderFrame(NULL, renderList, &blocks->gameBitmapBuffer, &blocks->palette, blocks->spriteAtlas, &blocks->frameBitmapBuffer);
+    blocks->gameState->frameChanged = false;
+    blocks->frame.tick = blocks->state.tick;
+
+    return &blocks->frame;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksState
+    Returns the game's state. It stays at the same address for the life of
+    the game and is brought up to date by every step and reset.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API const struct blocks_state *BlocksState(const struct blocks *blocks)
+{
+    return &blocks->state;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksTelemetryMerge
+    Add the game's telemetry into a total and start counting again from
+    zero. Call it from the thread that steps the game. Games on any number
+    of threads can merge into the same total at once; the total must be
+    zeroed before the first merge and 8 byte aligned. Does nothing if the
+    game was configured without telemetry.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API void BlocksTelemetryMerge(struct blocks *blocks, struct blocks_telemetry *total)
+{
+    if (blocks->gameState->telemetry)
+        TelemetryMerge((struct telemetry_counters *)total, blocks->gameState->telemetry);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksTelemetryWrite
+    Write a total to a telemetry file, one column per field with the brick
+    grid cut down to the bricks that were hit; see telemetry.h. Returns 1
+    on success and 0 on failure.
+ ----------------------------------------------------------------------------*/
+BLOCKS_API int32_t BlocksTelemetryWrite(const struct blocks_telemetry *total, const char *path)
+{
+    return TelemetryWrite(path, (const struct telemetry_counters *)total) ? 1 : 0;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksConfigValid
+    Returns false if a configuration is for another version of the
+    interface, or has a frame size the library cannot render.
+ ----------------------------------------------------------------------------*/
+bool BlocksConfigValid(const struct blocks_config *config)
+{
+    if (!config || config->abiVersion != BLOCKS_ABI_VERSION)
+        return false;
+
+    if (config->frameWidth == 0 && config->frameHeight == 0)
+        return true;
+
+    return config->frameWidth > 0 && config->frameWidth <= BLOCKS_FRAME_SIZE_MAX
+        && config->frameHeight > 0 && config->frameHeight <= BLOCKS_FRAME_SIZE_MAX;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksPermanentSize
+    Returns the size of everything that lives as long as the game.
+ ----------------------------------------------------------------------------*/
+size_t BlocksPermanentSize(const struct blocks_config *config)
+{
+    size_t frameSize = (size_t)config->frameWidth * config->frameHeight;
+    size_t size = ARENA_SIZE(sizeof(struct game_state))
+        + ARENA_SIZE(BrickBaseSize(BRICK_CAPACITY_MAX));
+
+    if (config->telemetry)
+        size += ARENA_SIZE(TELEMETRY_MEMORY_SIZE);
+
+    if (frameSize > 0) {
+        size += ARENA_SIZE(frameSize) + ARENA_SIZE(frameSize * BYTES_PER_PIXEL);
+        if (config->particles)
+            size += ARENA_SIZE(sizeof(struct particle_system));
+        if (config->sprites)
+            size += ARENA_SIZE(sizeof(struct sprite_atlas));
+    }
+
+    return size;
+}
+
+/*-----------------------------------------------------------------------------
+    BlocksUpdateState
+    Copy the game state into the flat state the caller reads. The ball
+    never leaves the screen, so after a step only the bricks that were in
+    view at some point can have changed: those from the bottom of the
+    screen before the step to its top after it, as the camera only rises.
+    Every brick is copied for a new game.
+ ----------------------------------------------------------------------------*/
+void BlocksUpdateState(struct blocks *blocks, bool everyBrick)
+{
+    const struct game_state *gameState = blocks->gameState;
+    const struct brick_set *brickSet = &gameState->bricks;
+    struct blocks_state *state = &blocks->state;
+    int brickFirst = 0, brickEnd = 0, rowFirst, rowLast;
+    int hitPoints;
+    bool breakable;
+
+    state->games = gameState->games;
+    state->paused = gameState->paused || gameState->pausedUser;
+    state->countdown = gameState->countdown;
+    state->lives = gameState->lives;
+    state->score = gameState->score;
+    state->ballX = gameState->ball.rect.position.x;
+    state->ballY = gameState->ball.rect.position.y;
+    state->ballVelocityX = gameState->ball.velocity.x;
+    state->ballVelocityY = gameState->ball.velocity.y;
+    state->paddleX = gameState->paddle.rect.position.x;
+    state->paddleY = gameState->paddle.rect.position.y;
+    state->cameraY = gameState->cameraY;
+    state->brickRows = brickSet->base->rows;
+    state->brickColumns = brickSet->base->columns;
+
+    if (everyBrick) {
+        brickEnd = brickSet->base->rows * brickSet->base->columns;
+        state->bricksLeft = 0;
+        for (int brickIndex = 0; brickIndex < brickEnd; brickIndex++)
+            state->hitPoints[brickIndex] = 0;
+    }
+    else if (BrickRowsOverlapping(brickSet, blocks->stateCameraY, gameState->cameraY + QVGA_HEIGHT, &rowFirst, &rowLast)) {
+        brickFirst = rowFirst * brickSet->base->columns;
+        brickEnd = (rowLast + 1) * brickSet->base->columns;
+    }
+    blocks->stateCameraY = gameState->cameraY;
+
+    for (int brickIndex = brickFirst; brickIndex < brickEnd; brickIndex++) {
+        hitPoints = BrickHitPoints(brickSet, brickIndex);
+        breakable = (brickSet->base->bricks[brickIndex].type != BRICK_TYPE_SOLID);
+        if (breakable)
+            state->bricksLeft += (hitPoints > 0) - (state->hitPoints[brickIndex] > 0);
+        state->hitPoints[brickIndex] = hitPoints;
+    }
+
+    return;
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+/*=============================================================================
+    blocks_lib.h
+ =============================================================================*/
+
+#ifndef BLOCKS_LIB_H
+#define BLOCKS_LIB_H
+
+#include "blocks.h"
+#include "../game.h"
+#include "../memory.h"
+#include "../palette.h"
+
+#define QVGA_WIDTH 320
+#define QVGA_HEIGHT 240
+#define BYTES_PER_PIXEL 4
+#define MS_PER_UPDATE (1000.0f / BLOCKS_UPDATES_PER_SECOND)
+
+/* The public state and frame come first; everything else is the library's
+   own. The arenas cover the rest of the caller's memory. */
+struct blocks {
+    struct blocks_state state;
+    struct blocks_frame frame;
+    struct memory_arena permanent;
+    struct memory_arena transient;
+    struct game_state *gameState;
+    const struct level_header *level;
+    uint32_t seed;
+    struct palette palette;
+    struct sprite_atlas *spriteAtlas;
+    struct bitmap_buffer gameBitmapBuffer;
+    struct bitmap_buffer frameBitmapBuffer;
+    float stateCameraY;
+};
+
+bool BlocksConfigValid(const struct blocks_config *);
+size_t BlocksPermanentSize(const struct blocks_config *);
+void BlocksUpdateState(struct blocks *, bool);
+
+#endif /* BLOCKS_LIB_H */
\ No newline at end of file
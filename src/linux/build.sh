@@ -0,0 +1,10 @@
+#!/usr/bin/bash
+mkdir -p ../../build
+pushd ../../build > /dev/null
+gcc -std=gnu99 -O2 -mssse3 -g ../src/linux/linux_main.c -o blocks_headless -lm -pthread
+gcc -std=gnu99 -O2 -mssse3 -g ../src/linux/viewer_main.c -o blocks_viewer -pthread
+gcc -std=gnu99 -O2 -mssse3 -g -fPIC -fvisibility=hidden -shared -Wl,-soname,libblocks.so.1 ../src/lib/blocks_lib.c -o libblocks.so.1 -lm -pthread
+ln -sf libblocks.so.1 libblocks.so
+gcc -std=gnu99 -O2 -mssse3 -g -fPIC -fvisibility=hidden -c ../src/lib/blocks_lib.c -o blocks_lib.o
+ar rcs libblocks.a blocks_lib.o
+popd > /dev/null
\ No newline at end of file
@@ -0,0 +1,16 @@
+#!/usr/bin/bash
+# Checks the programs build.sh built. Every frame of an autopilot game must
+# hash as recorded in autopilot.golden; after a change meant to alter the
+# frames, record it again with -G and the same options. Frames drawn with
+# sprites filled flat must match frames drawn without sprites, so both ways
+# of drawing layer sprites, text and particles alike. Games cloned for a
+# search must play out as the same games played without cloning.
+set -o pipefail
+pushd ../../build > /dev/null
+result=0
+./blocks_headless -t 30000 -a -g ../src/linux/autopilot.golden | grep "^golden" || result=1
+./blocks_headless -t 3600 -a -f -j 0 -G layering.golden > /dev/null || result=1
+./blocks_headless -t 3600 -a -F -g layering.golden | grep "^golden" || result=1
+./blocks_headless -t 20000 -B 8:2 | grep "^branches" || result=1
+popd > /dev/null
+exit $result
\ No newline at end of file
@@ -0,0 +1,1264 @@
+/*=============================================================================
+    linux_main.c
+    Headless runner for batch jobs and scripted runs. There is no window;
+    the game is simulated as fast as possible and a summary is printed.
+ =============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <limits.h>
+
+#include "linux_main.h"
+
+#include "../atomic.c"
+#include "../input.c"
+#include "../text.c"
+#include "../palette.c"
+#include "../render.c"
+#include "../sprite.c"
+#include "../particles.c"
+#include "../audio.c"
+#include "../level.c"
+#include "../memory.c"
+#include "../game.c"
+#include "../rules.c"
+#include "../bricks.c"
+#include "../simulate.c"
+#include "../kernels.c"
+#include "../telemetry.c"
+#include "../autopilot.c"
+#include "../netplay.c"
+#include "../stream.c"
+#include "../capture.c"
+#include "../pacer.c"
+#include "../hash.c"
+#include "../checkpoint.c"
+#include "../levelgen.c"
+
+/*-----------------------------------------------------------------------------
+    main
+    Application entry point for Linux.
+ ----------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    enum simulation_mode mode = fast;
+    enum present_mode presentMode = immediate;
+    int ticks = TICKS_DEFAULT;
+    bool ticksGiven = false;
+    bool render = false;
+    int outputWidth = QVGA_WIDTH;
+    int outputHeight = QVGA_HEIGHT;
+    int renderThreads = 0;
+    bool sprites = true;
+    bool spritesFlat = false;
+    const char *wavPath = NULL;
+    bool audio = false;
+    const char *streamPath = NULL;
+    const char *capturePath = NULL;
+    int captureInterval = 1;
+    const char *goldenPath = NULL;
+    bool goldenRecord = false;
+    const char *dumpPath = ".";
+    const char *checkpointPath = NULL;
+    const char *restorePath = NULL;
+    uint32_t restoreIndex = 0;
+    const char *telemetryPath = NULL;
+    struct autopilot autopilot;
+    AutopilotInit(&autopilot);
+    const char *levelPath = NULL;
+    uint32_t levelIndex = 0;
+    const char *scriptPath = NULL;
+    bool versus = false;
+    int versusLatency = 0;
+    int versusLoss = 0;
+    int evaluationLevels = 0;
+    int evaluationPlays = 0;
+    uint32_t evaluationSeed = 0;
+    const char *packPath = NULL;
+    int searchBranches = 0;
+    int searchGrids = 0;
+    struct game_rules rules;
+    RulesInit(&rules);
+    int option;
+
+    while ((option = getopt(argc, argv, "t:l:i:s:m:ro:j:fFw:nS:g:G:d:k:K:T:c:C:V:av:E:O:B:R:h")) != -1) {
+        switch (option) {
+        case 't':
+            ticks = atoi(optarg);
+            ticksGiven = true;
+            break;
+        case 'l':
+            levelPath = optarg;
+            break;
+        case 'i':
+            levelIndex = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            scriptPath = optarg;
+            break;
+        case 'm':
+            if (strcmp(optarg, "tick") == 0)
+                mode = tick;
+            else if (strcmp(optarg, "fast") == 0)
+                mode = fast;
+            else {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r':
+            render = true;
+            break;
+        case 'o':
+            if (sscanf(optarg, "%dx%d", &outputWidth, &outputHeight) != 2 || outputWidth <= 0 || outputHeight <= 0) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'j':
+            renderThreads = atoi(optarg);
+            break;
+        case 'f':
+            sprites = false;
+            break;
+        case 'F':
+            spritesFlat = true;
+            break;
+        case 'w':
+            wavPath = optarg;
+            audio = true;
+            break;
+        case 'n':
+            audio = true;
+            break;
+        case 'S':
+            streamPath = optarg;
+            render = true;
+            break;
+        case 'c':
+            capturePath = optarg;
+            render = true;
+            break;
+        case 'C':
+            captureInterval = atoi(optarg);
+            if (captureInterval <= 0) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'V':
+            if (strcmp(optarg, "asap") == 0)
+                presentMode = vsync;
+            else if (strcmp(optarg, "jit") == 0)
+                presentMode = vsyncJustInTime;
+            else {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            render = true;
+            break;
+        case 'g':
+        case 'G':
+            goldenPath = optarg;
+            goldenRecord = (option == 'G');
+            render = true;
+            break;
+        case 'd':
+            dumpPath = optarg;
+            break;
+        case 'k':
+            checkpointPath = optarg;
+            break;
+        case 'K': {
+            /* The index follows the last colon, as paths may have colons. */
+            char *colon = strrchr(optarg, ':');
+            if (!colon || colon == optarg) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            *colon = '\0';
+            restorePath = optarg;
+            restoreIndex = (uint32_t)strtoul(colon + 1, NULL, 10);
+            break;
+        }
+        case 'T':
+            telemetryPath = optarg;
+            break;
+        case 'a':
+            autopilot.enabled = true;
+            break;
+        case 'v':
+            if (sscanf(optarg, "%d:%d", &versusLatency, &versusLoss) != 2 || versusLatency < 0 || versusLoss < 0 || versusLoss >= 100) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            versus = true;
+            break;
+        case 'E':
+            if (sscanf(optarg, "%d:%d:%u", &evaluationLevels, &evaluationPlays, &evaluationSeed) != 3
+                    || evaluationLevels <= 0 || evaluationPlays <= 0) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'O':
+            packPath = optarg;
+            break;
+        case 'B':
+            if (sscanf(optarg, "%d:%d", &searchBranches, &searchGrids) != 2 || searchBranches <= 0 || searchGrids < 0) {
+                PrintUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'R':
+            if (!RulesSet(&rules, optarg)) {
+                fprintf(stderr, "Could not set the rules %s.\n", optarg);
+                return 1;
+            }
+            break;
+        default:
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    /* Evaluating generated levels needs nothing else. */
+    if (evaluationLevels > 0) {
+        return RunEvaluation(evaluationLevels, evaluationPlays, evaluationSeed, renderThreads,
+            ticksGiven ? ticks : EVALUATION_TICKS_DEFAULT, packPath, &rules);
+    }
+
+    /* Load the level. */
+    const struct level_header *level = NULL;
+    uint64_t levelFileSize = 0;
+    void *levelFile = NULL;
+    if (levelPath) {
+        levelFile = MapFile(levelPath, &levelFileSize);
+        if (levelFile)
+            level = LevelLoad(levelFile, levelFileSize, levelIndex);
+        if (!level) {
+            fprintf(stderr, "Could not load level %u from %s.\n", levelIndex, levelPath);
+            return 1;
+        }
+    }
+
+    if (versus) {
+        int result = RunVersus(level, ticks, versusLatency, versusLoss, &rules);
+        if (levelFile)
+            UnmapFile(levelFile, levelFileSize);
+        return result;
+    }
+
+    if (searchBranches > 0) {
+        int result = RunSearch(level, ticks, searchBranches, searchGrids, &rules);
+        if (levelFile)
+            UnmapFile(levelFile, levelFileSize);
+        return result;
+    }
+
+    /* Load the input script. */
+    struct script script = {0};
+    if (scriptPath && !ScriptLoad(&script, scriptPath)) {
+        fprintf(stderr, "Could not load the script %s.\n", scriptPath);
+        return 1;
+    }
+
+    /* Reserve all the memory up front. The game state goes first. */
+    size_t frameSize = (size_t)outputWidth * outputHeight * BYTES_PER_PIXEL;
+    size_t permanentSize = ARENA_SIZE(sizeof(struct game_state))
+        + ARENA_SIZE(BrickBaseSize(BRICK_CAPACITY_MAX))
+        + ARENA_SIZE(sizeof(struct particle_system))
+        + ARENA_SIZE(sizeof(struct audio_mixer))
+        + ARENA_SIZE(sizeof(struct render_pool))
+        + ARENA_SIZE((size_t)outputWidth * outputHeight)
+        + ARENA_SIZE(frameSize)
+        + ARENA_SIZE(sizeof(struct sprite_atlas))
+        + ARENA_SIZE(sizeof(struct stream_encoder))
+        + ARENA_SIZE(sizeof(struct input_queue))
+        + ARENA_SIZE(TELEMETRY_MEMORY_SIZE);
+    if (goldenPath)
+        permanentSize += ARENA_SIZE((size_t)ticks * sizeof(uint64_t));
+    if (streamPath)
+        permanentSize += StreamMemorySize(outputWidth, outputHeight);
+    if (capturePath)
+        permanentSize += ARENA_SIZE(sizeof(struct capture)) + CaptureMemorySize(outputWidth, outputHeight);
+    struct memory_reservation memory;
+    if (!MemoryReserve(&memory, permanentSize, sizeof(struct render_list))) {
+        fprintf(stderr, "Could not reserve %zu bytes of memory.\n", permanentSize);
+        return 1;
+    }
+
+    struct game_state *gameState = ArenaPush(&memory.permanent, sizeof(struct game_state));
+    void *brickMemory = ArenaPush(&memory.permanent, BrickBaseSize(BRICK_CAPACITY_MAX));
+    BrickSetInit(&gameState->bricks, brickMemory, BRICK_CAPACITY_MAX);
+    /* Particles are only simulated when they are drawn. */
+    if (render) {
+        gameState->particles = ArenaPush(&memory.permanent, sizeof(struct particle_system));
+        ParticleSystemInit(gameState->particles, 1);
+    }
+    gameState->rules = &rules;
+    GameInit(gameState, level);
+
+    /* What happens in play is counted from the start, for a telemetry file
+       written at the end. */
+    if (telemetryPath)
+        gameState->telemetry = TelemetryInit(ArenaPush(&memory.permanent, TELEMETRY_MEMORY_SIZE));
+
+    /* A run can start from a checkpoint saved by an earlier run on the same
+       level, under the same rules. */
+    if (restorePath) {
+        struct checkpoint_store restoreStore;
+        if (!CheckpointOpen(&restoreStore, restorePath, false)) {
+            fprintf(stderr, "Could not open the checkpoint file %s.\n", restorePath);
+            return 1;
+        }
+        bool restored = CheckpointRestore(&restoreStore, restoreIndex, gameState);
+        CheckpointClose(&restoreStore);
+        if (!restored) {
+            fprintf(stderr, "Could not restore checkpoint %u of %s.\n", restoreIndex, restorePath);
+            return 1;
+        }
+    }
+
+    /* A checkpoint is saved every second of game time. Other runs can append
+       to the same file at the same time. */
+    struct checkpoint_store checkpointStore;
+    int checkpointsSaved = 0;
+    int tickCheckpoint = 0;
+    if (checkpointPath && !CheckpointCreate(&checkpointStore, checkpointPath,
+            (uint32_t)(ticks / CHECKPOINT_INTERVAL_TICKS + 1),
+            gameState->bricks.base->rows, gameState->bricks.base->columns, CheckpointGameHash(gameState))) {
+        fprintf(stderr, "Could not create or open the checkpoint file %s for this level and rules.\n", checkpointPath);
+        return 1;
+    }
+
+    /* Audio is mixed a tick at a time, in step with the game, into a WAV
+       file or into nothing. */
+    struct audio_sink audioSink;
+    struct audio_wav_sink wavSink;
+    struct audio_mixer *audioMixer = NULL;
+    if (audio) {
+        if (wavPath) {
+            if (!AudioSinkWavOpen(&audioSink, &wavSink, wavPath)) {
+                fprintf(stderr, "Could not create %s.\n", wavPath);
+                return 1;
+            }
+        }
+        else
+            AudioSinkNullOpen(&audioSink);
+        audioMixer = ArenaPush(&memory.permanent, sizeof(struct audio_mixer));
+        AudioMixerInit(audioMixer, &audioSink);
+        gameState->audio = &audioMixer->queue;
+    }
+
+    struct render_pool *renderPool = NULL;
+    if (renderThreads > 0) {
+        renderPool = ArenaPush(&memory.permanent, sizeof(struct render_pool));
+        RenderPoolStart(renderPool, renderThreads);
+    }
+
+    struct bitmap_buffer gameBitmapBuffer;
+    gameBitmapBuffer.memory = ArenaPush(&memory.permanent, (size_t)outputWidth * outputHeight);
+    gameBitmapBuffer.memorySize = outputWidth * outputHeight;
+    gameBitmapBuffer.width = outputWidth;
+    gameBitmapBuffer.height = outputHeight;
+    gameBitmapBuffer.pitch = outputWidth;
+
+    /* Frames are expanded to pixels as if they were presented. */
+    struct palette palette;
+    PaletteInit(&palette, PIXEL_FORMAT_BGRX);
+    struct bitmap_buffer frameBitmapBuffer;
+    frameBitmapBuffer.memory = ArenaPush(&memory.permanent, frameSize);
+    frameBitmapBuffer.memorySize = (int)frameSize;
+    frameBitmapBuffer.width = outputWidth;
+    frameBitmapBuffer.height = outputHeight;
+    frameBitmapBuffer.pitch = outputWidth * BYTES_PER_PIXEL;
+    struct sprite_atlas *spriteAtlas = NULL;
+    if (sprites) {
+        spriteAtlas = ArenaPush(&memory.permanent, sizeof(struct sprite_atlas));
+        SpriteAtlasInit(spriteAtlas, &palette);
+        if (spritesFlat)
+            SpriteAtlasFlatten(spriteAtlas, &palette);
+    }
+
+    /* Rendered frames are streamed to a spectator, when there is one. */
+    struct stream_encoder *streamEncoder = NULL;
+    if (streamPath) {
+        streamEncoder = ArenaPush(&memory.permanent, sizeof(struct stream_encoder));
+        if (!StreamEncoderOpen(streamEncoder, streamPath, outputWidth, outputHeight, &memory.permanent)) {
+            fprintf(stderr, "Could not stream to %s.\n", streamPath);
+            return 1;
+        }
+    }
+
+    /* Rendered frames are captured to PNG stills or a Y4M video, every
+       frame or every few. */
+    struct capture *capture = NULL;
+    uint64_t captureSubmitUs = 0;
+    int captureSubmits = 0;
+    if (capturePath) {
+        capture = ArenaPush(&memory.permanent, sizeof(struct capture));
+        if (!CaptureOpen(capture, capturePath, outputWidth, outputHeight, UPDATES_PER_SECOND, &memory.permanent)) {
+            fprintf(stderr, "Could not capture to %s; it must be a .png or .y4m path.\n", capturePath);
+            return 1;
+        }
+    }
+
+    /* Every frame's hash is recorded, or checked against the hashes of
+       golden frames recorded before. */
+    uint64_t *goldenHashes = NULL;
+    int goldenCount = 0;
+    int goldenMismatches = 0;
+    int goldenMismatchFirst = -1;
+    uint64_t goldenHashUs = 0;
+    if (goldenPath) {
+        goldenHashes = ArenaPush(&memory.permanent, (size_t)ticks * sizeof(uint64_t));
+        if (!goldenRecord && !GoldenLoad(goldenPath, goldenHashes, ticks, &goldenCount, outputWidth, outputHeight, sprites && !spritesFlat)) {
+            fprintf(stderr, "Could not load golden hashes for %dx%d %s frames from %s.\n",
+                outputWidth, outputHeight, (sprites && !spritesFlat) ? "sprite" : "flat", goldenPath);
+            return 1;
+        }
+    }
+
+    /* Input goes through the input queue, as a player's would, whenever the
+       game is stepped a tick at a time. */
+    struct input_queue *inputQueue = NULL;
+    if (mode == tick || render || audio) {
+        inputQueue = ArenaPush(&memory.permanent, sizeof(struct input_queue));
+        InputQueueInit(inputQueue);
+    }
+
+    /* A simulated display refreshes once a tick from the start of the run,
+       and present waits for the first refresh after the frame is ready.
+       Input is taken to be sampled when a frame starts. */
+    struct frame_pacer pacer;
+    uint64_t refreshPeriodUs = US_PER_SECOND / UPDATES_PER_SECOND;
+    uint64_t refreshFirstUs = ComputeTimestampUs();
+    uint64_t refreshLastUs = refreshFirstUs;
+    uint64_t displayLatencyUs = 0;
+    uint64_t displayLatencyMaxUs = 0;
+    int framesPresented = 0;
+    int refreshesMissed = 0;
+    PacerInit(&pacer, refreshPeriodUs, refreshFirstUs);
+
+    /* Game loop. Input only changes at script events, so the simulation can
+       run uninterrupted from one script event to the next. */
+    uint64_t timeStartUs = ComputeTimestampUs();
+    int scriptIndex = 0;
+    int tickCurrent = 0;
+    int tickAutopilot = 0;
+    while (tickCurrent < ticks) {
+        while (scriptIndex < script.count && script.events[scriptIndex].tick <= tickCurrent) {
+            if (inputQueue)
+                GameKeyboardUpdate(inputQueue, script.events[scriptIndex].key, script.events[scriptIndex].keyIsDown, gameState->tickTimeUs);
+            else
+                GameApplyKey(gameState, script.events[scriptIndex].key, script.events[scriptIndex].keyIsDown);
+            scriptIndex++;
+        }
+
+        int tickNext = ticks;
+        if (scriptIndex < script.count && script.events[scriptIndex].tick < tickNext)
+            tickNext = script.events[scriptIndex].tick;
+
+        if (checkpointPath) {
+            if (tickCurrent == tickCheckpoint) {
+                if (CheckpointAppend(&checkpointStore, gameState) != CHECKPOINT_NONE)
+                    checkpointsSaved++;
+                tickCheckpoint += CHECKPOINT_INTERVAL_TICKS;
+            }
+            if (tickCheckpoint < tickNext)
+                tickNext = tickCheckpoint;
+        }
+
+        /* The autopilot also changes input, but only when it is asked. It is
+           asked when it wants to be, however else the run is split, so
+           checkpoints do not change how it plays. */
+        if (autopilot.enabled) {
+            if (tickCurrent >= tickAutopilot)
+                tickAutopilot = tickCurrent + AutopilotUpdate(&autopilot, gameState, inputQueue, gameState->tickTimeUs, MS_PER_UPDATE);
+            if (tickAutopilot < tickNext)
+                tickNext = tickAutopilot;
+        }
+
+        /* Rendering and audio need every frame, so they always step tick by
+           tick. */
+        if (!inputQueue) {
+            GameFastForward(MS_PER_UPDATE, gameState, tickNext - tickCurrent);
+            tickCurrent = tickNext;
+        }
+        else {
+            for (; tickCurrent < tickNext; tickCurrent++) {
+                if (presentMode == vsyncJustInTime)
+                    WaitUntilUs(PacerWakeUs(&pacer, ComputeTimestampUs()));
+                else if (presentMode == vsync)
+                    PacerWakeUs(&pacer, ComputeTimestampUs());
+                PacerFrameStart(&pacer, ComputeTimestampUs());
+                GameUpdate(MS_PER_UPDATE, gameState, inputQueue);
+                /* Once the sink has failed, the game is silent. */
+                if (audio && !AudioMix(audioMixer, AUDIO_SAMPLE_RATE / UPDATES_PER_SECOND))
+                    audio = false;
+                if (render) {
+                    ArenaReset(&memory.transient);
+                    struct render_list *renderList = ArenaPush(&memory.transient, sizeof(struct render_list));
+                    GameRender(gameState, renderList);
+                    RenderFrame(renderPool, renderList, &gameBitmapBuffer, &palette, spriteAtlas, &frameBitmapBuffer);
+                    if (goldenHashes) {
+                        uint64_t hashStartUs = ComputeTimestampUs();
+                        uint64_t hash = HashFrame(&frameBitmapBuffer, BYTES_PER_PIXEL);
+                        goldenHashUs += ComputeTimestampUs() - hashStartUs;
+                        if (goldenRecord)
+                            goldenHashes[tickCurrent] = hash;
+                        else if (tickCurrent >= goldenCount || hash != goldenHashes[tickCurrent]) {
+                            /* Only the first few mismatching frames are kept. */
+                            if (goldenMismatches < GOLDEN_DUMPS_MAX) {
+                                char dumpFile[PATH_MAX];
+                                snprintf(dumpFile, sizeof(dumpFile), "%s/frame_%06d.ppm", dumpPath, tickCurrent);
+                                if (!WritePpm(dumpFile, &frameBitmapBuffer))
+                                    fprintf(stderr, "Could not write %s.\n", dumpFile);
+                            }
+                            if (goldenMismatchFirst < 0)
+                                goldenMismatchFirst = tickCurrent;
+                            goldenMismatches++;
+                        }
+                    }
+                    /* The capture copies the frame, so it goes before the
+                       stream encoder swaps the frame's memory away. */
+                    if (capture && tickCurrent % captureInterval == 0) {
+                        uint64_t submitStartUs = ComputeTimestampUs();
+                        CaptureSubmit(capture, &frameBitmapBuffer, (uint32_t)tickCurrent);
+                        captureSubmitUs += ComputeTimestampUs() - submitStartUs;
+                        captureSubmits++;
+                    }
+                    if (streamEncoder)
+                        StreamSubmit(streamEncoder, &frameBitmapBuffer);
+                }
+                if (presentMode != immediate) {
+                    uint64_t presentUs = ComputeTimestampUs();
+                    uint64_t refreshUs = refreshFirstUs
+                        + ((presentUs - refreshFirstUs) / refreshPeriodUs + 1) * refreshPeriodUs;
+                    WaitUntilUs(refreshUs);
+                    PacerFramePresented(&pacer, presentUs, refreshUs);
+                    if (framesPresented > 0 && refreshUs > refreshLastUs + refreshPeriodUs)
+                        refreshesMissed++;
+                    refreshLastUs = refreshUs;
+                    displayLatencyUs += refreshUs - pacer.frameStartUs;
+                    if (refreshUs - pacer.frameStartUs > displayLatencyMaxUs)
+                        displayLatencyMaxUs = refreshUs - pacer.frameStartUs;
+                    framesPresented++;
+                }
+            }
+        }
+    }
+    uint64_t timeElapsedUs = ComputeTimestampUs() - timeStartUs;
+
+    printf("ticks %d (%.1fs simulated) in %.3fms\n",
+        ticks, (float)ticks / UPDATES_PER_SECOND, (float)timeElapsedUs / US_PER_MS);
+    printf("score %d lives %d ball %.3f %.3f paddle %.3f\n",
+        gameState->score, gameState->lives,
+        gameState->ball.rect.position.x, gameState->ball.rect.position.y,
+        gameState->paddle.rect.position.x);
+
+    if (presentMode != immediate && framesPresented > 0) {
+        printf("vsync %s frames %d, %d refreshes missed, input to display %.2fms mean %.2fms max, frame cost %.2fms (p95)\n",
+            (presentMode == vsyncJustInTime) ? "just in time" : "as soon as possible",
+            framesPresented, refreshesMissed, (double)displayLatencyUs / framesPresented / US_PER_MS,
+            (double)displayLatencyMaxUs / US_PER_MS, (double)PacerCostUs(&pacer) / US_PER_MS);
+    }
+
+    int result = 0;
+    if (goldenRecord) {
+        if (!GoldenSave(goldenPath, goldenHashes, ticks, outputWidth, outputHeight, sprites && !spritesFlat)) {
+            fprintf(stderr, "Could not write %s.\n", goldenPath);
+            result = 1;
+        }
+        else
+            printf("golden frames %d recorded, hashing %.1fus per frame\n", ticks, (double)goldenHashUs / ticks);
+    }
+    else if (goldenPath) {
+        printf("golden frames %d checked, %d mismatched", ticks, goldenMismatches);
+        if (goldenMismatches > 0)
+            printf(" (first at frame %d)", goldenMismatchFirst);
+        printf(", hashing %.1fus per frame\n", (double)goldenHashUs / ticks);
+        if (goldenMismatches > 0)
+            result = 1;
+    }
+
+    if (telemetryPath) {
+        struct telemetry_counters *counters = &gameState->telemetry->counters;
+        uint64_t paddleHits = 0, deadZoneHits = 0, livesLost = 0;
+        /* The dead zone, in the buckets the paddle was scaled to. */
+        float bucketsPerPixel = (float)TELEMETRY_PADDLE_BUCKETS / (float)(rules.paddleWidth + BALL_WIDTH);
+        int deadZoneCenter = (rules.paddleWidth + BALL_WIDTH) / 2;
+        float deadZoneLeft = (float)(deadZoneCenter - rules.paddleDeadZoneRadius) * bucketsPerPixel;
+        float deadZoneRight = (float)(deadZoneCenter + rules.paddleDeadZoneRadius) * bucketsPerPixel;
+        for (int bucket = 0; bucket < TELEMETRY_PADDLE_BUCKETS; bucket++) {
+            paddleHits += counters->paddleHits[bucket];
+            if (bucket >= deadZoneLeft && bucket < deadZoneRight)
+                deadZoneHits += counters->paddleHits[bucket];
+        }
+        for (int bucket = 0; bucket < TELEMETRY_LIFE_BUCKETS; bucket++)
+            livesLost += counters->livesLost[bucket];
+        if (!TelemetryWrite(telemetryPath, counters)) {
+            fprintf(stderr, "Could not write %s.\n", telemetryPath);
+            result = 1;
+        }
+        else
+            printf("telemetry games %llu ended, paddle hits %llu (%llu in the dead zone), lives lost %llu, in %s\n",
+                (unsigned long long)counters->gamesEnded, (unsigned long long)paddleHits,
+                (unsigned long long)deadZoneHits, (unsigned long long)livesLost, telemetryPath);
+    }
+
+    if (checkpointPath) {
+        printf("checkpoints %d saved, %u in %s\n", checkpointsSaved, CheckpointCount(&checkpointStore), checkpointPath);
+        CheckpointClose(&checkpointStore);
+    }
+
+    printf("memory %zu KB permanent, %zu KB transient, %s\n",
+        memory.permanent.used / 1024, memory.transient.size / 1024, MemoryPagesName(memory.pages));
+
+    /* Clean up resources. */
+    if (streamEncoder) {
+        StreamEncoderClose(streamEncoder);
+        printf("stream frames %d (%d dropped) bytes %llu, %.0f per frame%s\n",
+            streamEncoder->framesWritten, streamEncoder->framesDropped,
+            (unsigned long long)streamEncoder->bytesWritten,
+            streamEncoder->framesWritten ? (double)streamEncoder->bytesWritten / streamEncoder->framesWritten : 0.0,
+            streamEncoder->failed ? ", stopped by a failed write" : "");
+    }
+    if (capture) {
+        CaptureClose(capture);
+        printf("capture frames %d (%d dropped) bytes %llu, submitting %.1fus per frame%s\n",
+            capture->framesWritten, capture->framesDropped, (unsigned long long)capture->bytesWritten,
+            captureSubmits ? (double)captureSubmitUs / captureSubmits : 0.0,
+            capture->failed ? ", stopped by a failed write" : "");
+        if (capture->failed)
+            result = 1;
+    }
+    if (audioMixer) {
+        audioSink.close(&audioSink);
+        if (audioMixer->queue.closed) {
+            fprintf(stderr, "Could not write the game's audio; the rest of the game was silent.\n");
+            result = 1;
+        }
+    }
+    if (renderPool)
+        RenderPoolStop(renderPool);
+    MemoryRelease(&memory);
+    free(script.events);
+    if (levelFile)
+        UnmapFile(levelFile, levelFileSize);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+    PrintUsage
+    Print the command line options.
+ ----------------------------------------------------------------------------*/
+void PrintUsage(const char *program)
+{
+    fprintf(stderr,
+        "usage: %s [-t ticks] [-l level-file] [-i level-index] [-s script] [-m tick|fast] [-r] [-o WxH] [-j threads] [-f|-F] [-w wav-file] [-n] [-S stream] [-c capture-file] [-C frames] [-V asap|jit] [-g|-G golden-file] [-d dump-dir] [-k checkpoint-file] [-K checkpoint-file:index] [-T telemetry-file] [-a] [-v latency:loss] [-E levels:plays:seed] [-O pack-file] [-B branches:grids] [-R name=value,...]\n"
+        "  -t  number of ticks to simulate (default %d)\n"
+        "  -l  level file or level pack\n"
+        "  -i  index of the level in a level pack\n"
+        "  -s  input script, one 'tick left|right|escape down|up' per line\n"
+        "  -m  step every tick, or jump between events (default)\n"
+        "  -r  render every frame\n"
+        "  -o  size of rendered frames (default %dx%d)\n"
+        "  -j  render with this many worker threads as well, or evaluate levels\n"
+        "      on this many threads (default one per processor)\n"
+        "  -f  render flat rectangles instead of sprites\n"
+        "  -F  render sprites filled flat, which must match -f frames exactly\n"
+        "  -w  mix the game's audio into a WAV file\n"
+        "  -n  mix the game's audio into nothing\n"
+        "  -S  render and stream frames to a viewer's socket, a pipe or a file\n"
+        "  -c  render and capture frames to name_FRAME.png stills or a .y4m video\n"
+        "  -C  capture every this many frames (default every frame)\n"
+        "  -V  render to a simulated 60 Hz display in real time, starting each\n"
+        "      frame as soon as the last was shown or just in time for the next\n"
+        "  -g  render and check every frame's hash against a golden hash file\n"
+        "  -G  render and record every frame's hash in a golden hash file\n"
+        "  -d  directory for frames that do not match their golden hash\n"
+        "  -k  append a checkpoint of the game every second to a checkpoint file\n"
+        "  -K  start from a checkpoint in a checkpoint file\n"
+        "  -T  count brick hits, paddle hits, lives lost and game lengths into\n"
+        "      a telemetry file\n"
+        "  -a  let the autopilot play\n"
+        "  -v  play a versus game between two bots over loopback UDP, with\n"
+        "      packets held back a number of ticks and a percentage lost\n"
+        "  -E  generate levels from a seed and play each a number of times,\n"
+        "      for at most -t ticks a play (default %d), ranked easiest first\n"
+        "  -O  write the evaluated levels, ranked, to a level pack\n"
+        "  -B  search serve angles on branches cloned from one game, with room\n"
+        "      for a number of brick grids a branch, and check each branch\n"
+        "      against the same game played without cloning\n"
+        "  -R  change the rules, as name=value pairs separated by commas, such\n"
+        "      as ballSpeed=120,lives=5 or brickColumns=16,brickWidth=20\n",
+        program, TICKS_DEFAULT, QVGA_WIDTH, QVGA_HEIGHT, EVALUATION_TICKS_DEFAULT);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RunVersus
+    Play a versus game between two bots, each with its own game state and
+    netplay session, talking to each other over loopback UDP. Prints how
+    often the sessions rolled back, how far, and whether they ever
+    disagreed. Both ends play by the same rules. Returns the exit code.
+ ----------------------------------------------------------------------------*/
+int RunVersus(const struct level_header *level, int ticks, int latencyTicks, int lossPercent, const struct game_rules *rules)
+{
+    struct game_state *gameStates[NETPLAY_PLAYERS];
+    struct netplay_session *sessions[NETPLAY_PLAYERS];
+    struct memory_reservation memory;
+    uint64_t advanceUsMax = 0;
+    uint64_t advanceUsTotal = 0;
+    int advances = 0;
+    int result = 0;
+
+    size_t permanentSize = NETPLAY_PLAYERS * (ARENA_SIZE(sizeof(struct game_state))
+        + ARENA_SIZE(BrickBaseSize(BRICK_CAPACITY_MAX)) + ARENA_SIZE(sizeof(struct netplay_session)));
+    if (!MemoryReserve(&memory, permanentSize, 0)) {
+        fprintf(stderr, "Could not reserve %zu bytes of memory.\n", permanentSize);
+        return 1;
+    }
+
+    for (int player = 0; player < NETPLAY_PLAYERS; player++) {
+        gameStates[player] = ArenaPush(&memory.permanent, sizeof(struct game_state));
+        BrickSetInit(&gameStates[player]->bricks, ArenaPush(&memory.permanent, BrickBaseSize(BRICK_CAPACITY_MAX)), BRICK_CAPACITY_MAX);
+        gameStates[player]->versus = true;
+        gameStates[player]->rules = rules;
+        GameInit(gameStates[player], level);
+
+        sessions[player] = ArenaPush(&memory.permanent, sizeof(struct netplay_session));
+        if (!NetplayOpen(sessions[player], player, MS_PER_UPDATE, VERSUS_PORT + player, "127.0.0.1", VERSUS_PORT + 1 - player)) {
+            fprintf(stderr, "Could not open UDP port %d.\n", VERSUS_PORT + player);
+            for (int opened = 0; opened < player; opened++)
+                NetplayClose(sessions[opened]);
+            MemoryRelease(&memory);
+            return 1;
+        }
+        NetplaySetConditions(sessions[player], latencyTicks, lossPercent, player + 1);
+    }
+
+    /* Both ends are stepped once a frame, each as far as its session lets
+       it, until both have simulated every tick. */
+    uint64_t timeStartUs = ComputeTimestampUs();
+    while (sessions[0]->tick < (uint32_t)ticks || sessions[1]->tick < (uint32_t)ticks) {
+        for (int player = 0; player < NETPLAY_PLAYERS; player++) {
+            if (sessions[player]->tick >= (uint32_t)ticks) {
+                NetplayPoll(sessions[player]);
+                continue;
+            }
+            uint64_t advanceStartUs = ComputeTimestampUs();
+            NetplayAdvance(sessions[player], gameStates[player], VersusBot(gameStates[player], player));
+            uint64_t advanceUs = ComputeTimestampUs() - advanceStartUs;
+            advanceUsTotal += advanceUs;
+            if (advanceUs > advanceUsMax)
+                advanceUsMax = advanceUs;
+            advances++;
+        }
+    }
+    uint64_t timeElapsedUs = ComputeTimestampUs() - timeStartUs;
+
+    printf("ticks %d (%.1fs simulated) in %.3fms, advance %.1fus mean %.1fus max\n",
+        ticks, (float)ticks / UPDATES_PER_SECOND, (float)timeElapsedUs / US_PER_MS,
+        (float)advanceUsTotal / advances, (float)advanceUsMax);
+    for (int player = 0; player < NETPLAY_PLAYERS; player++) {
+        struct netplay_session *session = sessions[player];
+        printf("player %d: rollbacks %d resimulated %d (max %d) stalls %d checks %d desyncs %d\n",
+            player + 1, session->rollbacks, session->ticksResimulated, session->resimulatedMax,
+            session->stalls, session->checks, session->desyncs);
+        printf("player %d: score %d lives %d opponent score %d lives %d ball %.3f %.3f\n",
+            player + 1, gameStates[player]->score, gameStates[player]->lives,
+            gameStates[player]->opponentScore, gameStates[player]->opponentLives,
+            gameStates[player]->ball.rect.position.x, gameStates[player]->ball.rect.position.y);
+        if (session->desyncs > 0)
+            result = 1;
+    }
+
+    for (int player = 0; player < NETPLAY_PLAYERS; player++)
+        NetplayClose(sessions[player]);
+    MemoryRelease(&memory);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+    VersusBot
+    Returns the buttons that move a player's paddle under the ball. The bot
+    only sees its own end's game state, as a remote player would.
+ ----------------------------------------------------------------------------*/
+uint8_t VersusBot(const struct game_state *gameState, int player)
+{
+    const struct paddle_vars *paddle = (player == 0) ? &gameState->paddle : &gameState->opponent;
+    float distance = (gameState->ball.rect.position.x + BALL_WIDTH / 2.0f)
+        - (paddle->rect.position.x + gameState->rules->paddleWidth / 2.0f);
+
+    if (distance < -gameState->rules->paddleWidth / 4.0f)
+        return NETPLAY_BUTTON_LEFT;
+    if (distance > gameState->rules->paddleWidth / 4.0f)
+        return NETPLAY_BUTTON_RIGHT;
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    RunSearch
+    Search for the best opening serve: clone a number of branches from one
+    game, serve each at its own angle, fanned out around the rules' angle,
+    and let the autopilot play each for a number of ticks. The branches
+    share the game's bricks until they change more than a change list
+    holds. Every branch is played again on a game of its own, which must
+    end the same. A branch that runs out of room is dropped. Returns the
+    exit code.
+ ----------------------------------------------------------------------------*/
+int RunSearch(const struct level_header *level, int ticks, int branchCount, int gridsPerBranch, const struct game_rules *rules)
+{
+    struct game_state *root, *reference, *branches;
+    void *referenceBricks;
+    struct memory_reservation memory;
+    struct memory_arena searchArena;
+    double angle, angleBest = 0.0;
+    int scoreBest = -1;
+    int flattened = 0, outOfMemory = 0, mismatches = 0;
+
+    size_t searchSize = (size_t)branchCount * gridsPerBranch * ARENA_SIZE(BrickBaseSize(BRICK_CAPACITY_MAX));
+    size_t permanentSize = 2 * (ARENA_SIZE(sizeof(struct game_state)) + ARENA_SIZE(BrickBaseSize(BRICK_CAPACITY_MAX)))
+        + ARENA_SIZE((size_t)branchCount * sizeof(struct game_state)) + ARENA_SIZE(searchSize);
+    if (!MemoryReserve(&memory, permanentSize, 0)) {
+        fprintf(stderr, "Could not reserve %zu bytes of memory.\n", permanentSize);
+        return 1;
+    }
+
+    root = ArenaPush(&memory.permanent, sizeof(struct game_state));
+    BrickSetInit(&root->bricks, ArenaPush(&memory.permanent, BrickBaseSize(BRICK_CAPACITY_MAX)), BRICK_CAPACITY_MAX);
+    root->rules = rules;
+    GameInit(root, level);
+    reference = ArenaPush(&memory.permanent, sizeof(struct game_state));
+    referenceBricks = ArenaPush(&memory.permanent, BrickBaseSize(BRICK_CAPACITY_MAX));
+    branches = ArenaPush(&memory.permanent, (size_t)branchCount * sizeof(struct game_state));
+    ArenaInit(&searchArena, ArenaPush(&memory.permanent, searchSize), searchSize);
+
+    /* Every branch is cloned before any is played, so they all start out
+       sharing the root's bricks. */
+    uint64_t timeStartUs = ComputeTimestampUs();
+    for (int branch = 0; branch < branchCount; branch++)
+        GameClone(&branches[branch], root, &searchArena);
+    for (int branch = 0; branch < branchCount; branch++) {
+        angle = rules->ballAngleInit + SEARCH_ANGLE_SPREAD * ((branch + 0.5) / branchCount - 0.5);
+        BallSetVelocity(&branches[branch], DegreesToRadians(angle));
+        SearchPlay(&branches[branch], ticks);
+        if (branches[branch].bricks.outOfMemory) {
+            outOfMemory++;
+            GameCloneRelease(&branches[branch]);
+            continue;
+        }
+        if (branches[branch].bricks.base != root->bricks.base)
+            flattened++;
+
+        /* The reference starts as the root did, with bricks of its own. */
+        memset(reference, 0, sizeof(*reference));
+        BrickSetInit(&reference->bricks, referenceBricks, BRICK_CAPACITY_MAX);
+        reference->rules = rules;
+        GameInit(reference, level);
+        BallSetVelocity(reference, DegreesToRadians(angle));
+        SearchPlay(reference, ticks);
+        if (GameChecksum(&branches[branch]) != GameChecksum(reference)) {
+            fprintf(stderr, "Branch %d, served at %.1f degrees, does not match the game played without cloning.\n",
+                branch, angle);
+            mismatches++;
+        }
+        if (branches[branch].score > scoreBest) {
+            scoreBest = branches[branch].score;
+            angleBest = angle;
+        }
+        GameCloneRelease(&branches[branch]);
+    }
+    uint64_t searchArenaUsed = searchArena.used;
+    GameSearchEnd(root, &searchArena);
+    uint64_t timeElapsedUs = ComputeTimestampUs() - timeStartUs;
+
+    printf("branches %d of %d ticks in %.3fms, %d with bricks of their own, %d out of memory, %d mismatched, %llu KB of clone bricks\n",
+        branchCount, ticks, (float)timeElapsedUs / US_PER_MS, flattened, outOfMemory, mismatches,
+        (unsigned long long)searchArenaUsed / 1024);
+    if (scoreBest >= 0)
+        printf("best serve %.1f degrees, score %d\n", angleBest, scoreBest);
+
+    MemoryRelease(&memory);
+
+    return (mismatches > 0) ? 1 : 0;
+}
+
+/*-----------------------------------------------------------------------------
+    SearchPlay
+    Let the autopilot play a game for a number of ticks, jumping between
+    its decisions.
+ ----------------------------------------------------------------------------*/
+void SearchPlay(struct game_state *gameState, int ticks)
+{
+    struct autopilot autopilot;
+    int tickCurrent = 0;
+    int tickNext;
+
+    AutopilotInit(&autopilot);
+    autopilot.enabled = true;
+    while (tickCurrent < ticks) {
+        tickNext = tickCurrent + AutopilotUpdate(&autopilot, gameState, NULL, gameState->tickTimeUs, MS_PER_UPDATE);
+        if (tickNext > ticks)
+            tickNext = ticks;
+        GameFastForward(MS_PER_UPDATE, gameState, tickNext - tickCurrent);
+        tickCurrent = tickNext;
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RunEvaluation
+    Generate levels from consecutive seeds and play each a number of times
+    with the scripted player, spread over worker threads, each with its own
+    game state. Prints the levels from the easiest to the hardest, and how
+    long it took; the ranked levels can also be written to a level pack.
+    Every game is played by the same rules. Returns the exit code.
+ ----------------------------------------------------------------------------*/
+int RunEvaluation(int levelCount, int plays, uint32_t seed, int threadCount, int ticksMax, const char *packPath,
+    const struct game_rules *rules)
+{
+    struct evaluation_job job;
+    struct evaluation_worker *workers;
+    struct memory_reservation memory;
+    int playsCleared = 0;
+    int result = 0;
+
+    if (threadCount <= 0)
+        threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threadCount <= 0)
+        threadCount = 1;
+    if (threadCount > EVALUATION_THREADS_MAX)
+        threadCount = EVALUATION_THREADS_MAX;
+
+    size_t permanentSize = ARENA_SIZE((size_t)levelCount * sizeof(struct level_evaluation))
+        + ARENA_SIZE(threadCount * sizeof(struct evaluation_worker))
+        + threadCount * (ARENA_SIZE(sizeof(struct game_state)) + ARENA_SIZE(BrickBaseSize(BRICK_CAPACITY_MAX))
+            + ARENA_SIZE(LEVELGEN_SIZE_MAX));
+    if (!MemoryReserve(&memory, permanentSize, 0)) {
+        fprintf(stderr, "Could not reserve %zu bytes of memory.\n", permanentSize);
+        return 1;
+    }
+
+    job.levelCount = levelCount;
+    job.plays = plays;
+    job.ticksMax = ticksMax;
+    job.nextLevel = 0;
+    job.evaluations = ArenaPush(&memory.permanent, (size_t)levelCount * sizeof(struct level_evaluation));
+    for (int levelIndex = 0; levelIndex < levelCount; levelIndex++) {
+        job.evaluations[levelIndex].index = (uint32_t)levelIndex;
+        job.evaluations[levelIndex].seed = seed + (uint32_t)levelIndex;
+    }
+
+    workers = ArenaPush(&memory.permanent, threadCount * sizeof(struct evaluation_worker));
+    for (int thread = 0; thread < threadCount; thread++) {
+        workers[thread].job = &job;
+        workers[thread].gameState = ArenaPush(&memory.permanent, sizeof(struct game_state));
+        workers[thread].gameState->rules = rules;
+        BrickSetInit(&workers[thread].gameState->bricks, ArenaPush(&memory.permanent, BrickBaseSize(BRICK_CAPACITY_MAX)), BRICK_CAPACITY_MAX);
+        workers[thread].levelMemory = ArenaPush(&memory.permanent, LEVELGEN_SIZE_MAX);
+    }
+
+    uint64_t timeStartUs = ComputeTimestampUs();
+    for (int thread = 0; thread < threadCount; thread++)
+        pthread_create(&workers[thread].thread, NULL, EvaluationWorker, &workers[thread]);
+    for (int thread = 0; thread < threadCount; thread++)
+        pthread_join(workers[thread].thread, NULL);
+    uint64_t timeElapsedUs = ComputeTimestampUs() - timeStartUs;
+
+    qsort(job.evaluations, levelCount, sizeof(struct level_evaluation), LevelEvaluationCompare);
+    for (int rank = 0; rank < levelCount; rank++) {
+        const struct level_evaluation *evaluation = &job.evaluations[rank];
+        printf("rank %d seed %u grid %dx%d bricks %d cleared %d/%d ticks %.0f lives lost %.2f\n",
+            rank, evaluation->seed, evaluation->columns, evaluation->rows, evaluation->bricks,
+            evaluation->cleared, evaluation->plays,
+            evaluation->cleared ? (double)evaluation->ticksToClear / evaluation->cleared : 0.0,
+            (double)evaluation->livesLost / evaluation->plays);
+        playsCleared += evaluation->cleared;
+    }
+    printf("levels %d plays %d (%d cleared) on %d threads in %.3fs, %.1f levels per second\n",
+        levelCount, levelCount * plays, playsCleared, threadCount, (double)timeElapsedUs / US_PER_SECOND,
+        levelCount / ((double)timeElapsedUs / US_PER_SECOND));
+
+    if (packPath && !WriteLevelPack(packPath, job.evaluations, levelCount)) {
+        fprintf(stderr, "Could not write the level pack %s.\n", packPath);
+        result = 1;
+    }
+
+    MemoryRelease(&memory);
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+    EvaluationWorker
+    Evaluate levels until there are none left.
+ ----------------------------------------------------------------------------*/
+void *EvaluationWorker(void *parameter)
+{
+    struct evaluation_worker *worker = parameter;
+    struct evaluation_job *job = worker->job;
+    const struct level_header *level;
+    uint32_t levelIndex;
+
+    while ((levelIndex = AtomicAdd(&job->nextLevel, 1) - 1) < (uint32_t)job->levelCount) {
+        level = LevelGenerate(worker->levelMemory, job->evaluations[levelIndex].seed);
+        LevelEvaluate(&job->evaluations[levelIndex], worker->gameState, level, job->plays, job->ticksMax, MS_PER_UPDATE);
+    }
+
+    return NULL;
+}
+
+/*-----------------------------------------------------------------------------
+    WriteLevelPack
+    Write evaluated levels to a level pack, in order, generating each again
+    from its seed. Returns false if the file cannot be written.
+ ----------------------------------------------------------------------------*/
+bool WriteLevelPack(const char *path, const struct level_evaluation *evaluations, int count)
+{
+    static uint64_t levelMemory[LEVELGEN_SIZE_MAX / sizeof(uint64_t)];
+    struct level_pack_header header = {0};
+    const struct level_header *level;
+    uint64_t offset, size;
+    bool ok = true;
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    header.magic = LEVEL_PACK_MAGIC;
+    header.version = LEVEL_VERSION;
+    header.headerSize = sizeof(struct level_pack_header);
+    header.levelCount = (uint32_t)count;
+    ok &= fwrite(&header, sizeof(header), 1, file) == 1;
+
+    /* Levels are padded to 8 bytes, so every one is aligned in place. */
+    offset = sizeof(header) + (uint64_t)count * sizeof(uint64_t);
+    for (int levelIndex = 0; levelIndex < count && ok; levelIndex++) {
+        level = LevelGenerate(levelMemory, evaluations[levelIndex].seed);
+        ok &= fwrite(&offset, sizeof(offset), 1, file) == 1;
+        offset += (LevelSize(level) + 7) & ~(uint64_t)7;
+    }
+    for (int levelIndex = 0; levelIndex < count && ok; levelIndex++) {
+        level = LevelGenerate(levelMemory, evaluations[levelIndex].seed);
+        size = (LevelSize(level) + 7) & ~(uint64_t)7;
+        ok &= fwrite(level, size, 1, file) == 1;
+    }
+
+    if (fclose(file) != 0)
+        ok = false;
+
+    return ok;
+}
+
+/*-----------------------------------------------------------------------------
+    GoldenLoad
+    Read a golden hash file: a line naming the frame size and whether the
+    frames had sprites, then one frame hash per line in hex. The frames
+    must be of the kind given. Returns false if the file cannot be read or
+    is for other frames.
+ ----------------------------------------------------------------------------*/
+bool GoldenLoad(const char *path, uint64_t *hashes, int capacity, int *count, int width, int height, bool sprites)
+{
+    FILE *file = fopen(path, "r");
+    char kind[16];
+    int fileWidth, fileHeight;
+    unsigned long long hash;
+
+    if (!file)
+        return false;
+
+    if (fscanf(file, "blocks-golden %dx%d %15s", &fileWidth, &fileHeight, kind) != 3
+        || fileWidth != width || fileHeight != height || strcmp(kind, sprites ? "sprites" : "flat") != 0) {
+        fclose(file);
+        return false;
+    }
+
+    *count = 0;
+    while (*count < capacity && fscanf(file, "%llx", &hash) == 1)
+        hashes[(*count)++] = hash;
+    fclose(file);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    GoldenSave
+    Write a golden hash file. Returns false on failure.
+ ----------------------------------------------------------------------------*/
+bool GoldenSave(const char *path, const uint64_t *hashes, int count, int width, int height, bool sprites)
+{
+    FILE *file = fopen(path, "w");
+
+    if (!file)
+        return false;
+
+    fprintf(file, "blocks-golden %dx%d %s\n", width, height, sprites ? "sprites" : "flat");
+    for (int frame = 0; frame < count; frame++)
+        fprintf(file, "%016llx\n", (unsigned long long)hashes[frame]);
+
+    return fclose(file) == 0;
+}
+
+/*-----------------------------------------------------------------------------
+    WritePpm
+    Write a frame of BGRX pixels to a binary PPM file, top row first as it
+    is shown. Returns false on failure.
+ ----------------------------------------------------------------------------*/
+bool WritePpm(const char *path, const struct bitmap_buffer *buffer)
+{
+    FILE *file = fopen(path, "wb");
+    const uint8_t *pixel;
+    uint8_t rgb[3];
+    bool written = true;
+
+    if (!file)
+        return false;
+
+    fprintf(file, "P6\n%d %d\n255\n", buffer->width, buffer->height);
+    for (int y = buffer->height - 1; y >= 0 && written; y--) {
+        pixel = (const uint8_t *)buffer->memory + (size_t)y * buffer->pitch;
+        for (int x = 0; x < buffer->width && written; x++) {
+            rgb[0] = pixel[2];
+            rgb[1] = pixel[1];
+            rgb[2] = pixel[0];
+            written = (fwrite(rgb, 1, 3, file) == 3);
+            pixel += BYTES_PER_PIXEL;
+        }
+    }
+    if (fclose(file) != 0)
+        written = false;
+
+    return written;
+}
+
+/*-----------------------------------------------------------------------------
+    ScriptLoad
+    Read an input script. Each line holds a tick, a key and whether the key
+    goes down or up, e.g. "120 left down". Lines must be in tick order.
+ ----------------------------------------------------------------------------*/
+bool ScriptLoad(struct script *script, const char *path)
+{
+    FILE *file;
+    char line[256], keyName[32], stateName[32];
+    int capacity = 0;
+    struct script_event event;
+
+    file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    script->events = NULL;
+    script->count = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%d %31s %31s", &event.tick, keyName, stateName) != 3)
+            continue;
+        if (strcmp(keyName, "left") == 0)
+            event.key = GAME_KEY_LEFT;
+        else if (strcmp(keyName, "right") == 0)
+            event.key = GAME_KEY_RIGHT;
+        else if (strcmp(keyName, "escape") == 0)
+            event.key = GAME_KEY_ESCAPE;
+        else
+            continue;
+        event.keyIsDown = (strcmp(stateName, "down") == 0);
+
+        if (script->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            script->events = realloc(script->events, capacity * sizeof(struct script_event));
+        }
+        script->events[script->count++] = event;
+    }
+    fclose(file);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    ComputeTimestampUs
+    Returns the current value of the monotonic clock in microseconds.
+ ----------------------------------------------------------------------------*/
+uint64_t ComputeTimestampUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * US_PER_SECOND + now.tv_nsec / 1000;
+}
+
+/*-----------------------------------------------------------------------------
+    WaitUntilUs
+    Wait until a monotonic time in microseconds: sleep for most of the
+    wait, then spin for the rest, as sleeps overshoot.
+ ----------------------------------------------------------------------------*/
+void WaitUntilUs(uint64_t wakeUs)
+{
+    uint64_t nowUs;
+    struct timespec sleep;
+
+    while ((nowUs = ComputeTimestampUs()) < wakeUs) {
+        if (wakeUs - nowUs > PACER_SPIN_US) {
+            sleep.tv_sec = (time_t)((wakeUs - nowUs - PACER_SPIN_US) / US_PER_SECOND);
+            sleep.tv_nsec = (long)((wakeUs - nowUs - PACER_SPIN_US) % US_PER_SECOND) * 1000;
+            nanosleep(&sleep, NULL);
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    MapFile
+    Map a whole file into memory, read only. Returns NULL on failure.
+ ----------------------------------------------------------------------------*/
+void *MapFile(const char *path, uint64_t *size)
+{
+    struct stat fileStat;
+    void *memory = NULL;
+
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return NULL;
+
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0) {
+        memory = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (memory == MAP_FAILED)
+            memory = NULL;
+        else
+            *size = fileStat.st_size;
+    }
+    /* The mapping stays valid after the file is closed. */
+    close(file);
+
+    return memory;
+}
+
+/*-----------------------------------------------------------------------------
+    UnmapFile
+    Unmap a file mapped by MapFile.
+ ----------------------------------------------------------------------------*/
+void UnmapFile(void *memory, uint64_t size)
+{
+    munmap(memory, size);
+
+    return;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/*=============================================================================
+    linux_main.h
+ =============================================================================*/
+
+#ifndef LINUX_MAIN_H
+#define LINUX_MAIN_H
+
+#include <pthread.h>
+
+#include "../game.h"
+#include "../levelgen.h"
+
+#define QVGA_WIDTH 320
+#define QVGA_HEIGHT 240
+#define BYTES_PER_PIXEL 4
+#define UPDATES_PER_SECOND 60
+#define MS_PER_UPDATE (1000.0f / UPDATES_PER_SECOND)
+#define TICKS_DEFAULT (UPDATES_PER_SECOND * 60)
+#define VERSUS_PORT 47000
+#define GOLDEN_DUMPS_MAX 16
+#define CHECKPOINT_INTERVAL_TICKS UPDATES_PER_SECOND
+#define EVALUATION_TICKS_DEFAULT (UPDATES_PER_SECOND * 60 * 5)
+#define EVALUATION_THREADS_MAX 64
+/* The serve angles searched, in degrees, centred on the rules' angle. */
+#define SEARCH_ANGLE_SPREAD 60.0
+
+enum simulation_mode {
+    tick,
+    fast
+};
+
+/* Frames are presented straight away, or to a simulated display that
+   refreshes once a tick, either as soon as the last one was shown or just
+   in time for the next refresh. */
+enum present_mode {
+    immediate,
+    vsync,
+    vsyncJustInTime
+};
+
+struct script_event {
+    int tick;
+    int key;
+    bool keyIsDown;
+};
+
+struct script {
+    struct script_event *events;
+    int count;
+};
+
+/* Levels are handed to the evaluation workers one at a time, so a worker
+   that draws quick levels takes more of them. */
+struct evaluation_job {
+    int levelCount;
+    int plays;
+    int ticksMax;
+    volatile uint32_t nextLevel;
+    struct level_evaluation *evaluations;
+};
+
+struct evaluation_worker {
+    struct evaluation_job *job;
+    struct game_state *gameState;
+    void *levelMemory;
+    pthread_t thread;
+};
+
+uint64_t ComputeTimestampUs(void);
+void WaitUntilUs(uint64_t);
+void *MapFile(const char *, uint64_t *);
+void UnmapFile(void *, uint64_t);
+bool ScriptLoad(struct script *, const char *);
+bool GoldenLoad(const char *, uint64_t *, int, int *, int, int, bool);
+bool GoldenSave(const char *, const uint64_t *, int, int, int, bool);
+bool WritePpm(const char *, const struct bitmap_buffer *);
+int RunVersus(const struct level_header *, int, int, int, const struct game_rules *);
+uint8_t VersusBot(const struct game_state *, int);
+int RunSearch(const struct level_header *, int, int, int, const struct game_rules *);
+void SearchPlay(struct game_state *, int);
+int RunEvaluation(int, int, uint32_t, int, int, const char *, const struct game_rules *);
+void *EvaluationWorker(void *);
+bool WriteLevelPack(const char *, const struct level_evaluation *, int);
+void PrintUsage(const char *);
+
+#endif /* LINUX_MAIN_H */
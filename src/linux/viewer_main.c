@@ -0,0 +1,280 @@
+/*=============================================================================
+    viewer_main.c
+    Spectator for games streamed by the headless runner. Decodes the
+    stream and draws it in the terminal, two pixels to a character cell.
+ =============================================================================*/
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "viewer_main.h"
+
+#include "../atomic.c"
+#include "../memory.c"
+#include "../stream.c"
+
+/*-----------------------------------------------------------------------------
+    main
+    Application entry point for the viewer.
+ ----------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    const char *listenPath = NULL;
+    const char *ppmPath = NULL;
+    int columns = VIEWER_COLUMNS_DEFAULT;
+    bool quiet = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "l:c:qo:h")) != -1) {
+        switch (option) {
+        case 'l':
+            listenPath = optarg;
+            break;
+        case 'c':
+            columns = atoi(optarg);
+            if (columns <= 0) {
+                ViewerUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        case 'o':
+            ppmPath = optarg;
+            break;
+        default:
+            ViewerUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    int input = ViewerOpen(listenPath, (optind < argc) ? argv[optind] : NULL);
+    if (input < 0) {
+        fprintf(stderr, "Could not open the stream.\n");
+        return 1;
+    }
+
+    uint8_t header[STREAM_HEADER_SIZE];
+    if (!ViewerRead(input, header, STREAM_HEADER_SIZE) || StreamGet32(header) != STREAM_MAGIC) {
+        fprintf(stderr, "Not a stream.\n");
+        return 1;
+    }
+    int width = (int)StreamGet32(header + 4);
+    int height = (int)StreamGet32(header + 8);
+    if (width <= 0 || height <= 0 || width > VIEWER_SIZE_MAX || height > VIEWER_SIZE_MAX) {
+        fprintf(stderr, "Frames of %dx%d are not supported.\n", width, height);
+        return 1;
+    }
+
+    int frameSize = width * height * STREAM_BYTES_PER_PIXEL;
+    int payloadMax = StreamPayloadMax(frameSize);
+    uint8_t *frame = calloc(1, frameSize);
+    uint8_t *payload = malloc(payloadMax);
+
+    /* Frames are decoded as fast as they come, and drawn at most 30 times
+       a second. */
+    uint8_t frameHeader[STREAM_FRAME_HEADER_SIZE];
+    uint64_t timeDrawnUs = 0;
+    uint64_t bytes = STREAM_HEADER_SIZE;
+    uint32_t frameFirst = 0, frameLast = 0;
+    int frames = 0;
+    bool drawn = true;
+    bool valid = true;
+    if (!quiet)
+        printf("\x1b[2J");
+    while (ViewerRead(input, frameHeader, STREAM_FRAME_HEADER_SIZE)) {
+        int payloadSize = (int)StreamGet32(frameHeader + 4);
+        if (payloadSize < 0 || payloadSize > payloadMax || !ViewerRead(input, payload, payloadSize)
+            || !StreamDecode(payload, payloadSize, frame, frameSize)) {
+            valid = false;
+            break;
+        }
+        frameLast = StreamGet32(frameHeader);
+        if (frames == 0)
+            frameFirst = frameLast;
+        frames++;
+        bytes += STREAM_FRAME_HEADER_SIZE + payloadSize;
+        drawn = false;
+
+        if (!quiet && ViewerTimestampUs() - timeDrawnUs >= VIEWER_DRAW_INTERVAL_US) {
+            ViewerDraw(frame, width, height, columns);
+            timeDrawnUs = ViewerTimestampUs();
+            drawn = true;
+        }
+    }
+    if (!quiet && !drawn)
+        ViewerDraw(frame, width, height, columns);
+
+    fprintf(stderr, "%dx%d frames %d (%u to %u, %u dropped) bytes %llu, %.0f per frame\n",
+        width, height, frames, frameFirst, frameLast, frames ? frameLast - frameFirst + 1 - frames : 0,
+        (unsigned long long)bytes, frames ? (double)bytes / frames : 0.0);
+    if (!valid)
+        fprintf(stderr, "The stream is corrupt.\n");
+    if (ppmPath && !ViewerWritePpm(ppmPath, frame, width, height)) {
+        fprintf(stderr, "Could not write %s.\n", ppmPath);
+        valid = false;
+    }
+
+    free(payload);
+    free(frame);
+    close(input);
+
+    return valid ? 0 : 1;
+}
+
+/*-----------------------------------------------------------------------------
+    ViewerOpen
+    Open the stream: wait on a Unix socket for the runner to connect, or
+    open a file or named pipe, or read standard input. Returns the file
+    descriptor, or -1 on failure.
+ ----------------------------------------------------------------------------*/
+int ViewerOpen(const char *listenPath, const char *path)
+{
+    struct sockaddr_un address;
+    int listener, connection;
+
+    if (!listenPath)
+        return path ? open(path, O_RDONLY) : STDIN_FILENO;
+
+    if (strlen(listenPath) >= sizeof(address.sun_path))
+        return -1;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, listenPath);
+    unlink(listenPath);
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+        return -1;
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 1) != 0) {
+        close(listener);
+        return -1;
+    }
+    connection = accept(listener, NULL, NULL);
+    close(listener);
+    unlink(listenPath);
+
+    return connection;
+}
+
+/*-----------------------------------------------------------------------------
+    ViewerRead
+    Read exactly a number of bytes. Returns false at the end of the stream.
+ ----------------------------------------------------------------------------*/
+bool ViewerRead(int input, uint8_t *bytes, int size)
+{
+    ssize_t count;
+
+    while (size > 0) {
+        count = read(input, bytes, size);
+        if (count <= 0)
+            return false;
+        bytes += count;
+        size -= (int)count;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    ViewerDraw
+    Draw a frame in the terminal in 24 bit colour, scaled down to fit a
+    number of columns. Each character cell is a half block, its foreground
+    the upper pixel and its background the lower one.
+ ----------------------------------------------------------------------------*/
+void ViewerDraw(const uint8_t *frame, int width, int height, int columns)
+{
+    int scale = (width + columns - 1) / columns;
+    int cellColumns = width / scale;
+    int cellRows = height / (scale * 2);
+    size_t capacity = (size_t)cellRows * (cellColumns * 40 + 8) + 16;
+    char *text = malloc(capacity);
+    const uint8_t *upper, *lower;
+    size_t length = 0;
+
+    length += sprintf(text + length, "\x1b[H");
+    for (int row = 0; row < cellRows; row++) {
+        for (int column = 0; column < cellColumns; column++) {
+            /* Pixels are BGRX, rows top down. */
+            upper = frame + ((size_t)(row * 2 * scale + scale / 2) * width + column * scale + scale / 2) * STREAM_BYTES_PER_PIXEL;
+            lower = upper + (size_t)scale * width * STREAM_BYTES_PER_PIXEL;
+            length += sprintf(text + length, "\x1b[38;2;%d;%d;%dm\x1b[48;2;%d;%d;%dm\xe2\x96\x80",
+                upper[2], upper[1], upper[0], lower[2], lower[1], lower[0]);
+        }
+        length += sprintf(text + length, "\x1b[0m\n");
+    }
+    fwrite(text, 1, length, stdout);
+    fflush(stdout);
+    free(text);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    ViewerWritePpm
+    Write a frame to a binary PPM file. Returns false on failure.
+ ----------------------------------------------------------------------------*/
+bool ViewerWritePpm(const char *path, const uint8_t *frame, int width, int height)
+{
+    FILE *file = fopen(path, "wb");
+    const uint8_t *pixel;
+    uint8_t rgb[3];
+    bool written = true;
+
+    if (!file)
+        return false;
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (int index = 0; index < width * height && written; index++) {
+        pixel = frame + (size_t)index * STREAM_BYTES_PER_PIXEL;
+        rgb[0] = pixel[2];
+        rgb[1] = pixel[1];
+        rgb[2] = pixel[0];
+        written = (fwrite(rgb, 1, 3, file) == 3);
+    }
+    if (fclose(file) != 0)
+        written = false;
+
+    return written;
+}
+
+/*-----------------------------------------------------------------------------
+    ViewerTimestampUs
+    Returns the current value of the monotonic clock in microseconds.
+ ----------------------------------------------------------------------------*/
+uint64_t ViewerTimestampUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/*-----------------------------------------------------------------------------
+    ViewerUsage
+    Print the command line options.
+ ----------------------------------------------------------------------------*/
+void ViewerUsage(const char *program)
+{
+    fprintf(stderr,
+        "usage: %s [-l socket] [-c columns] [-q] [-o ppm-file] [stream-file]\n"
+        "  -l  listen on a Unix socket for the runner to stream to\n"
+        "  -c  width of the picture in characters (default %d)\n"
+        "  -q  decode without drawing\n"
+        "  -o  write the last frame to a PPM file\n"
+        "  Without -l or a file, the stream is read from standard input.\n",
+        program, VIEWER_COLUMNS_DEFAULT);
+
+    return;
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+/*=============================================================================
+    viewer_main.h
+ =============================================================================*/
+
+#ifndef VIEWER_MAIN_H
+#define VIEWER_MAIN_H
+
+#include "../game.h"
+
+#define VIEWER_COLUMNS_DEFAULT 80
+#define VIEWER_SIZE_MAX 8192
+#define VIEWER_DRAW_INTERVAL_US (1000000 / 30)
+
+int ViewerOpen(const char *, const char *);
+bool ViewerRead(int, uint8_t *, int);
+void ViewerDraw(const uint8_t *, int, int, int);
+bool ViewerWritePpm(const char *, const uint8_t *, int, int);
+uint64_t ViewerTimestampUs(void);
+void ViewerUsage(const char *);
+
+#endif /* VIEWER_MAIN_H */
\ No newline at end of file
@@ -1,5 +1,5 @@
 #!/usr/bin/bash
 mkdir -p ../../build/Breakout.app/Contents/MacOS
 pushd ../../build/Breakout.app/Contents/MacOS > /dev/null
-gcc ../../../../src/mac/mac_main.m -o Breakout -framework Cocoa
+gcc ../../../../src/mac/mac_main.m -o Breakout -framework Cocoa -framework AudioToolbox
 popd > /dev/null
\ No newline at end of file
@@ -5,15 +5,36 @@
 #ifndef MAC_MAIN_H
 #define MAC_MAIN_H
 
+#include <AudioToolbox/AudioToolbox.h>
 #include "../game.h"
+#include "../audio.h"
+#include "../memory.h"
 
 #define QVGA_WIDTH 320.0f
 #define QVGA_HEIGHT 240.0f
 #define BYTES_PER_PIXEL 4
 #define BITS_PER_PIXEL_COMPONENT 8
 #define BITMAP_SIZE (int)QVGA_WIDTH * (int)QVGA_HEIGHT * BYTES_PER_PIXEL
+#define INDEX_BITMAP_SIZE (int)QVGA_WIDTH * (int)QVGA_HEIGHT
 #define MS_PER_UPDATE 1000.0f / 60.0f
 #define TIMER_INTERVAL 0.01666
+#define CORE_AUDIO_BUFFERS 3
+
+// Mixed blocks are queued on an audio queue; writing waits until one of
+// the blocks queued before has played.
+struct core_audio_sink {
+    AudioQueueRef queue;
+    AudioQueueBufferRef buffers[CORE_AUDIO_BUFFERS];
+    dispatch_semaphore_t bufferFree;
+    int next;
+};
+
+uint64_t ComputeTimestampUs(void);
+void *MapFile(const char *, uint64_t *);
+bool CoreAudioSinkOpen(struct audio_sink *, struct core_audio_sink *);
+bool CoreAudioSinkWrite(struct audio_sink *, const int16_t *, int);
+void CoreAudioSinkClose(struct audio_sink *);
+void CoreAudioSinkCallback(void *, AudioQueueRef, AudioQueueBufferRef);
 
 @interface AppDelegate : NSObject <NSApplicationDelegate>
 - (BOOL)applicationShouldTerminateAfterLastWindowClosed:(NSApplication *)theApplication;
@@ -21,20 +42,39 @@
 
 @interface WindowView : NSView {
 NSTimer *timer;
+bool timerIdle;
 uint64_t timeStartAbsolute;
 uint64_t timeEndAbsolute;
 uint64_t timeElapsedAbsolute;
 uint64_t timeElapsedNanoseconds;
 float timeElapsedMilliseconds;
 float timeAccumulatorMilliseconds;
-struct game_state gameState;
+struct memory_reservation memory;
+struct game_state *gameState;
+struct input_queue *inputQueue;
+struct latency_tracer *latencyTracer;
+struct autopilot autopilot;
 struct bitmap_buffer gameBitmapBuffer;
+struct bitmap_buffer frameBitmapBuffer;
+struct palette palette;
+struct sprite_atlas *spriteAtlas;
+struct audio_sink audioSink;
+struct core_audio_sink coreAudioSink;
+struct audio_mixer *audioMixer;
+bool audioStarted;
 }
 
 - (instancetype)initWithFrame:(NSRect)frameRect;
+- (void)viewDidMoveToWindow;
+- (void)windowDidChangeOcclusionState:(NSNotification *)notification;
 - (BOOL)acceptsFirstResponder;
 - (void)keyDown:(NSEvent *)event;
-- (void)gameLoop:(NSTimer *)timer;
+- (void)queueKey:(int)key isDown:(bool)keyIsDown;
+- (void)loadLevel:(const struct level_header *)level;
+- (void)startGameLoop:(NSTimeInterval)interval repeats:(BOOL)repeats;
+- (void)stopGameLoop;
+- (void)wakeGameLoop;
+- (void)gameLoop:(NSTimer *)firedTimer;
 - (void)drawRect:(NSRect)rect;
 - (void)dealloc;
 @end
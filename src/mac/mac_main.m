@@ -5,8 +5,28 @@
 #import <Cocoa/Cocoa.h>
 #import "mac_main.h"
 #include <mach/mach_time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../atomic.c"
+#include "../input.c"
+#include "../latency.c"
 #include "../text.c"
+#include "../palette.c"
+#include "../render.c"
+#include "../sprite.c"
+#include "../particles.c"
+#include "../audio.c"
+#include "../level.c"
+#include "../memory.c"
 #include "../game.c"
+#include "../rules.c"
+#include "../bricks.c"
+#include "../simulate.c"
+#include "../kernels.c"
+#include "../telemetry.c"
+#include "../autopilot.c"
 
 //-----------------------------------------------------------------------------
 //  main
@@ -50,6 +70,20 @@ int main(int argc, const char *argv[])
 	[window setTitle:appName];
     WindowView *windowView = [[[WindowView alloc] initWithFrame:windowRect] autorelease];
     [window setContentView:windowView];
+
+    // Load a level file or level pack given on the command line. It stays
+    // mapped for the lifetime of the process.
+    if (argc > 1) {
+        uint64_t levelFileSize = 0;
+        void *levelFile = MapFile(argv[1], &levelFileSize);
+        const struct level_header *level = NULL;
+        if (levelFile)
+            level = LevelLoad(levelFile, levelFileSize, (argc > 2) ? atoi(argv[2]) : 0);
+        if (level)
+            [windowView loadLevel:level];
+        else
+            NSLog(@"Could not load the level, using the default level.");
+    }
 	[window autorelease];
 
 	[window makeKeyAndOrderFront:nil];
@@ -61,6 +95,129 @@ int main(int argc, const char *argv[])
 	return 0;
 }
 
+//-----------------------------------------------------------------------------
+//  ComputeTimestampUs
+//  Returns the current absolute time in microseconds.
+//-----------------------------------------------------------------------------
+uint64_t ComputeTimestampUs(void)
+{
+    static mach_timebase_info_data_t timebaseInfo;
+    if (timebaseInfo.denom == 0)
+        (void) mach_timebase_info(&timebaseInfo);
+
+    return mach_absolute_time() * timebaseInfo.numer / timebaseInfo.denom / NSEC_PER_USEC;
+}
+
+//-----------------------------------------------------------------------------
+//  MapFile
+//  Map a whole file into memory, read only. Returns NULL on failure.
+//-----------------------------------------------------------------------------
+void *MapFile(const char *path, uint64_t *size)
+{
+    struct stat fileStat;
+    void *memory = NULL;
+
+    int file = open(path, O_RDONLY);
+    if (file < 0)
+        return NULL;
+
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0) {
+        memory = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (memory == MAP_FAILED)
+            memory = NULL;
+        else
+            *size = fileStat.st_size;
+    }
+    // The mapping stays valid after the file is closed.
+    close(file);
+
+    return memory;
+}
+
+//-----------------------------------------------------------------------------
+//  CoreAudioSinkOpen
+//  Open an audio queue on the default output for mono 16 bit samples at
+//  the mixer's rate. Returns false if there is no output.
+//-----------------------------------------------------------------------------
+bool CoreAudioSinkOpen(struct audio_sink *sink, struct core_audio_sink *coreAudio)
+{
+    AudioStreamBasicDescription format = {0};
+
+    format.mSampleRate = AUDIO_SAMPLE_RATE;
+    format.mFormatID = kAudioFormatLinearPCM;
+    format.mFormatFlags = kLinearPCMFormatFlagIsSignedInteger | kLinearPCMFormatFlagIsPacked;
+    format.mBytesPerPacket = sizeof(int16_t);
+    format.mFramesPerPacket = 1;
+    format.mBytesPerFrame = sizeof(int16_t);
+    format.mChannelsPerFrame = 1;
+    format.mBitsPerChannel = 16;
+
+    // With no run loop the callback runs on the audio queue's own thread.
+    if (AudioQueueNewOutput(&format, CoreAudioSinkCallback, coreAudio, NULL, NULL, 0, &coreAudio->queue) != noErr)
+        return false;
+    for (int buffer = 0; buffer < CORE_AUDIO_BUFFERS; buffer++)
+        AudioQueueAllocateBuffer(coreAudio->queue, AUDIO_BLOCK_FRAMES * sizeof(int16_t), &coreAudio->buffers[buffer]);
+    coreAudio->bufferFree = dispatch_semaphore_create(CORE_AUDIO_BUFFERS);
+    coreAudio->next = 0;
+    AudioQueueStart(coreAudio->queue, NULL);
+
+    sink->context = coreAudio;
+    sink->write = CoreAudioSinkWrite;
+    sink->close = CoreAudioSinkClose;
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//  CoreAudioSinkWrite
+//  Queue a block of samples, waiting for the oldest queued block to finish
+//  playing if every buffer is in use.
+//-----------------------------------------------------------------------------
+bool CoreAudioSinkWrite(struct audio_sink *sink, const int16_t *samples, int frameCount)
+{
+    struct core_audio_sink *coreAudio = sink->context;
+    AudioQueueBufferRef buffer = coreAudio->buffers[coreAudio->next];
+
+    dispatch_semaphore_wait(coreAudio->bufferFree, DISPATCH_TIME_FOREVER);
+    memcpy(buffer->mAudioData, samples, frameCount * sizeof(int16_t));
+    buffer->mAudioDataByteSize = frameCount * sizeof(int16_t);
+    if (AudioQueueEnqueueBuffer(coreAudio->queue, buffer, 0, NULL) != noErr) {
+        dispatch_semaphore_signal(coreAudio->bufferFree);
+        return false;
+    }
+    coreAudio->next = (coreAudio->next + 1) % CORE_AUDIO_BUFFERS;
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//  CoreAudioSinkClose
+//  Stop playback and dispose of the audio queue.
+//-----------------------------------------------------------------------------
+void CoreAudioSinkClose(struct audio_sink *sink)
+{
+    struct core_audio_sink *coreAudio = sink->context;
+
+    AudioQueueStop(coreAudio->queue, true);
+    AudioQueueDispose(coreAudio->queue, true);
+    dispatch_release(coreAudio->bufferFree);
+
+    return;
+}
+
+//-----------------------------------------------------------------------------
+//  CoreAudioSinkCallback
+//  Called by the audio queue when a buffer has played.
+//-----------------------------------------------------------------------------
+void CoreAudioSinkCallback(void *context, AudioQueueRef queue, AudioQueueBufferRef buffer)
+{
+    struct core_audio_sink *coreAudio = context;
+
+    dispatch_semaphore_signal(coreAudio->bufferFree);
+
+    return;
+}
+
 //@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 //  AppDelegate
 //  Delegate for the main application.
@@ -91,7 +248,17 @@ int main(int argc, const char *argv[])
 //-----------------------------------------------------------------------------
 - (void)dealloc
 {
-    free(gameBitmapBuffer.memory);
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [timer invalidate];
+    [timer release];
+    if (audioStarted) {
+        AudioMixerStop(audioMixer);
+        audioSink.close(&audioSink);
+    }
+    if (memory.base) {
+        LatencyTraceClose(latencyTracer);
+        MemoryRelease(&memory);
+    }
     [super dealloc];
 }
 
@@ -102,24 +269,83 @@ int main(int argc, const char *argv[])
 - (instancetype)initWithFrame:(NSRect)frameRect
 {
     if(self = [super initWithFrame:frameRect]) {
-        timer = [NSTimer scheduledTimerWithTimeInterval:TIMER_INTERVAL
-                         target:self
-                         selector:@selector(gameLoop:)
-                         userInfo:nil
-                         repeats:YES];
+        // Reserve all the game's memory up front, the game state first.
+        size_t permanentSize = ARENA_SIZE(sizeof(struct game_state))
+            + ARENA_SIZE(BrickBaseSize(BRICK_CAPACITY_MAX))
+            + ARENA_SIZE(sizeof(struct particle_system))
+            + ARENA_SIZE(sizeof(struct audio_mixer))
+            + ARENA_SIZE(sizeof(struct input_queue))
+            + ARENA_SIZE(sizeof(struct latency_tracer))
+            + ARENA_SIZE(INDEX_BITMAP_SIZE)
+            + ARENA_SIZE(BITMAP_SIZE)
+            + ARENA_SIZE(sizeof(struct sprite_atlas));
+        if (!MemoryReserve(&memory, permanentSize, sizeof(struct render_list))) {
+            [self release];
+            return nil;
+        }
+        [self startGameLoop:TIMER_INTERVAL repeats:YES];
         timeStartAbsolute = mach_absolute_time();
         timeAccumulatorMilliseconds = 0.0f;
-        GameInit(&gameState);
-        gameBitmapBuffer.memory = malloc(BITMAP_SIZE);
-        gameBitmapBuffer.memorySize = BITMAP_SIZE;
+        gameState = ArenaPush(&memory.permanent, sizeof(struct game_state));
+        BrickSetInit(&gameState->bricks, ArenaPush(&memory.permanent, BrickBaseSize(BRICK_CAPACITY_MAX)), BRICK_CAPACITY_MAX);
+        gameState->particles = ArenaPush(&memory.permanent, sizeof(struct particle_system));
+        ParticleSystemInit(gameState->particles, (uint32_t)ComputeTimestampUs());
+        // Sounds are mixed on a thread paced by the audio queue. Without
+        // an output the game is silent.
+        audioMixer = ArenaPush(&memory.permanent, sizeof(struct audio_mixer));
+        audioStarted = CoreAudioSinkOpen(&audioSink, &coreAudioSink);
+        if (audioStarted) {
+            AudioMixerInit(audioMixer, &audioSink);
+            gameState->audio = &audioMixer->queue;
+            AudioMixerStart(audioMixer);
+        }
+        GameInit(gameState, NULL);
+        inputQueue = ArenaPush(&memory.permanent, sizeof(struct input_queue));
+        InputQueueInit(inputQueue);
+        AutopilotInit(&autopilot);
+        latencyTracer = ArenaPush(&memory.permanent, sizeof(struct latency_tracer));
+        LatencyTraceInit(latencyTracer, getenv("BLOCKS_LATENCY_TRACE"));
+        gameBitmapBuffer.memory = ArenaPush(&memory.permanent, INDEX_BITMAP_SIZE);
+        gameBitmapBuffer.memorySize = INDEX_BITMAP_SIZE;
         gameBitmapBuffer.width = (int)QVGA_WIDTH;
         gameBitmapBuffer.height = (int)QVGA_HEIGHT;
-        gameBitmapBuffer.pitch = (int)QVGA_WIDTH * (int)BYTES_PER_PIXEL;
+        gameBitmapBuffer.pitch = (int)QVGA_WIDTH;
+        frameBitmapBuffer.memory = ArenaPush(&memory.permanent, BITMAP_SIZE);
+        frameBitmapBuffer.memorySize = BITMAP_SIZE;
+        frameBitmapBuffer.width = (int)QVGA_WIDTH;
+        frameBitmapBuffer.height = (int)QVGA_HEIGHT;
+        frameBitmapBuffer.pitch = (int)QVGA_WIDTH * (int)BYTES_PER_PIXEL;
+        PaletteInit(&palette, PIXEL_FORMAT_RGBA);
+        spriteAtlas = ArenaPush(&memory.permanent, sizeof(struct sprite_atlas));
+        SpriteAtlasInit(spriteAtlas, &palette);
     }
 
     return self;
 }
 
+//-----------------------------------------------------------------------------
+//  viewDidMoveToWindow
+//  Watch the window, to wake the game loop when it is shown again.
+//-----------------------------------------------------------------------------
+- (void)viewDidMoveToWindow
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    if ([self window])
+        [[NSNotificationCenter defaultCenter] addObserver:self
+                                              selector:@selector(windowDidChangeOcclusionState:)
+                                              name:NSWindowDidChangeOcclusionStateNotification
+                                              object:[self window]];
+}
+
+//-----------------------------------------------------------------------------
+//  windowDidChangeOcclusionState
+//  The window was shown, hidden, minimized or restored.
+//-----------------------------------------------------------------------------
+- (void)windowDidChangeOcclusionState:(NSNotification *)notification
+{
+    [self wakeGameLoop];
+}
+
 //-----------------------------------------------------------------------------
 //  acceptsFirstResponder
 //  Make this the first object that responds to events.
@@ -143,11 +369,11 @@ int main(int argc, const char *argv[])
         if ([keyArrow length] == 1) {
             keyChar = [keyArrow characterAtIndex:0];
             if (keyChar == NSLeftArrowFunctionKey) {
-                GameKeyboardUpdate(&gameState, GAME_KEY_LEFT, true);
+                [self queueKey:GAME_KEY_LEFT isDown:true];
                 return;
             }
             else if (keyChar == NSRightArrowFunctionKey) {
-                GameKeyboardUpdate(&gameState, GAME_KEY_RIGHT, true);
+                [self queueKey:GAME_KEY_RIGHT isDown:true];
                 return;
             }
         }
@@ -155,7 +381,13 @@ int main(int argc, const char *argv[])
     switch([event keyCode]) {
     case 53: // esc
         if (![event isARepeat])
-            GameKeyboardUpdate(&gameState, GAME_KEY_ESCAPE, true);
+            [self queueKey:GAME_KEY_ESCAPE isDown:true];
+        return;
+    case 96: // F5
+        if (![event isARepeat]) {
+            AutopilotToggle(&autopilot, gameState, inputQueue, ComputeTimestampUs());
+            [self wakeGameLoop];
+        }
         return;
     }
 
@@ -176,30 +408,97 @@ int main(int argc, const char *argv[])
         if ([keyArrow length] == 1) {
             keyChar = [keyArrow characterAtIndex:0];
             if (keyChar == NSLeftArrowFunctionKey) {
-                GameKeyboardUpdate(&gameState, GAME_KEY_LEFT, false);
+                [self queueKey:GAME_KEY_LEFT isDown:false];
                 return;
             }
             else if (keyChar == NSRightArrowFunctionKey) {
-                GameKeyboardUpdate(&gameState, GAME_KEY_RIGHT, false);
+                [self queueKey:GAME_KEY_RIGHT isDown:false];
                 return;
             }
         }
     }
     switch([event keyCode]) {
     case 53: // esc
-        GameKeyboardUpdate(&gameState, GAME_KEY_ESCAPE, false);
+        [self queueKey:GAME_KEY_ESCAPE isDown:false];
         return;
     }
 
     [super keyDown:event];
 }
 
+//-----------------------------------------------------------------------------
+//  queueKey
+//  Queue a key press/release for the game and start tracing its latency.
+//-----------------------------------------------------------------------------
+- (void)queueKey:(int)key isDown:(bool)keyIsDown
+{
+    uint64_t timestampUs = ComputeTimestampUs();
+    uint32_t inputId = GameKeyboardUpdate(inputQueue, key, keyIsDown, timestampUs);
+    LatencyTraceInput(latencyTracer, inputId, timestampUs);
+    [self wakeGameLoop];
+}
+
+//-----------------------------------------------------------------------------
+//  loadLevel
+//  Restart the game on a level. The level must stay mapped.
+//-----------------------------------------------------------------------------
+- (void)loadLevel:(const struct level_header *)level
+{
+    GameInit(gameState, level);
+    [self wakeGameLoop];
+}
+
+//-----------------------------------------------------------------------------
+//  startGameLoop
+//  Replace the game loop's timer with one that fires after an interval,
+//  and keeps firing at that interval if it repeats.
+//-----------------------------------------------------------------------------
+- (void)startGameLoop:(NSTimeInterval)interval repeats:(BOOL)repeats
+{
+    [timer invalidate];
+    [timer release];
+    timer = [[NSTimer scheduledTimerWithTimeInterval:interval
+                      target:self
+                      selector:@selector(gameLoop:)
+                      userInfo:nil
+                      repeats:repeats] retain];
+    timerIdle = !repeats;
+}
+
+//-----------------------------------------------------------------------------
+//  stopGameLoop
+//  Stop the game loop until it is woken.
+//-----------------------------------------------------------------------------
+- (void)stopGameLoop
+{
+    [timer invalidate];
+    [timer release];
+    timer = nil;
+}
+
+//-----------------------------------------------------------------------------
+//  wakeGameLoop
+//  Run the game loop at the update rate again if it was slowed or stopped
+//  while the frame could not change. The time it was stopped for does not
+//  count, so the game carries on where it was.
+//-----------------------------------------------------------------------------
+- (void)wakeGameLoop
+{
+    if (!timer)
+        timeStartAbsolute = mach_absolute_time();
+    if (!timer || timerIdle)
+        [self startGameLoop:TIMER_INTERVAL repeats:YES];
+}
+
 //-----------------------------------------------------------------------------
 //  gameLoop
 //  Update the game state and render. This function is called periodically
-//  by a timer that starts when the NSView is created.
+//  by a timer that starts when the NSView is created. Nothing is rendered
+//  while the frame would come out the same; the timer is slowed to fire
+//  when the frame will next change, or stopped while the game is paused or
+//  the window cannot be seen, until input or the window wakes it.
 //-----------------------------------------------------------------------------
-- (void)gameLoop:(NSTimer *)timer
+- (void)gameLoop:(NSTimer *)firedTimer
 {
     static mach_timebase_info_data_t timebaseInfo;
     if (timebaseInfo.denom == 0)
@@ -210,16 +509,42 @@ int main(int argc, const char *argv[])
     timeElapsedMilliseconds = (float) timeElapsedNanoseconds / NSEC_PER_MSEC;
     timeAccumulatorMilliseconds += timeElapsedMilliseconds;
 
+    AutopilotUpdate(&autopilot, gameState, inputQueue, ComputeTimestampUs(), MS_PER_UPDATE);
+
+    // Line the simulation clock up with the wall clock so queued input lands
+    // at the right point within each tick.
+    gameState->tickTimeUs = ComputeTimestampUs() - (uint64_t)(timeAccumulatorMilliseconds * US_PER_MS);
+
     while (timeAccumulatorMilliseconds >= MS_PER_UPDATE) {
-        GameUpdate(MS_PER_UPDATE, &gameState);
+        GameUpdate(MS_PER_UPDATE, gameState, inputQueue);
         timeAccumulatorMilliseconds -= MS_PER_UPDATE;
     }
+    LatencyTraceUpdate(latencyTracer, gameState->inputLastId, ComputeTimestampUs());
 
-    GameRender(&gameState, &gameBitmapBuffer);
+    timeStartAbsolute = timeEndAbsolute;
 
-    [self setNeedsDisplay:YES];
+    NSWindow *window = [self window];
+    bool windowVisible = ([window occlusionState] & NSWindowOcclusionStateVisible) && ![window isMiniaturized];
+    if (!windowVisible || !gameState->frameChanged) {
+        float secondsIdle = windowVisible ? GameSecondsIdle(gameState, inputQueue) : GAME_IDLE_FOREVER;
+        if (secondsIdle >= GAME_IDLE_FOREVER)
+            [self stopGameLoop];
+        else if (secondsIdle > TIMER_INTERVAL)
+            [self startGameLoop:secondsIdle repeats:NO];
+        else
+            [self wakeGameLoop];
+        return;
+    }
+    gameState->frameChanged = false;
+    [self wakeGameLoop];
 
-    timeStartAbsolute = timeEndAbsolute;
+    ArenaReset(&memory.transient);
+    struct render_list *renderList = ArenaPush(&memory.transient, sizeof(struct render_list));
+    GameRender(gameState, renderList);
+    RenderFrame(NULL, renderList, &gameBitmapBuffer, &palette, spriteAtlas, &frameBitmapBuffer);
+    LatencyTraceRender(latencyTracer, ComputeTimestampUs());
+
+    [self setNeedsDisplay:YES];
 }
 
 //-----------------------------------------------------------------------------
@@ -230,16 +555,16 @@ int main(int argc, const char *argv[])
 {
     NSRect bounds = [self bounds];
     NSBitmapImageRep *imageRep = [[[NSBitmapImageRep alloc] 
-                                  initWithBitmapDataPlanes:(void *)&gameBitmapBuffer.memory
-                                  pixelsWide:gameBitmapBuffer.width
-                                  pixelsHigh:gameBitmapBuffer.height
+                                  initWithBitmapDataPlanes:(void *)&frameBitmapBuffer.memory
+                                  pixelsWide:frameBitmapBuffer.width
+                                  pixelsHigh:frameBitmapBuffer.height
                                   bitsPerSample:BITS_PER_PIXEL_COMPONENT
                                   samplesPerPixel:BYTES_PER_PIXEL
                                   hasAlpha:YES
                                   isPlanar:NO
                                   colorSpaceName:NSCalibratedRGBColorSpace
                                   bitmapFormat:NSAlphaNonpremultipliedBitmapFormat
-                                  bytesPerRow:(BYTES_PER_PIXEL * gameBitmapBuffer.width)
+                                  bytesPerRow:(BYTES_PER_PIXEL * frameBitmapBuffer.width)
                                   bitsPerPixel:(BITS_PER_PIXEL_COMPONENT * BYTES_PER_PIXEL)]
                                   autorelease];
     NSImage *image = [[[NSImage alloc] initWithSize:NSMakeSize(QVGA_WIDTH, QVGA_HEIGHT)] autorelease];
@@ -253,6 +578,15 @@ int main(int argc, const char *argv[])
            fromRect:NSZeroRect
            operation:NSCompositeCopy
            fraction:1.0];
+
+    // setNeedsDisplay only schedules the draw, so the frame counts as
+    // presented once it has been drawn here.
+    LatencyTracePresent(latencyTracer, ComputeTimestampUs());
+    if (latencyTracer->eventsSinceReport >= LATENCY_REPORT_EVENTS) {
+        char report[LATENCY_REPORT_SIZE];
+        LatencyTraceReport(latencyTracer, report, sizeof(report));
+        NSLog(@"%s", report);
+    }
 }
 
 @end // @implementation WindowView
\ No newline at end of file
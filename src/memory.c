@@ -0,0 +1,161 @@
+/*=============================================================================
+    memory.c
+ =============================================================================*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+#include "memory.h"
+
+/*-----------------------------------------------------------------------------
+    ArenaInit
+    Initialize an arena over a block of memory. The memory stays owned by
+    the caller.
+ ----------------------------------------------------------------------------*/
+void ArenaInit(struct memory_arena *arena, void *memory, size_t size)
+{
+    arena->memory = memory;
+    arena->size = size;
+    arena->used = 0;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    ArenaPush
+    Allocate from an arena. Returns NULL if the arena is full.
+ ----------------------------------------------------------------------------*/
+void *ArenaPush(struct memory_arena *arena, size_t size)
+{
+    size_t start = (arena->used + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    if (start > arena->size || size > arena->size - start)
+        return NULL;
+
+    arena->used = start + size;
+
+    return arena->memory + start;
+}
+
+/*-----------------------------------------------------------------------------
+    ArenaReset
+    Free everything allocated from an arena in one go.
+ ----------------------------------------------------------------------------*/
+void ArenaReset(struct memory_arena *arena)
+{
+    arena->used = 0;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    MemoryReserve
+    Reserve and commit a game's memory and split it into the permanent and
+    transient regions. Huge pages are used if the system will give them,
+    which cuts TLB misses when the game runs flat out. Memory comes zeroed.
+    Returns false if there is not enough memory.
+ ----------------------------------------------------------------------------*/
+bool MemoryReserve(struct memory_reservation *reservation, size_t permanentSize, size_t transientSize)
+{
+    size_t size;
+
+    permanentSize = ARENA_SIZE(permanentSize);
+    transientSize = ARENA_SIZE(transientSize);
+    size = permanentSize + transientSize;
+    reservation->base = NULL;
+    reservation->pages = MEMORY_PAGES_NORMAL;
+
+#ifdef _WIN32
+    /* Large pages need the lock pages privilege, which the user must have
+       been granted; it is off in the process until it is asked for. */
+    HANDLE token;
+    TOKEN_PRIVILEGES privileges;
+    size_t largePageSize = GetLargePageMinimum();
+    size_t largeSize;
+
+    if (largePageSize > 0 && OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token)) {
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if (LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+            && AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL)
+            && GetLastError() == ERROR_SUCCESS) {
+            largeSize = (size + largePageSize - 1) & ~(largePageSize - 1);
+            reservation->base = VirtualAlloc(NULL, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (reservation->base) {
+                size = largeSize;
+                reservation->pages = MEMORY_PAGES_HUGE;
+            }
+        }
+        CloseHandle(token);
+    }
+    if (!reservation->base)
+        reservation->base = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!reservation->base)
+        return false;
+#else
+    size = (size + MEMORY_HUGE_PAGE_SIZE - 1) & ~(size_t)(MEMORY_HUGE_PAGE_SIZE - 1);
+    reservation->base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    /* Only works if huge pages have been set aside for the system. */
+    reservation->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (reservation->base != MAP_FAILED)
+        reservation->pages = MEMORY_PAGES_HUGE;
+#endif
+    if (reservation->base == MAP_FAILED)
+        reservation->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reservation->base == MAP_FAILED) {
+        reservation->base = NULL;
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    /* Otherwise ask for transparent huge pages. */
+    if (reservation->pages == MEMORY_PAGES_NORMAL && madvise(reservation->base, size, MADV_HUGEPAGE) == 0)
+        reservation->pages = MEMORY_PAGES_TRANSPARENT;
+#endif
+#endif
+
+    reservation->size = size;
+    ArenaInit(&reservation->permanent, reservation->base, permanentSize);
+    ArenaInit(&reservation->transient, (uint8_t *)reservation->base + permanentSize, size - permanentSize);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    MemoryRelease
+    Give a game's memory back to the system.
+ ----------------------------------------------------------------------------*/
+void MemoryRelease(struct memory_reservation *reservation)
+{
+#ifdef _WIN32
+    VirtualFree(reservation->base, 0, MEM_RELEASE);
+#else
+    munmap(reservation->base, reservation->size);
+#endif
+    reservation->base = NULL;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    MemoryPagesName
+    Returns a description of the kind of pages memory was given.
+ ----------------------------------------------------------------------------*/
+const char *MemoryPagesName(enum memory_pages pages)
+{
+    switch (pages) {
+    case MEMORY_PAGES_HUGE:
+        return "huge pages";
+    case MEMORY_PAGES_TRANSPARENT:
+        return "transparent huge pages";
+    default:
+        return "normal pages";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+/*=============================================================================
+    memory.h
+ =============================================================================*/
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ARENA_ALIGNMENT 16
+/* The most a push of a size can take from an arena, alignment included. */
+#define ARENA_SIZE(size) (((size_t)(size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+#define MEMORY_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/* A bump allocator over a block of memory owned by the caller. Allocations
+   are never freed one by one; the whole arena is reset at once. */
+struct memory_arena {
+    uint8_t *memory;
+    size_t size;
+    size_t used;
+};
+
+enum memory_pages {
+    MEMORY_PAGES_NORMAL,
+    MEMORY_PAGES_HUGE,
+    MEMORY_PAGES_TRANSPARENT
+};
+
+/* All of a game's memory, reserved from the system in one go. The
+   permanent region holds what lives as long as the game, with the game
+   state first, so the state is one block that can be copied or saved
+   whole. The transient region is reset at the start of every frame and
+   holds what lasts a frame: the render command list and scratch space. */
+struct memory_reservation {
+    void *base;
+    size_t size;
+    enum memory_pages pages;
+    struct memory_arena permanent;
+    struct memory_arena transient;
+};
+
+void ArenaInit(struct memory_arena *, void *, size_t);
+void *ArenaPush(struct memory_arena *, size_t);
+void ArenaReset(struct memory_arena *);
+bool MemoryReserve(struct memory_reservation *, size_t, size_t);
+void MemoryRelease(struct memory_reservation *);
+const char *MemoryPagesName(enum memory_pages);
+
+#endif /* MEMORY_H */
\ No newline at end of file
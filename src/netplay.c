@@ -0,0 +1,493 @@
+/*=============================================================================
+    netplay.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include "game.h"
+#include "bricks.h"
+#include "netplay.h"
+
+/*-----------------------------------------------------------------------------
+    NetplayOpen
+    Start a session for one player of a versus game, talking UDP from a
+    local port to the other player's address and port. The game state must
+    already be initialized in versus mode, identically at both ends.
+    Returns false if the socket cannot be set up, with nothing left open.
+ ----------------------------------------------------------------------------*/
+bool NetplayOpen(struct netplay_session *session, int localPlayer, float deltaTimeMs, int localPort, const char *peerAddress, int peerPort)
+{
+    struct sockaddr_in local;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    u_long nonBlocking = 1;
+
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+        return false;
+#endif
+
+    memset(session, 0, sizeof(*session));
+    session->localPlayer = localPlayer;
+    session->deltaTimeMs = deltaTimeMs;
+    session->rollbackTick = NETPLAY_TICK_NONE;
+    session->random = 1;
+
+    session->peer.sin_family = AF_INET;
+    session->peer.sin_port = htons((uint16_t)peerPort);
+    if (inet_pton(AF_INET, peerAddress, &session->peer.sin_addr) != 1) {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+
+    session->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (session->socket == NETPLAY_SOCKET_INVALID) {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+        return false;
+    }
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons((uint16_t)localPort);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(session->socket, (struct sockaddr *)&local, sizeof(local)) != 0) {
+        NetplayClose(session);
+        return false;
+    }
+
+    /* Packets are polled for once a tick; the game never waits on them. */
+#ifdef _WIN32
+    if (ioctlsocket(session->socket, FIONBIO, &nonBlocking) != 0) {
+#else
+    int flags = fcntl(session->socket, F_GETFL, 0);
+    if (flags < 0 || fcntl(session->socket, F_SETFL, flags | O_NONBLOCK) != 0) {
+#endif
+        NetplayClose(session);
+        return false;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayClose
+    Close a session's socket.
+ ----------------------------------------------------------------------------*/
+void NetplayClose(struct netplay_session *session)
+{
+#ifdef _WIN32
+    closesocket(session->socket);
+    WSACleanup();
+#else
+    close(session->socket);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplaySetConditions
+    Make the network worse than it is, for testing: hold every packet back
+    for a number of frames, and drop a percentage of them.
+ ----------------------------------------------------------------------------*/
+void NetplaySetConditions(struct netplay_session *session, int latencyTicks, int lossPercent, uint32_t seed)
+{
+    session->latencyTicks = latencyTicks;
+    session->lossPercent = lossPercent;
+    session->random = seed ? seed : 1;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayAdvance
+    Run one frame: take in the other player's input, roll back and simulate
+    again if it differs from what was predicted, then simulate the next tick
+    with the local player's buttons. Returns false, without simulating, if
+    the game is too far ahead of the other player to roll back any more;
+    the caller should try again next frame with the same buttons.
+ ----------------------------------------------------------------------------*/
+bool NetplayAdvance(struct netplay_session *session, struct game_state *gameState, uint8_t buttons)
+{
+    struct particle_system *particles = gameState->particles;
+    struct audio_queue *audio = gameState->audio;
+    struct telemetry *telemetry = gameState->telemetry;
+    uint32_t tickCurrent = session->tick;
+    int ticks;
+
+    session->frame++;
+    NetplayReceive(session);
+
+    /* Roll back to the first tick that was simulated with a wrong guess and
+       simulate up to the present again. Snapshots have no effects or
+       telemetry, which were shown and counted the first time round, so
+       they are put back once the game has caught up. */
+    if (session->rollbackTick < tickCurrent) {
+        ticks = tickCurrent - session->rollbackTick;
+        GameSnapshotLoad(gameState, &session->snapshots[session->rollbackTick % NETPLAY_ROLLBACK_MAX]);
+        session->tick = session->rollbackTick;
+        while (session->tick < tickCurrent)
+            NetplaySimulate(session, gameState);
+        gameState->particles = particles;
+        gameState->audio = audio;
+        gameState->telemetry = telemetry;
+        session->rollbacks++;
+        session->ticksResimulated += ticks;
+        if (ticks > session->resimulatedMax)
+            session->resimulatedMax = ticks;
+    }
+    session->rollbackTick = NETPLAY_TICK_NONE;
+
+    /* The other player may also be ahead. */
+    if ((int32_t)(session->tick - session->remoteTicks) >= NETPLAY_ROLLBACK_MAX - 1) {
+        session->stalls++;
+        NetplaySend(session);
+        return false;
+    }
+
+    session->inputs[session->localPlayer][session->tick & NETPLAY_INPUT_MASK] = buttons;
+    NetplaySimulate(session, gameState);
+    NetplaySend(session);
+    NetplayCheck(session);
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayPoll
+    Keep the other player's inputs coming and this end's going, for frames
+    in which the game does not advance, e.g. while it waits to start or
+    after it ends.
+ ----------------------------------------------------------------------------*/
+void NetplayPoll(struct netplay_session *session)
+{
+    session->frame++;
+    NetplayReceive(session);
+    NetplaySend(session);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplaySimulate
+    Save a snapshot and simulate the current tick, with the other player's
+    input if it has arrived, or their last known input if not.
+ ----------------------------------------------------------------------------*/
+void NetplaySimulate(struct netplay_session *session, struct game_state *gameState)
+{
+    int remotePlayer = 1 - session->localPlayer;
+    uint32_t tick = session->tick;
+    uint8_t remoteButtons = 0;
+
+    GameSnapshotSave(&session->snapshots[tick % NETPLAY_ROLLBACK_MAX], gameState);
+    session->checksums[tick & NETPLAY_INPUT_MASK] = session->snapshots[tick % NETPLAY_ROLLBACK_MAX].checksum;
+
+    if (tick < session->remoteTicks)
+        remoteButtons = session->inputs[remotePlayer][tick & NETPLAY_INPUT_MASK];
+    else if (session->remoteTicks > 0)
+        remoteButtons = session->inputs[remotePlayer][(session->remoteTicks - 1) & NETPLAY_INPUT_MASK];
+    session->predicted[tick & NETPLAY_INPUT_MASK] = remoteButtons;
+
+    NetplayApplyButtons(gameState, session->localPlayer, session->inputs[session->localPlayer][tick & NETPLAY_INPUT_MASK]);
+    NetplayApplyButtons(gameState, remotePlayer, remoteButtons);
+    GameUpdate(session->deltaTimeMs, gameState, NULL);
+    session->tick++;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplaySend
+    Send every local input the other player has not acknowledged yet, up to
+    a packet's worth, with the checksum of the latest tick this end knows
+    every input before. Inputs are sent again until they are acknowledged,
+    so a lost packet only delays them.
+ ----------------------------------------------------------------------------*/
+void NetplaySend(struct netplay_session *session)
+{
+    uint8_t packet[NETPLAY_PACKET_SIZE];
+    uint32_t firstTick = session->remoteAcked;
+    uint32_t checkTick;
+    int count, delayed = 0;
+
+    /* Send the packets held back that are due. */
+    for (int index = 0; index < session->delayedCount; index++) {
+        if ((int32_t)(session->frame - session->delayed[index].sendFrame) >= 0)
+            NetplaySendRaw(session, session->delayed[index].data, session->delayed[index].size);
+        else
+            session->delayed[delayed++] = session->delayed[index];
+    }
+    session->delayedCount = delayed;
+
+    if (session->tick - firstTick > NETPLAY_PACKET_INPUTS)
+        firstTick = session->tick - NETPLAY_PACKET_INPUTS;
+    count = session->tick - firstTick;
+    checkTick = (session->remoteTicks < session->tick) ? session->remoteTicks : session->tick - 1;
+    if (session->tick == 0)
+        checkTick = NETPLAY_TICK_NONE;
+
+    NetplayPut32(packet, NETPLAY_MAGIC);
+    NetplayPut32(packet + 4, firstTick);
+    NetplayPut32(packet + 8, session->remoteTicks);
+    NetplayPut32(packet + 12, checkTick);
+    NetplayPut32(packet + 16, session->checksums[checkTick & NETPLAY_INPUT_MASK]);
+    packet[20] = (uint8_t)count;
+    for (int input = 0; input < count; input++)
+        packet[21 + input] = session->inputs[session->localPlayer][(firstTick + input) & NETPLAY_INPUT_MASK];
+
+    if (session->lossPercent > 0 && (int)(NetplayRandom(session) % 100) < session->lossPercent)
+        return;
+    if (session->latencyTicks > 0 && session->delayedCount < NETPLAY_DELAYED_MAX) {
+        session->delayed[session->delayedCount].sendFrame = session->frame + session->latencyTicks;
+        session->delayed[session->delayedCount].size = 21 + count;
+        memcpy(session->delayed[session->delayedCount].data, packet, 21 + count);
+        session->delayedCount++;
+        return;
+    }
+    NetplaySendRaw(session, packet, 21 + count);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayReceive
+    Read every packet waiting on the socket.
+ ----------------------------------------------------------------------------*/
+void NetplayReceive(struct netplay_session *session)
+{
+    uint8_t packet[NETPLAY_PACKET_SIZE];
+    int size;
+
+    for (;;) {
+        size = (int)recv(session->socket, (char *)packet, sizeof(packet), 0);
+        if (size <= 0)
+            break;
+        NetplayReadPacket(session, packet, size);
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayReadPacket
+    Take the other player's inputs that follow on from the ones already
+    received, and note the earliest tick whose prediction they prove wrong.
+    Inputs out of order are dropped; they will be sent again.
+ ----------------------------------------------------------------------------*/
+void NetplayReadPacket(struct netplay_session *session, const uint8_t *packet, int size)
+{
+    int remotePlayer = 1 - session->localPlayer;
+    uint32_t firstTick, ackTick, tick;
+    uint8_t buttons;
+    int count;
+
+    if (size < 21 || NetplayGet32(packet) != NETPLAY_MAGIC)
+        return;
+    firstTick = NetplayGet32(packet + 4);
+    ackTick = NetplayGet32(packet + 8);
+    count = packet[20];
+    if (size < 21 + count)
+        return;
+
+    if ((int32_t)(ackTick - session->remoteAcked) > 0)
+        session->remoteAcked = ackTick;
+
+    for (int input = 0; input < count; input++) {
+        tick = firstTick + input;
+        if (tick != session->remoteTicks)
+            continue;
+        buttons = packet[21 + input];
+        session->inputs[remotePlayer][tick & NETPLAY_INPUT_MASK] = buttons;
+        if (tick < session->tick && buttons != session->predicted[tick & NETPLAY_INPUT_MASK] && tick < session->rollbackTick)
+            session->rollbackTick = tick;
+        session->remoteTicks++;
+    }
+
+    session->checkPending = true;
+    session->checkTick = NetplayGet32(packet + 12);
+    session->checkChecksum = NetplayGet32(packet + 16);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayCheck
+    Compare the other end's checksum for a tick with this end's, once this
+    end knows every input before that tick too. Any difference means the
+    two games have drifted apart.
+ ----------------------------------------------------------------------------*/
+void NetplayCheck(struct netplay_session *session)
+{
+    uint32_t tick = session->checkTick;
+
+    if (!session->checkPending || tick == NETPLAY_TICK_NONE || tick > session->remoteTicks || tick >= session->tick
+        || session->tick - tick > NETPLAY_INPUT_RING)
+        return;
+
+    session->checkPending = false;
+    session->checks++;
+    if (session->checksums[tick & NETPLAY_INPUT_MASK] != session->checkChecksum)
+        session->desyncs++;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplaySendRaw
+    Send a packet to the other player. A packet the socket cannot take is
+    treated as lost.
+ ----------------------------------------------------------------------------*/
+void NetplaySendRaw(struct netplay_session *session, const uint8_t *packet, int size)
+{
+    sendto(session->socket, (const char *)packet, size, 0, (struct sockaddr *)&session->peer, sizeof(session->peer));
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayApplyButtons
+    Hold a player's keys down or let them go, as the buttons say.
+ ----------------------------------------------------------------------------*/
+void NetplayApplyButtons(struct game_state *gameState, int player, uint8_t buttons)
+{
+    if (player == 0) {
+        GameApplyKey(gameState, GAME_KEY_LEFT, (buttons & NETPLAY_BUTTON_LEFT) != 0);
+        GameApplyKey(gameState, GAME_KEY_RIGHT, (buttons & NETPLAY_BUTTON_RIGHT) != 0);
+    }
+    else {
+        GameApplyKey(gameState, GAME_KEY_OPPONENT_LEFT, (buttons & NETPLAY_BUTTON_LEFT) != 0);
+        GameApplyKey(gameState, GAME_KEY_OPPONENT_RIGHT, (buttons & NETPLAY_BUTTON_RIGHT) != 0);
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    GameSnapshotSave
+    Save everything needed to put a game state back as it is: a clone of
+    the state, which has no particles, sound or telemetry, and its bricks'
+    hit points, which are the only part of the bricks that changes during
+    a game. The clone lets go of the bricks straight away, as the game
+    goes on changing them.
+ ----------------------------------------------------------------------------*/
+void GameSnapshotSave(struct game_snapshot *snapshot, const struct game_state *gameState)
+{
+    int brickCount = gameState->bricks.base->rows * gameState->bricks.base->columns;
+
+    GameClone(&snapshot->state, gameState, NULL);
+    GameCloneRelease(&snapshot->state);
+    for (int brickIndex = 0; brickIndex < brickCount; brickIndex++)
+        snapshot->hitPoints[brickIndex] = (int16_t)BrickHitPoints(&gameState->bricks, brickIndex);
+    snapshot->checksum = GameChecksum(gameState);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    GameSnapshotLoad
+    Put a game state back as it was when a snapshot was saved of it. The
+    game state keeps its bricks, and their hit points are set back. Like
+    the snapshot, it is left without particles, sound or telemetry; the
+    caller puts them back when it wants effects again.
+ ----------------------------------------------------------------------------*/
+void GameSnapshotLoad(struct game_state *gameState, const struct game_snapshot *snapshot)
+{
+    struct brick_set *brickSet = &gameState->bricks;
+    struct brick_set bricks = *brickSet;
+    int brickCount = bricks.base->rows * bricks.base->columns;
+
+    *gameState = snapshot->state;
+    *brickSet = bricks;
+    for (int brickIndex = 0; brickIndex < brickCount; brickIndex++)
+        BrickSetHitPoints(brickSet, brickIndex, snapshot->hitPoints[brickIndex]);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    GameChecksum
+    Returns a hash of everything in a game state that decides how the game
+    goes on, to tell whether two ends of a versus game agree.
+ ----------------------------------------------------------------------------*/
+uint32_t GameChecksum(const struct game_state *gameState)
+{
+    int32_t values[] = {
+        gameState->paused, gameState->pausedUser,
+        gameState->lives, gameState->score, gameState->opponentLives, gameState->opponentScore,
+        gameState->ballOwner
+    };
+    float positions[] = {
+        gameState->countdown,
+        gameState->ball.rect.position.x, gameState->ball.rect.position.y,
+        gameState->ball.velocity.x, gameState->ball.velocity.y,
+        gameState->paddle.rect.position.x, gameState->opponent.rect.position.x
+    };
+    int brickCount = gameState->bricks.base->rows * gameState->bricks.base->columns;
+    uint32_t hash = 2166136261u;
+    uint32_t bits;
+
+    for (int value = 0; value < 7; value++)
+        hash = (hash ^ (uint32_t)values[value]) * 16777619u;
+    for (int position = 0; position < 7; position++) {
+        memcpy(&bits, &positions[position], sizeof(bits));
+        hash = (hash ^ bits) * 16777619u;
+    }
+    for (int brickIndex = 0; brickIndex < brickCount; brickIndex++)
+        hash = (hash ^ (uint32_t)BrickHitPoints(&gameState->bricks, brickIndex)) * 16777619u;
+
+    return hash;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayPut32
+    Write a 32 bit value into a packet, least significant byte first.
+ ----------------------------------------------------------------------------*/
+void NetplayPut32(uint8_t *bytes, uint32_t value)
+{
+    for (int byte = 0; byte < 4; byte++)
+        bytes[byte] = (uint8_t)(value >> (byte * 8));
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayGet32
+    Read a 32 bit value from a packet, least significant byte first.
+ ----------------------------------------------------------------------------*/
+uint32_t NetplayGet32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/*-----------------------------------------------------------------------------
+    NetplayRandom
+    Returns the next number from the session's xorshift generator, which
+    decides which packets are lost.
+ ----------------------------------------------------------------------------*/
+uint32_t NetplayRandom(struct netplay_session *session)
+{
+    uint32_t random = session->random;
+
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    session->random = random;
+
+    return random;
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+/*=============================================================================
+    netplay.h
+ =============================================================================*/
+
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    typedef SOCKET netplay_socket;
+    #define NETPLAY_SOCKET_INVALID INVALID_SOCKET
+#else
+    #include <netinet/in.h>
+    typedef int netplay_socket;
+    #define NETPLAY_SOCKET_INVALID (-1)
+#endif
+
+#define NETPLAY_PLAYERS 2
+#define NETPLAY_BUTTON_LEFT 0x01
+#define NETPLAY_BUTTON_RIGHT 0x02
+
+/* How far the game may run ahead of the last input it has from the other
+   player. Every tick in that window keeps a snapshot to roll back to. */
+#define NETPLAY_ROLLBACK_MAX 16
+
+/* Must be a power of two so ticks can be masked. */
+#define NETPLAY_INPUT_RING 64
+#define NETPLAY_INPUT_MASK (NETPLAY_INPUT_RING - 1)
+
+#define NETPLAY_PACKET_INPUTS 32
+#define NETPLAY_PACKET_SIZE (4 * 5 + 1 + NETPLAY_PACKET_INPUTS)
+#define NETPLAY_MAGIC 0x424C4B31
+#define NETPLAY_DELAYED_MAX 256
+#define NETPLAY_TICK_NONE 0xFFFFFFFF
+
+/* A game state, cloned without effects or bricks, and the hit points of
+   its bricks. */
+struct game_snapshot {
+    struct game_state state;
+    uint32_t checksum;
+    int16_t hitPoints[BRICK_CAPACITY_MAX];
+};
+
+/* A packet held back to fake network latency, until the sender's frame
+   count reaches sendFrame. */
+struct netplay_delayed {
+    uint32_t sendFrame;
+    int size;
+    uint8_t data[NETPLAY_PACKET_SIZE];
+};
+
+/* One player's end of a versus game. Both ends step the same game; each
+   sends its own input for every tick and, until the other player's input
+   for a tick arrives, predicts it will be the same as the last input that
+   did. When an input arrives that differs from the prediction, the game is
+   rolled back to the tick it was for and simulated forward again. */
+struct netplay_session {
+    int localPlayer;
+    float deltaTimeMs;
+    uint32_t frame;
+    uint32_t tick;
+    uint32_t remoteTicks;
+    uint32_t remoteAcked;
+    uint32_t rollbackTick;
+    uint8_t inputs[NETPLAY_PLAYERS][NETPLAY_INPUT_RING];
+    uint8_t predicted[NETPLAY_INPUT_RING];
+    uint32_t checksums[NETPLAY_INPUT_RING];
+    bool checkPending;
+    uint32_t checkTick;
+    uint32_t checkChecksum;
+    struct game_snapshot snapshots[NETPLAY_ROLLBACK_MAX];
+    netplay_socket socket;
+    struct sockaddr_in peer;
+    int latencyTicks;
+    int lossPercent;
+    uint32_t random;
+    int delayedCount;
+    struct netplay_delayed delayed[NETPLAY_DELAYED_MAX];
+    int rollbacks;
+    int ticksResimulated;
+    int resimulatedMax;
+    int stalls;
+    int checks;
+    int desyncs;
+};
+
+bool NetplayOpen(struct netplay_session *, int, float, int, const char *, int);
+void NetplayClose(struct netplay_session *);
+void NetplaySetConditions(struct netplay_session *, int, int, uint32_t);
+bool NetplayAdvance(struct netplay_session *, struct game_state *, uint8_t);
+void NetplayPoll(struct netplay_session *);
+void NetplaySimulate(struct netplay_session *, struct game_state *);
+void NetplaySend(struct netplay_session *);
+void NetplayReceive(struct netplay_session *);
+void NetplayReadPacket(struct netplay_session *, const uint8_t *, int);
+void NetplayCheck(struct netplay_session *);
+void NetplaySendRaw(struct netplay_session *, const uint8_t *, int);
+void NetplayApplyButtons(struct game_state *, int, uint8_t);
+void GameSnapshotSave(struct game_snapshot *, const struct game_state *);
+void GameSnapshotLoad(struct game_state *, const struct game_snapshot *);
+uint32_t GameChecksum(const struct game_state *);
+void NetplayPut32(uint8_t *, uint32_t);
+uint32_t NetplayGet32(const uint8_t *);
+uint32_t NetplayRandom(struct netplay_session *);
+
+#endif /* NETPLAY_H */
\ No newline at end of file
@@ -0,0 +1,122 @@
+/*=============================================================================
+    pacer.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "pacer.h"
+
+/*-----------------------------------------------------------------------------
+    PacerInit
+    Initialize the pacer for a display refreshing every period. Until a
+    frame has been presented, the last refresh is taken to be now.
+ ----------------------------------------------------------------------------*/
+void PacerInit(struct frame_pacer *pacer, uint64_t periodUs, uint64_t nowUs)
+{
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->periodUs = periodUs;
+    pacer->refreshUs = nowUs;
+    pacer->marginUs = PACER_MARGIN_MIN_US;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    PacerWakeUs
+    Returns when to start the next frame: the cost estimate and margin
+    before the first refresh it can still make, or now if that has passed.
+    Also sets that refresh as the frame's deadline.
+ ----------------------------------------------------------------------------*/
+uint64_t PacerWakeUs(struct frame_pacer *pacer, uint64_t nowUs)
+{
+    uint64_t budgetUs = PacerCostUs(pacer) + pacer->marginUs;
+    uint64_t deadlineUs = pacer->refreshUs + pacer->periodUs;
+
+    /* After an idle stretch the last refresh is long past; refreshes are
+       assumed to have kept to the period since. */
+    if (nowUs + budgetUs > deadlineUs)
+        deadlineUs += ((nowUs + budgetUs - deadlineUs) / pacer->periodUs + 1) * pacer->periodUs;
+    pacer->deadlineUs = deadlineUs;
+    pacer->wakeUs = (deadlineUs - budgetUs > nowUs) ? deadlineUs - budgetUs : nowUs;
+
+    return pacer->wakeUs;
+}
+
+/*-----------------------------------------------------------------------------
+    PacerFrameStart
+    Mark the start of a frame, just before input is sampled. A frame
+    started before its wake time is costed from its start instead.
+ ----------------------------------------------------------------------------*/
+void PacerFrameStart(struct frame_pacer *pacer, uint64_t nowUs)
+{
+    pacer->frameStartUs = nowUs;
+    if (nowUs < pacer->wakeUs)
+        pacer->wakeUs = nowUs;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    PacerFramePresented
+    Record a frame's cost, from when it was meant to start until present
+    was called, and the refresh it was shown at, when present returned. A
+    frame shown a refresh or more after its deadline widens the margin.
+    Returns true if the frame missed its deadline.
+ ----------------------------------------------------------------------------*/
+bool PacerFramePresented(struct frame_pacer *pacer, uint64_t presentUs, uint64_t refreshUs)
+{
+    uint64_t costUs = presentUs - pacer->wakeUs;
+    uint32_t *sample = &pacer->costUs[pacer->samples & PACER_SAMPLES_MASK];
+    int bucket;
+    bool missed;
+
+    /* The oldest sample makes way for the new one. */
+    if (pacer->samples >= PACER_SAMPLES)
+        pacer->buckets[*sample]--;
+    bucket = (int)(costUs / PACER_BUCKET_US);
+    if (bucket >= PACER_BUCKETS)
+        bucket = PACER_BUCKETS - 1;
+    *sample = (uint32_t)bucket;
+    pacer->buckets[bucket]++;
+    pacer->samples++;
+
+    missed = refreshUs > pacer->deadlineUs + pacer->periodUs / 2;
+    if (missed) {
+        pacer->framesMissed++;
+        pacer->marginUs *= 2;
+        if (pacer->marginUs > PACER_MARGIN_MAX_US)
+            pacer->marginUs = PACER_MARGIN_MAX_US;
+    }
+    else
+        pacer->marginUs -= (pacer->marginUs - PACER_MARGIN_MIN_US) / PACER_MARGIN_DECAY;
+    pacer->refreshUs = refreshUs;
+    pacer->frames++;
+
+    return missed;
+}
+
+/*-----------------------------------------------------------------------------
+    PacerCostUs
+    Returns the cost of a frame that recent frames stayed within 95% of
+    the time, to the top of its bucket. Without any frames yet it is a
+    whole period, so the first frames start straight away.
+ ----------------------------------------------------------------------------*/
+uint64_t PacerCostUs(const struct frame_pacer *pacer)
+{
+    uint32_t count = (pacer->samples < PACER_SAMPLES) ? pacer->samples : PACER_SAMPLES;
+    uint32_t rank = (uint32_t)(count * PACER_PERCENTILE);
+    uint32_t seen = 0;
+
+    if (count == 0)
+        return pacer->periodUs;
+
+    for (int bucket = 0; bucket < PACER_BUCKETS; bucket++) {
+        seen += pacer->buckets[bucket];
+        if (seen > rank)
+            return (uint64_t)(bucket + 1) * PACER_BUCKET_US;
+    }
+
+    return (uint64_t)PACER_BUCKETS * PACER_BUCKET_US;
+}
\ No newline at end of file
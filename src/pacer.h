@@ -0,0 +1,52 @@
+/*=============================================================================
+    pacer.h
+ =============================================================================*/
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Must be a power of two so the sample ring can be masked. */
+#define PACER_SAMPLES 128
+#define PACER_SAMPLES_MASK (PACER_SAMPLES - 1)
+#define PACER_BUCKET_US 100
+#define PACER_BUCKETS 256
+#define PACER_PERCENTILE 0.95f
+/* Frames start this much earlier than the cost estimate asks for, more
+   after a missed refresh, drifting back once frames are on time again. */
+#define PACER_MARGIN_MIN_US 1000
+#define PACER_MARGIN_MAX_US 6000
+#define PACER_MARGIN_DECAY 64
+/* Sleeps overshoot, so the last stretch of a wait is spun. */
+#define PACER_SPIN_US 2000
+
+/* Starts each frame as late as it can and still be presented at the next
+   refresh: the cost of a frame, from when it was meant to start to when
+   it was handed to present, is estimated from the 95th percentile of
+   recent frames, so waking late counts as cost too. The refreshes are
+   found from when presents return. The platform waits,
+   samples input, updates, renders and presents in that order. Not thread
+   safe; all calls are made from the thread that runs the game loop. */
+struct frame_pacer {
+    uint64_t periodUs;
+    uint64_t refreshUs;
+    uint64_t deadlineUs;
+    uint64_t wakeUs;
+    uint64_t frameStartUs;
+    uint64_t marginUs;
+    uint32_t costUs[PACER_SAMPLES];
+    uint32_t buckets[PACER_BUCKETS];
+    uint32_t samples;
+    uint32_t frames;
+    uint32_t framesMissed;
+};
+
+void PacerInit(struct frame_pacer *, uint64_t, uint64_t);
+uint64_t PacerWakeUs(struct frame_pacer *, uint64_t);
+void PacerFrameStart(struct frame_pacer *, uint64_t);
+bool PacerFramePresented(struct frame_pacer *, uint64_t, uint64_t);
+uint64_t PacerCostUs(const struct frame_pacer *);
+
+#endif /* PACER_H */
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*=============================================================================
+    palette.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__SSSE3__) || defined(_M_X64)
+    #include <tmmintrin.h>
+    #define PALETTE_SSSE3
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define PALETTE_NEON
+#endif
+
+#include "game.h"
+#include "palette.h"
+
+/* 0xRRGGBB for every palette colour. */
+static const uint32_t palette_rgb[NUM_PALETTE_COLORS] = {
+    0x000000, /* COLOR_BLACK */
+    0xFFFFFF, /* COLOR_WHITE */
+    0xFF0000, /* COLOR_RED */
+    0xFFA500, /* COLOR_ORANGE */
+    0xFFFF00, /* COLOR_YELLOW */
+    0x00FF00, /* COLOR_GREEN */
+    0x0000FF, /* COLOR_BLUE */
+    0x4B0082, /* COLOR_INDIGO */
+    0x8D38C9  /* COLOR_VIOLET */
+};
+
+/*-----------------------------------------------------------------------------
+    PaletteInit
+    Build the palette in a platform's pixel format. Unused entries are
+    black. Each byte of the pixels is also kept as its own table, which is
+    what the vector lookup needs.
+ ----------------------------------------------------------------------------*/
+void PaletteInit(struct palette *palette, enum pixel_format format)
+{
+    uint32_t rgb, red, green, blue;
+
+    for (int color = 0; color < PALETTE_SIZE; color++) {
+        rgb = (color < NUM_PALETTE_COLORS) ? palette_rgb[color] : 0;
+        red = (rgb >> 16) & 0xFF;
+        green = (rgb >> 8) & 0xFF;
+        blue = rgb & 0xFF;
+        if (format == PIXEL_FORMAT_RGBA)
+            palette->colors[color] = 0xFF000000 | (blue << 16) | (green << 8) | red;
+        else
+            palette->colors[color] = (red << 16) | (green << 8) | blue;
+        for (int plane = 0; plane < 4; plane++)
+            palette->planes[plane][color] = (uint8_t)(palette->colors[color] >> (plane * 8));
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    PaletteExpand
+    Convert a frame of colour indices into 32 bit pixels. With SSSE3 or
+    NEON, 16 pixels are looked up at a time, one byte table per pixel byte,
+    and the bytes are interleaved back into pixels.
+ ----------------------------------------------------------------------------*/
+void PaletteExpand(const struct palette *palette, const struct bitmap_buffer *indexBuffer, struct bitmap_buffer *pixelBuffer)
+{
+    const uint8_t *indexRow = indexBuffer->memory;
+    uint8_t *pixelRow = pixelBuffer->memory;
+    const uint8_t *index;
+    uint32_t *pixel;
+    int x;
+
+#if defined(PALETTE_SSSE3)
+    __m128i plane0 = _mm_loadu_si128((const __m128i *)palette->planes[0]);
+    __m128i plane1 = _mm_loadu_si128((const __m128i *)palette->planes[1]);
+    __m128i plane2 = _mm_loadu_si128((const __m128i *)palette->planes[2]);
+    __m128i plane3 = _mm_loadu_si128((const __m128i *)palette->planes[3]);
+    __m128i indexMask = _mm_set1_epi8(PALETTE_SIZE - 1);
+    __m128i indices, byte0, byte1, byte2, byte3, low01, high01, low23, high23;
+#elif defined(PALETTE_NEON)
+    uint8x16x4_t planes;
+    uint8x16_t indices, indexMask = vdupq_n_u8(PALETTE_SIZE - 1);
+    planes.val[0] = vld1q_u8(palette->planes[0]);
+    planes.val[1] = vld1q_u8(palette->planes[1]);
+    planes.val[2] = vld1q_u8(palette->planes[2]);
+    planes.val[3] = vld1q_u8(palette->planes[3]);
+    uint8x16x4_t bytes;
+#endif
+
+    for (int y = 0; y < indexBuffer->height; y++) {
+        index = indexRow;
+        pixel = (uint32_t *)pixelRow;
+        x = 0;
+
+#if defined(PALETTE_SSSE3)
+        for (; x + 16 <= indexBuffer->width; x += 16) {
+            indices = _mm_and_si128(_mm_loadu_si128((const __m128i *)(index + x)), indexMask);
+            byte0 = _mm_shuffle_epi8(plane0, indices);
+            byte1 = _mm_shuffle_epi8(plane1, indices);
+            byte2 = _mm_shuffle_epi8(plane2, indices);
+            byte3 = _mm_shuffle_epi8(plane3, indices);
+            low01 = _mm_unpacklo_epi8(byte0, byte1);
+            high01 = _mm_unpackhi_epi8(byte0, byte1);
+            low23 = _mm_unpacklo_epi8(byte2, byte3);
+            high23 = _mm_unpackhi_epi8(byte2, byte3);
+            _mm_storeu_si128((__m128i *)(pixel + x), _mm_unpacklo_epi16(low01, low23));
+            _mm_storeu_si128((__m128i *)(pixel + x + 4), _mm_unpackhi_epi16(low01, low23));
+            _mm_storeu_si128((__m128i *)(pixel + x + 8), _mm_unpacklo_epi16(high01, high23));
+            _mm_storeu_si128((__m128i *)(pixel + x + 12), _mm_unpackhi_epi16(high01, high23));
+        }
+#elif defined(PALETTE_NEON)
+        for (; x + 16 <= indexBuffer->width; x += 16) {
+            indices = vandq_u8(vld1q_u8(index + x), indexMask);
+            bytes.val[0] = vqtbl1q_u8(planes.val[0], indices);
+            bytes.val[1] = vqtbl1q_u8(planes.val[1], indices);
+            bytes.val[2] = vqtbl1q_u8(planes.val[2], indices);
+            bytes.val[3] = vqtbl1q_u8(planes.val[3], indices);
+            vst4q_u8((uint8_t *)(pixel + x), bytes);
+        }
+#endif
+
+        for (; x < indexBuffer->width; x++)
+            pixel[x] = palette->colors[index[x] & (PALETTE_SIZE - 1)];
+
+        indexRow += indexBuffer->pitch;
+        pixelRow += pixelBuffer->pitch;
+    }
+
+    return;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+/*=============================================================================
+    palette.h
+ =============================================================================*/
+
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+
+/* The game draws colour indices into an 8 bit frame; the platform expands
+   them to its own pixel format when the frame is presented. At most 16
+   colours, so a lookup fits in one vector register. */
+#define PALETTE_SIZE 16
+
+enum palette_colors {
+    COLOR_BLACK,
+    COLOR_WHITE,
+    COLOR_RED,
+    COLOR_ORANGE,
+    COLOR_YELLOW,
+    COLOR_GREEN,
+    COLOR_BLUE,
+    COLOR_INDIGO,
+    COLOR_VIOLET,
+    NUM_PALETTE_COLORS
+};
+
+/* Byte order of a 32 bit pixel in memory. */
+enum pixel_format {
+    PIXEL_FORMAT_BGRX,
+    PIXEL_FORMAT_RGBA
+};
+
+struct palette {
+    uint32_t colors[PALETTE_SIZE];
+    uint8_t planes[4][PALETTE_SIZE];
+};
+
+struct bitmap_buffer;
+
+void PaletteInit(struct palette *, enum pixel_format);
+void PaletteExpand(const struct palette *, const struct bitmap_buffer *, struct bitmap_buffer *);
+
+#endif /* PALETTE_H */
\ No newline at end of file
@@ -0,0 +1,245 @@
+/*=============================================================================
+    particles.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define PARTICLES_SSE2
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define PARTICLES_NEON
+#endif
+
+#include "game.h"
+#include "render.h"
+#include "particles.h"
+
+/*-----------------------------------------------------------------------------
+    ParticleSystemInit
+    Start a particle system with no live particles. The seed drives the
+    scatter of emitted particles.
+ ----------------------------------------------------------------------------*/
+void ParticleSystemInit(struct particle_system *particles, uint32_t seed)
+{
+    particles->count = 0;
+    particles->random = seed ? seed : 1;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    ParticlesEmitBrick
+    Shatter a brick into one particle per pixel, each flying away from the
+    middle of the brick and carried along a little by the ball. Particles
+    beyond the capacity are dropped.
+ ----------------------------------------------------------------------------*/
+void ParticlesEmitBrick(struct particle_system *particles, struct rectangle rect, uint8_t color, struct vector_2d ballVelocity)
+{
+    float centerX = rect.position.x + rect.width * 0.5f;
+    float centerY = rect.position.y + rect.height * 0.5f;
+    int particle;
+
+    for (int y = 0; y < rect.height; y++) {
+        for (int x = 0; x < rect.width; x++) {
+            if (particles->count == PARTICLES_MAX)
+                return;
+            particle = particles->count++;
+            particles->x[particle] = rect.position.x + x + 0.5f;
+            particles->y[particle] = rect.position.y + y + 0.5f;
+            particles->velocityX[particle] = (particles->x[particle] - centerX) * 2.0f + ballVelocity.x * 0.25f
+                + (ParticleRandom(particles) - 0.5f) * PARTICLE_SPEED_MAX;
+            particles->velocityY[particle] = (particles->y[particle] - centerY) * 2.0f + ballVelocity.y * 0.25f
+                + (ParticleRandom(particles) - 0.5f) * PARTICLE_SPEED_MAX;
+            particles->life[particle] = PARTICLE_LIFE_MIN + ParticleRandom(particles) * PARTICLE_LIFE_RANGE;
+            particles->color[particle] = color;
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    ParticlesUpdate
+    Move every particle under gravity for the time elapsed, then remove the
+    ones that expired or fell off the bottom.
+ ----------------------------------------------------------------------------*/
+void ParticlesUpdate(struct particle_system *particles, float secondElapsed)
+{
+    float gravity = PARTICLE_GRAVITY * secondElapsed;
+    int count = particles->count;
+    int particle = 0;
+
+#if defined(PARTICLES_SSE2)
+    __m128 seconds = _mm_set1_ps(secondElapsed);
+    __m128 fall = _mm_set1_ps(gravity);
+    __m128 velocityY;
+
+    for (; particle + 4 <= count; particle += 4) {
+        velocityY = _mm_sub_ps(_mm_loadu_ps(&particles->velocityY[particle]), fall);
+        _mm_storeu_ps(&particles->velocityY[particle], velocityY);
+        _mm_storeu_ps(&particles->x[particle], _mm_add_ps(_mm_loadu_ps(&particles->x[particle]),
+            _mm_mul_ps(_mm_loadu_ps(&particles->velocityX[particle]), seconds)));
+        _mm_storeu_ps(&particles->y[particle], _mm_add_ps(_mm_loadu_ps(&particles->y[particle]),
+            _mm_mul_ps(velocityY, seconds)));
+        _mm_storeu_ps(&particles->life[particle], _mm_sub_ps(_mm_loadu_ps(&particles->life[particle]), seconds));
+    }
+#elif defined(PARTICLES_NEON)
+    float32x4_t fall = vdupq_n_f32(gravity);
+    float32x4_t velocityY;
+
+    for (; particle + 4 <= count; particle += 4) {
+        velocityY = vsubq_f32(vld1q_f32(&particles->velocityY[particle]), fall);
+        vst1q_f32(&particles->velocityY[particle], velocityY);
+        vst1q_f32(&particles->x[particle], vaddq_f32(vld1q_f32(&particles->x[particle]),
+            vmulq_n_f32(vld1q_f32(&particles->velocityX[particle]), secondElapsed)));
+        vst1q_f32(&particles->y[particle], vaddq_f32(vld1q_f32(&particles->y[particle]),
+            vmulq_n_f32(velocityY, secondElapsed)));
+        vst1q_f32(&particles->life[particle], vsubq_f32(vld1q_f32(&particles->life[particle]), vdupq_n_f32(secondElapsed)));
+    }
+#endif
+
+    for (; particle < count; particle++) {
+        particles->velocityY[particle] -= gravity;
+        particles->x[particle] += particles->velocityX[particle] * secondElapsed;
+        particles->y[particle] += particles->velocityY[particle] * secondElapsed;
+        particles->life[particle] -= secondElapsed;
+    }
+
+    ParticlesExpire(particles);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    ParticlesExpire
+    Remove the particles that ran out of life or fell below the bottom of
+    the screen, moving the last particle into each gap. Runs of four live
+    particles are skipped with a single test.
+ ----------------------------------------------------------------------------*/
+void ParticlesExpire(struct particle_system *particles)
+{
+    int particle = 0;
+    int last;
+
+#if defined(PARTICLES_SSE2)
+    __m128 zero = _mm_setzero_ps();
+#elif defined(PARTICLES_NEON)
+    float32x4_t zero = vdupq_n_f32(0.0f);
+#endif
+
+    while (particle < particles->count) {
+#if defined(PARTICLES_SSE2)
+        if (particle + 4 <= particles->count
+            && _mm_movemask_ps(_mm_or_ps(
+                _mm_cmple_ps(_mm_loadu_ps(&particles->life[particle]), zero),
+                _mm_cmplt_ps(_mm_loadu_ps(&particles->y[particle]), zero))) == 0) {
+            particle += 4;
+            continue;
+        }
+#elif defined(PARTICLES_NEON)
+        if (particle + 4 <= particles->count
+            && vmaxvq_u32(vorrq_u32(
+                vcleq_f32(vld1q_f32(&particles->life[particle]), zero),
+                vcltq_f32(vld1q_f32(&particles->y[particle]), zero))) == 0) {
+            particle += 4;
+            continue;
+        }
+#endif
+        if (particles->life[particle] > 0.0f && particles->y[particle] >= 0.0f) {
+            particle++;
+            continue;
+        }
+        last = --particles->count;
+        particles->x[particle] = particles->x[last];
+        particles->y[particle] = particles->y[last];
+        particles->velocityX[particle] = particles->velocityX[last];
+        particles->velocityY[particle] = particles->velocityY[last];
+        particles->life[particle] = particles->life[last];
+        particles->color[particle] = particles->color[last];
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    ParticlesSplat
+    Draw every particle as the output pixels covering its game pixel, in a
+    range of rows of a buffer of palette colours, or of 32 bit pixels
+    through a palette if one is given. The edges of every game pixel column
+    and row are looked up once per call, so each particle only costs a few
+    loads and stores.
+ ----------------------------------------------------------------------------*/
+void ParticlesSplat(const struct particle_system *particles, const struct palette *palette, struct bitmap_buffer *bitmapBuffer, int sourceWidth, int sourceHeight, int rowFirst, int rowEnd)
+{
+    int columnEdges[PARTICLE_SPLAT_SOURCE_MAX + 1];
+    int rowEdges[PARTICLE_SPLAT_SOURCE_MAX + 1];
+    uint8_t *row;
+    uint32_t pixel;
+    int column, sourceRow, x0, x1, y0, y1;
+
+    if (sourceWidth > PARTICLE_SPLAT_SOURCE_MAX)
+        sourceWidth = PARTICLE_SPLAT_SOURCE_MAX;
+    if (sourceHeight > PARTICLE_SPLAT_SOURCE_MAX)
+        sourceHeight = PARTICLE_SPLAT_SOURCE_MAX;
+    for (int edge = 0; edge <= sourceWidth; edge++)
+        columnEdges[edge] = RenderScale(edge, bitmapBuffer->width, sourceWidth);
+    for (int edge = 0; edge <= sourceHeight; edge++)
+        rowEdges[edge] = RenderScale(edge, bitmapBuffer->height, sourceHeight);
+
+    for (int particle = 0; particle < particles->count; particle++) {
+        if (particles->x[particle] < 0.0f || particles->y[particle] < 0.0f)
+            continue;
+        column = (int)particles->x[particle];
+        sourceRow = (int)particles->y[particle];
+        if (column >= sourceWidth || sourceRow >= sourceHeight)
+            continue;
+
+        y0 = rowEdges[sourceRow];
+        y1 = rowEdges[sourceRow + 1];
+        if (y0 < rowFirst)
+            y0 = rowFirst;
+        if (y1 > rowEnd)
+            y1 = rowEnd;
+        if (y1 <= y0)
+            continue;
+        x0 = columnEdges[column];
+        x1 = columnEdges[column + 1];
+
+        row = (uint8_t *)bitmapBuffer->memory + bitmapBuffer->pitch * y0;
+        if (palette) {
+            pixel = palette->colors[particles->color[particle]];
+            for (int y = y0; y < y1; y++, row += bitmapBuffer->pitch)
+                for (int x = x0; x < x1; x++)
+                    ((uint32_t *)row)[x] = pixel;
+            continue;
+        }
+        if (x1 - x0 == 1 && y1 - y0 == 1) {
+            row[x0] = particles->color[particle];
+            continue;
+        }
+        for (int y = y0; y < y1; y++, row += bitmapBuffer->pitch)
+            memset(row + x0, particles->color[particle], x1 - x0);
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    ParticleRandom
+    Returns the next number in [0, 1) from the system's xorshift generator.
+ ----------------------------------------------------------------------------*/
+float ParticleRandom(struct particle_system *particles)
+{
+    uint32_t random = particles->random;
+
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    particles->random = random;
+
+    return (float)(random >> 8) * (1.0f / 16777216.0f);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+/*=============================================================================
+    particles.h
+ =============================================================================*/
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#define PARTICLES_MAX 32768
+#define PARTICLE_LIFE_MIN 0.6f
+#define PARTICLE_LIFE_RANGE 0.9f
+#define PARTICLE_SPEED_MAX 60.0f
+#define PARTICLE_GRAVITY 120.0f
+#define PARTICLE_SPLAT_SOURCE_MAX 1024
+
+/* Live particles are packed at the front of each array, one array per
+   field, so the update runs down the arrays a vector at a time. A particle
+   that expires is replaced by the last one. */
+struct particle_system {
+    int count;
+    uint32_t random;
+    float x[PARTICLES_MAX];
+    float y[PARTICLES_MAX];
+    float velocityX[PARTICLES_MAX];
+    float velocityY[PARTICLES_MAX];
+    float life[PARTICLES_MAX];
+    uint8_t color[PARTICLES_MAX];
+};
+
+struct bitmap_buffer;
+struct palette;
+
+void ParticleSystemInit(struct particle_system *, uint32_t);
+void ParticlesEmitBrick(struct particle_system *, struct rectangle, uint8_t, struct vector_2d);
+void ParticlesUpdate(struct particle_system *, float);
+void ParticlesExpire(struct particle_system *);
+void ParticlesSplat(const struct particle_system *, const struct palette *, struct bitmap_buffer *, int, int, int, int);
+float ParticleRandom(struct particle_system *);
+
+#endif /* PARTICLES_H */
\ No newline at end of file
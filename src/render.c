@@ -0,0 +1,538 @@
+/*=============================================================================
+    render.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "game.h"
+#include "palette.h"
+#include "sprite.h"
+#include "render.h"
+#include "particles.h"
+
+/*-----------------------------------------------------------------------------
+    RenderListInit
+    Start an empty command list for a frame of the given size in game
+    pixels. The frame is cleared to a colour before anything is drawn.
+ ----------------------------------------------------------------------------*/
+void RenderListInit(struct render_list *renderList, int width, int height, uint8_t clearColor)
+{
+    renderList->width = width;
+    renderList->height = height;
+    renderList->clearColor = clearColor;
+    renderList->particles = NULL;
+    renderList->count = 0;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderPushRectangle
+    Add a solid rectangle to a command list. Commands beyond the capacity
+    of the list are dropped.
+ ----------------------------------------------------------------------------*/
+void RenderPushRectangle(struct render_list *renderList, int x, int y, int width, int height, uint8_t color)
+{
+    struct render_command *command;
+
+    if (renderList->count == RENDER_COMMANDS_MAX)
+        return;
+
+    command = &renderList->commands[renderList->count++];
+    command->type = RENDER_RECTANGLE;
+    command->color = color;
+    command->sprite = 0;
+    command->x = (int16_t)x;
+    command->y = (int16_t)y;
+    command->width = (int16_t)width;
+    command->height = (int16_t)height;
+    command->glyph = NULL;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderPushGlyph
+    Add a glyph, FONT_SIZE rows of one byte each, to a command list. The
+    glyph must stay valid until the frame is rendered.
+ ----------------------------------------------------------------------------*/
+void RenderPushGlyph(struct render_list *renderList, const char *glyph, int x, int y, uint8_t color)
+{
+    struct render_command *command;
+
+    if (renderList->count == RENDER_COMMANDS_MAX)
+        return;
+
+    command = &renderList->commands[renderList->count++];
+    command->type = RENDER_GLYPH;
+    command->color = color;
+    command->sprite = 0;
+    command->x = (int16_t)x;
+    command->y = (int16_t)y;
+    command->width = FONT_SIZE;
+    command->height = FONT_SIZE;
+    command->glyph = glyph;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderPushSprite
+    Add a sprite, stretched to a rectangle, to a command list. The colour
+    is used instead when the frame is drawn without sprites.
+ ----------------------------------------------------------------------------*/
+void RenderPushSprite(struct render_list *renderList, int sprite, int x, int y, int width, int height, uint8_t color)
+{
+    struct render_command *command;
+
+    if (renderList->count == RENDER_COMMANDS_MAX)
+        return;
+
+    command = &renderList->commands[renderList->count++];
+    command->type = RENDER_SPRITE;
+    command->color = color;
+    command->sprite = (uint8_t)sprite;
+    command->x = (int16_t)x;
+    command->y = (int16_t)y;
+    command->width = (int16_t)width;
+    command->height = (int16_t)height;
+    command->glyph = NULL;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderFrame
+    Rasterize a command list into a buffer of palette colours, scaled to
+    the size of the buffer, and expand it into pixels if a palette is
+    given. Particles are drawn over the commands. Sprites are blended into
+    the pixels if there is also an atlas, and drawn in their colour
+    otherwise; either way everything is layered in list order, with the
+    particles on top. Without a pool the whole frame is drawn on the calling
+    thread. With one, the commands are binned by the bands of rows they
+    touch and the bands are drawn in parallel; each band keeps the order
+    of the list, so the result is the same either way.
+ ----------------------------------------------------------------------------*/
+void RenderFrame(struct render_pool *pool, const struct render_list *renderList, struct bitmap_buffer *indexBuffer, const struct palette *palette, const struct sprite_atlas *atlas, struct bitmap_buffer *pixelBuffer)
+{
+    struct render_job *job;
+    const struct render_command *command;
+    int rowFirst, rowEnd, bandFirst, bandLast;
+
+    if (!palette)
+        atlas = NULL;
+
+    if (!pool) {
+        RenderRows(renderList, NULL, renderList->count, indexBuffer, 0, indexBuffer->height, atlas != NULL);
+        if (renderList->particles)
+            ParticlesSplat(renderList->particles, NULL, indexBuffer, renderList->width, renderList->height, 0, indexBuffer->height);
+        if (palette)
+            PaletteExpand(palette, indexBuffer, pixelBuffer);
+        if (atlas)
+            RenderSprites(renderList, NULL, renderList->count, atlas, palette, pixelBuffer, 0, pixelBuffer->height);
+        return;
+    }
+
+    /* No worker touches the job between frames. */
+    job = &pool->job;
+    job->list = renderList;
+    job->indexBuffer = indexBuffer;
+    job->palette = palette;
+    job->atlas = atlas;
+    job->pixelBuffer = pixelBuffer;
+    job->bandHeight = (indexBuffer->height + job->bandCount - 1) / job->bandCount;
+    for (int band = 0; band < job->bandCount; band++)
+        job->bandCommandCount[band] = 0;
+
+    for (int commandIndex = 0; commandIndex < renderList->count; commandIndex++) {
+        command = &renderList->commands[commandIndex];
+        rowFirst = RenderScale(command->y, indexBuffer->height, renderList->height);
+        rowEnd = RenderScale(command->y + command->height, indexBuffer->height, renderList->height);
+        if (rowFirst < 0)
+            rowFirst = 0;
+        if (rowEnd > indexBuffer->height)
+            rowEnd = indexBuffer->height;
+        if (rowEnd <= rowFirst)
+            continue;
+        bandFirst = rowFirst / job->bandHeight;
+        bandLast = (rowEnd - 1) / job->bandHeight;
+        for (int band = bandFirst; band <= bandLast; band++)
+            job->bandCommands[band][job->bandCommandCount[band]++] = (uint16_t)commandIndex;
+    }
+
+    /* Hand the bands out, and draw some on this thread too. */
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&pool->lock);
+#else
+    pthread_mutex_lock(&pool->lock);
+#endif
+    AtomicStoreRelease(&pool->bandsDone, 0);
+    AtomicStoreRelease(&pool->nextBand, 0);
+    pool->generation++;
+#ifdef _WIN32
+    WakeAllConditionVariable(&pool->wake);
+    ReleaseSRWLockExclusive(&pool->lock);
+#else
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+#endif
+
+    RenderPoolRunBands(pool);
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&pool->lock);
+    while (AtomicLoadAcquire(&pool->bandsDone) < (uint32_t)job->bandCount)
+        SleepConditionVariableSRW(&pool->done, &pool->lock, INFINITE, 0);
+    ReleaseSRWLockExclusive(&pool->lock);
+#else
+    pthread_mutex_lock(&pool->lock);
+    while (AtomicLoadAcquire(&pool->bandsDone) < (uint32_t)job->bandCount)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderRows
+    Clear a range of rows of a buffer and draw commands into it, clipped to
+    the rows and the width of the buffer. The commands are given by index,
+    or are the first count commands of the list if indices is NULL. Sprites
+    are left out if they are blended in later.
+ ----------------------------------------------------------------------------*/
+void RenderRows(const struct render_list *renderList, const uint16_t *indices, int count, struct bitmap_buffer *bitmapBuffer, int rowFirst, int rowEnd, bool spritesBlended)
+{
+    const struct render_command *command;
+    uint8_t *row;
+    int x0, x1, y0, y1, sourceX, sourceY;
+    char glyphRow;
+
+    row = (uint8_t *)bitmapBuffer->memory + bitmapBuffer->pitch * rowFirst;
+    for (int y = rowFirst; y < rowEnd; y++) {
+        memset(row, renderList->clearColor, bitmapBuffer->width);
+        row += bitmapBuffer->pitch;
+    }
+
+    for (int commandIndex = 0; commandIndex < count; commandIndex++) {
+        command = &renderList->commands[indices ? indices[commandIndex] : commandIndex];
+        if (!RenderClip(renderList, command, bitmapBuffer, rowFirst, rowEnd, &x0, &y0, &x1, &y1))
+            continue;
+
+        row = (uint8_t *)bitmapBuffer->memory + bitmapBuffer->pitch * y0;
+        switch (command->type) {
+        case RENDER_SPRITE:
+            if (spritesBlended)
+                break;
+            /* Fall through - drawn as a rectangle. */
+        case RENDER_RECTANGLE:
+            for (int y = y0; y < y1; y++) {
+                memset(row + x0, command->color, x1 - x0);
+                row += bitmapBuffer->pitch;
+            }
+            break;
+        case RENDER_GLYPH:
+            for (int y = y0; y < y1; y++) {
+                sourceY = RenderScaleInverse(y, bitmapBuffer->height, renderList->height) - command->y;
+                glyphRow = command->glyph[sourceY];
+                for (int x = x0; x < x1; x++) {
+                    sourceX = RenderScaleInverse(x, bitmapBuffer->width, renderList->width) - command->x;
+                    if (glyphRow & (1 << (FONT_SIZE - 1 - sourceX)))
+                        row[x] = command->color;
+                }
+                row += bitmapBuffer->pitch;
+            }
+            break;
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderSprites
+    Blend the sprites among some commands into a range of rows of a buffer
+    of 32 bit pixels, expanded from the commands drawn without them, so
+    the frame ends up layered in list order. Whatever comes after the first
+    sprite, the other commands and the particles over them all, was covered
+    by it and is drawn again on top, through the palette. In a frame that
+    draws its sprites first that is only the text and the particles.
+ ----------------------------------------------------------------------------*/
+void RenderSprites(const struct render_list *renderList, const uint16_t *indices, int count, const struct sprite_atlas *atlas, const struct palette *palette, struct bitmap_buffer *pixelBuffer, int rowFirst, int rowEnd)
+{
+    const struct render_command *command;
+    bool spriteDrawn = false;
+
+    for (int commandIndex = 0; commandIndex < count; commandIndex++) {
+        command = &renderList->commands[indices ? indices[commandIndex] : commandIndex];
+        if (command->type == RENDER_SPRITE) {
+            SpriteBlit(atlas, command->sprite, pixelBuffer,
+                RenderScale(command->x, pixelBuffer->width, renderList->width),
+                RenderScale(command->y, pixelBuffer->height, renderList->height),
+                RenderScale(command->x + command->width, pixelBuffer->width, renderList->width),
+                RenderScale(command->y + command->height, pixelBuffer->height, renderList->height),
+                rowFirst, rowEnd);
+            spriteDrawn = true;
+        }
+        else if (spriteDrawn)
+            RenderPixels(renderList, command, palette, pixelBuffer, rowFirst, rowEnd);
+    }
+
+    if (spriteDrawn && renderList->particles)
+        ParticlesSplat(renderList->particles, palette, pixelBuffer, renderList->width, renderList->height, rowFirst, rowEnd);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderPixels
+    Draw a rectangle or glyph straight into a range of rows of a buffer of
+    32 bit pixels, in its palette colour.
+ ----------------------------------------------------------------------------*/
+void RenderPixels(const struct render_list *renderList, const struct render_command *command, const struct palette *palette, struct bitmap_buffer *pixelBuffer, int rowFirst, int rowEnd)
+{
+    uint32_t pixel = palette->colors[command->color];
+    uint32_t *row;
+    int x0, x1, y0, y1, sourceX, sourceY;
+    char glyphRow;
+
+    if (!RenderClip(renderList, command, pixelBuffer, rowFirst, rowEnd, &x0, &y0, &x1, &y1))
+        return;
+
+    for (int y = y0; y < y1; y++) {
+        row = (uint32_t *)((uint8_t *)pixelBuffer->memory + pixelBuffer->pitch * y);
+        if (command->type != RENDER_GLYPH) {
+            for (int x = x0; x < x1; x++)
+                row[x] = pixel;
+            continue;
+        }
+        sourceY = RenderScaleInverse(y, pixelBuffer->height, renderList->height) - command->y;
+        glyphRow = command->glyph[sourceY];
+        for (int x = x0; x < x1; x++) {
+            sourceX = RenderScaleInverse(x, pixelBuffer->width, renderList->width) - command->x;
+            if (glyphRow & (1 << (FONT_SIZE - 1 - sourceX)))
+                row[x] = pixel;
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderClip
+    Find the output pixels a command covers, clipped to a range of rows and
+    the width of a buffer. Returns false if it covers none.
+ ----------------------------------------------------------------------------*/
+bool RenderClip(const struct render_list *renderList, const struct render_command *command, const struct bitmap_buffer *bitmapBuffer, int rowFirst, int rowEnd, int *x0, int *y0, int *x1, int *y1)
+{
+    *x0 = RenderScale(command->x, bitmapBuffer->width, renderList->width);
+    *x1 = RenderScale(command->x + command->width, bitmapBuffer->width, renderList->width);
+    *y0 = RenderScale(command->y, bitmapBuffer->height, renderList->height);
+    *y1 = RenderScale(command->y + command->height, bitmapBuffer->height, renderList->height);
+    if (*x0 < 0)
+        *x0 = 0;
+    if (*x1 > bitmapBuffer->width)
+        *x1 = bitmapBuffer->width;
+    if (*y0 < rowFirst)
+        *y0 = rowFirst;
+    if (*y1 > rowEnd)
+        *y1 = rowEnd;
+
+    return *x1 > *x0 && *y1 > *y0;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderPoolStart
+    Start a pool of worker threads. The thread that renders frames works
+    too, so it is not counted.
+ ----------------------------------------------------------------------------*/
+void RenderPoolStart(struct render_pool *pool, int threadCount)
+{
+    if (threadCount > RENDER_THREADS_MAX)
+        threadCount = RENDER_THREADS_MAX;
+
+    pool->threadCount = threadCount;
+    pool->generation = 0;
+    pool->nextBand = 0;
+    pool->bandsDone = 0;
+    pool->quit = 0;
+    pool->job.bandCount = (threadCount + 1) * RENDER_BANDS_PER_THREAD;
+    if (pool->job.bandCount > RENDER_BANDS_MAX)
+        pool->job.bandCount = RENDER_BANDS_MAX;
+
+#ifdef _WIN32
+    InitializeSRWLock(&pool->lock);
+    InitializeConditionVariable(&pool->wake);
+    InitializeConditionVariable(&pool->done);
+    for (int thread = 0; thread < threadCount; thread++)
+        pool->threads[thread] = CreateThread(NULL, 0, RenderWorker, pool, 0, NULL);
+#else
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (int thread = 0; thread < threadCount; thread++)
+        pthread_create(&pool->threads[thread], NULL, RenderWorker, pool);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderPoolStop
+    Stop the worker threads and wait for them to exit.
+ ----------------------------------------------------------------------------*/
+void RenderPoolStop(struct render_pool *pool)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&pool->lock);
+    pool->quit = 1;
+    WakeAllConditionVariable(&pool->wake);
+    ReleaseSRWLockExclusive(&pool->lock);
+    for (int thread = 0; thread < pool->threadCount; thread++) {
+        WaitForSingleObject(pool->threads[thread], INFINITE);
+        CloseHandle(pool->threads[thread]);
+    }
+#else
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int thread = 0; thread < pool->threadCount; thread++)
+        pthread_join(pool->threads[thread], NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderWorker
+    Worker thread: wait for a frame, draw bands until none are left, and
+    wait again.
+ ----------------------------------------------------------------------------*/
+#ifdef _WIN32
+DWORD WINAPI RenderWorker(LPVOID parameter)
+#else
+void *RenderWorker(void *parameter)
+#endif
+{
+    struct render_pool *pool = parameter;
+    uint32_t generationSeen = 0;
+    bool quit;
+
+    for (;;) {
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&pool->lock);
+        while (pool->generation == generationSeen && !pool->quit)
+            SleepConditionVariableSRW(&pool->wake, &pool->lock, INFINITE, 0);
+        generationSeen = pool->generation;
+        quit = pool->quit;
+        ReleaseSRWLockExclusive(&pool->lock);
+#else
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == generationSeen && !pool->quit)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        generationSeen = pool->generation;
+        quit = pool->quit;
+        pthread_mutex_unlock(&pool->lock);
+#endif
+        if (quit)
+            break;
+
+        RenderPoolRunBands(pool);
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderPoolRunBands
+    Take bands of the current frame and draw them until all are taken. The
+    thread that finishes the last band wakes the one waiting for the frame.
+ ----------------------------------------------------------------------------*/
+void RenderPoolRunBands(struct render_pool *pool)
+{
+    uint32_t bandCount = (uint32_t)pool->job.bandCount;
+    uint32_t band;
+
+    while ((band = AtomicAdd(&pool->nextBand, 1) - 1) < bandCount) {
+        RenderBand(&pool->job, (int)band);
+        if (AtomicAdd(&pool->bandsDone, 1) == bandCount) {
+#ifdef _WIN32
+            AcquireSRWLockExclusive(&pool->lock);
+            WakeConditionVariable(&pool->done);
+            ReleaseSRWLockExclusive(&pool->lock);
+#else
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_signal(&pool->done);
+            pthread_mutex_unlock(&pool->lock);
+#endif
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderBand
+    Draw one band of a frame, and expand it into pixels if there is a
+    palette. Bands never share rows, so no locking is needed.
+ ----------------------------------------------------------------------------*/
+void RenderBand(struct render_job *job, int band)
+{
+    struct bitmap_buffer indexRows, pixelRows;
+    int rowFirst = band * job->bandHeight;
+    int rowEnd = rowFirst + job->bandHeight;
+
+    if (rowEnd > job->indexBuffer->height)
+        rowEnd = job->indexBuffer->height;
+    if (rowEnd <= rowFirst)
+        return;
+
+    RenderRows(job->list, job->bandCommands[band], job->bandCommandCount[band], job->indexBuffer, rowFirst, rowEnd, job->atlas != NULL);
+    if (job->list->particles)
+        ParticlesSplat(job->list->particles, NULL, job->indexBuffer, job->list->width, job->list->height, rowFirst, rowEnd);
+
+    if (job->palette) {
+        indexRows = *job->indexBuffer;
+        indexRows.memory = (uint8_t *)indexRows.memory + indexRows.pitch * rowFirst;
+        indexRows.height = rowEnd - rowFirst;
+        pixelRows = *job->pixelBuffer;
+        pixelRows.memory = (uint8_t *)pixelRows.memory + pixelRows.pitch * rowFirst;
+        pixelRows.height = rowEnd - rowFirst;
+        PaletteExpand(job->palette, &indexRows, &pixelRows);
+        if (job->atlas)
+            RenderSprites(job->list, job->bandCommands[band], job->bandCommandCount[band], job->atlas, job->palette, job->pixelBuffer, rowFirst, rowEnd);
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RenderScale
+    Map a coordinate in game pixels to the first output pixel it covers.
+    Coordinates off the game area map off the output, to be clipped.
+ ----------------------------------------------------------------------------*/
+int RenderScale(int value, int outputSize, int sourceSize)
+{
+    int64_t scaled = (int64_t)value * outputSize;
+
+    /* Round down for negative coordinates too. */
+    if (scaled < 0)
+        scaled -= sourceSize - 1;
+
+    return (int)(scaled / sourceSize);
+}
+
+/*-----------------------------------------------------------------------------
+    RenderScaleInverse
+    Map an output pixel back to the game pixel that covers it.
+ ----------------------------------------------------------------------------*/
+int RenderScaleInverse(int output, int outputSize, int sourceSize)
+{
+    return (int)(((int64_t)(output + 1) * sourceSize - 1) / outputSize);
+}
\ No newline at end of file
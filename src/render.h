@@ -0,0 +1,115 @@
+/*=============================================================================
+    render.h
+ =============================================================================*/
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+#include "atomic.h"
+
+#define RENDER_COMMANDS_MAX 4096
+#define RENDER_BANDS_MAX 128
+#define RENDER_BANDS_PER_THREAD 4
+#define RENDER_THREADS_MAX 64
+
+enum render_command_type {
+    RENDER_RECTANGLE,
+    RENDER_GLYPH,
+    RENDER_SPRITE
+};
+
+/* Commands are in game pixels; they are scaled to the output when they
+   are rasterized. A sprite is drawn as a rectangle of its colour when the
+   frame has no atlas to blend it from. */
+struct render_command {
+    uint8_t type;
+    uint8_t color;
+    uint8_t sprite;
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+    const char *glyph;
+};
+
+struct particle_system;
+
+/* Particles are splatted over the commands, straight from the particle
+   system, as there are far more of them than commands. */
+struct render_list {
+    int width;
+    int height;
+    uint8_t clearColor;
+    const struct particle_system *particles;
+    int count;
+    struct render_command commands[RENDER_COMMANDS_MAX];
+};
+
+struct bitmap_buffer;
+struct palette;
+struct sprite_atlas;
+
+/* One frame for the workers: the output split into bands of rows, and the
+   commands that touch each band, in drawing order. */
+struct render_job {
+    const struct render_list *list;
+    struct bitmap_buffer *indexBuffer;
+    const struct palette *palette;
+    const struct sprite_atlas *atlas;
+    struct bitmap_buffer *pixelBuffer;
+    int bandCount;
+    int bandHeight;
+    int bandCommandCount[RENDER_BANDS_MAX];
+    uint16_t bandCommands[RENDER_BANDS_MAX][RENDER_COMMANDS_MAX];
+};
+
+/* Persistent worker threads. The band count is fixed for the life of the
+   pool so a worker that finishes late can never take a band twice. */
+struct render_pool {
+    int threadCount;
+    volatile uint32_t generation;
+    volatile uint32_t nextBand;
+    volatile uint32_t bandsDone;
+    volatile uint32_t quit;
+    struct render_job job;
+#ifdef _WIN32
+    HANDLE threads[RENDER_THREADS_MAX];
+    SRWLOCK lock;
+    CONDITION_VARIABLE wake;
+    CONDITION_VARIABLE done;
+#else
+    pthread_t threads[RENDER_THREADS_MAX];
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+#endif
+};
+
+void RenderListInit(struct render_list *, int, int, uint8_t);
+void RenderPushRectangle(struct render_list *, int, int, int, int, uint8_t);
+void RenderPushGlyph(struct render_list *, const char *, int, int, uint8_t);
+void RenderPushSprite(struct render_list *, int, int, int, int, int, uint8_t);
+void RenderFrame(struct render_pool *, const struct render_list *, struct bitmap_buffer *, const struct palette *, const struct sprite_atlas *, struct bitmap_buffer *);
+void RenderRows(const struct render_list *, const uint16_t *, int, struct bitmap_buffer *, int, int, bool);
+void RenderSprites(const struct render_list *, const uint16_t *, int, const struct sprite_atlas *, const struct palette *, struct bitmap_buffer *, int, int);
+void RenderPixels(const struct render_list *, const struct render_command *, const struct palette *, struct bitmap_buffer *, int, int);
+bool RenderClip(const struct render_list *, const struct render_command *, const struct bitmap_buffer *, int, int, int *, int *, int *, int *);
+void RenderPoolStart(struct render_pool *, int);
+void RenderPoolStop(struct render_pool *);
+void RenderPoolRunBands(struct render_pool *);
+#ifdef _WIN32
+DWORD WINAPI RenderWorker(LPVOID);
+#else
+void *RenderWorker(void *);
+#endif
+void RenderBand(struct render_job *, int);
+int RenderScale(int, int, int);
+int RenderScaleInverse(int, int, int);
+
+#endif /* RENDER_H */
\ No newline at end of file
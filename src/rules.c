@@ -0,0 +1,170 @@
+/*=============================================================================
+    rules.c
+    Game rules that can change at run time, so many variants can be played
+    in one process. The rules are read through the game state on every
+    tick; the brick grid only changes which kernels are picked, in
+    kernels.c.
+ =============================================================================*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "rules.h"
+
+const struct game_rules game_rules_default = {
+    BALL_SPEED_PIXELS_PER_SECOND,
+    BALL_INIT_ANGLE_DEGREES,
+    BALL_ANGLE_DEGREES_REFLECT_PADDLE_MIN,
+    BALL_ANGLE_DEGREES_REFLECT_PADDLE_MAX,
+    PADDLE_SPEED_PIXELS_PER_SECOND,
+    PADDLE_WIDTH,
+    PADDLE_DEAD_ZONE_RADIUS,
+    LIVES_INIT,
+    SCORE_MAX,
+    SCORE_POINTS_PER_BRICK,
+    BRICK_ROWS,
+    BRICK_COLUMNS,
+    BRICK_WIDTH,
+    BRICK_HEIGHT,
+    BRICK_POSITION_Y_FIRST_COLUMN,
+    COUNTDOWN_TIME,
+    CAMERA_SPEED_PIXELS_PER_SECOND
+};
+
+static const struct rule_field ruleFields[] = {
+    {"ballSpeed", RULE_FLOAT, offsetof(struct game_rules, ballSpeed), 1.0, 1000.0},
+    {"ballAngleInit", RULE_DOUBLE, offsetof(struct game_rules, ballAngleInit), 0.0, 360.0},
+    {"ballAngleReflectMin", RULE_DOUBLE, offsetof(struct game_rules, ballAngleReflectMin), 1.0, 179.0},
+    {"ballAngleReflectMax", RULE_DOUBLE, offsetof(struct game_rules, ballAngleReflectMax), 1.0, 179.0},
+    {"paddleSpeed", RULE_FLOAT, offsetof(struct game_rules, paddleSpeed), 1.0, 1000.0},
+    {"paddleWidth", RULE_INT, offsetof(struct game_rules, paddleWidth), BALL_WIDTH, QVGA_WIDTH},
+    {"paddleDeadZoneRadius", RULE_INT, offsetof(struct game_rules, paddleDeadZoneRadius), 0, QVGA_WIDTH},
+    {"lives", RULE_INT, offsetof(struct game_rules, lives), 0, RULES_LIVES_MAX},
+    {"scoreMax", RULE_INT, offsetof(struct game_rules, scoreMax), 1, RULES_SCORE_MAX},
+    {"scorePerBrick", RULE_INT, offsetof(struct game_rules, scorePerBrick), 1, RULES_SCORE_MAX},
+    {"brickRows", RULE_INT, offsetof(struct game_rules, brickRows), 1, BRICK_ROWS_MAX},
+    {"brickColumns", RULE_INT, offsetof(struct game_rules, brickColumns), 1, BRICK_COLUMNS_MAX},
+    {"brickWidth", RULE_INT, offsetof(struct game_rules, brickWidth), 1, QVGA_WIDTH},
+    {"brickHeight", RULE_INT, offsetof(struct game_rules, brickHeight), 1, QVGA_HEIGHT},
+    {"brickFirstRowY", RULE_FLOAT, offsetof(struct game_rules, brickFirstRowY), 0.0, QVGA_HEIGHT},
+    {"countdownTime", RULE_FLOAT, offsetof(struct game_rules, countdownTime), 0.0, 9.0},
+    {"cameraSpeed", RULE_FLOAT, offsetof(struct game_rules, cameraSpeed), 1.0, 1000.0}
+};
+
+/*-----------------------------------------------------------------------------
+    RulesInit
+    Set the rules to the defaults.
+ ----------------------------------------------------------------------------*/
+void RulesInit(struct game_rules *rules)
+{
+    *rules = game_rules_default;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    RulesSet
+    Change rules from a list of name=value pairs separated by commas, such
+    as "ballSpeed=120,lives=5". Returns false, with the rules partly
+    changed, if a name is unknown, a value out of its range, or the rules
+    that result do not fit together.
+ ----------------------------------------------------------------------------*/
+bool RulesSet(struct game_rules *rules, const char *settings)
+{
+    const char *setting = settings;
+    const char *equals, *end;
+
+    while (*setting) {
+        end = strchr(setting, ',');
+        if (!end)
+            end = setting + strlen(setting);
+        equals = memchr(setting, '=', end - setting);
+        if (!equals || !RulesSetField(rules, setting, equals - setting, equals + 1))
+            return false;
+        setting = (*end == ',') ? end + 1 : end;
+    }
+
+    return RulesValid(rules);
+}
+
+/*-----------------------------------------------------------------------------
+    RulesSetField
+    Set one rule, named by the first bytes of a string, from a value that
+    ends at a comma or the end of the string. Returns false if the name is
+    unknown or the value is not a number in the rule's range.
+ ----------------------------------------------------------------------------*/
+bool RulesSetField(struct game_rules *rules, const char *name, size_t nameLength, const char *value)
+{
+    const struct rule_field *field;
+    char *valueEnd;
+    double number;
+
+    for (size_t fieldIndex = 0; fieldIndex < sizeof(ruleFields) / sizeof(ruleFields[0]); fieldIndex++) {
+        field = &ruleFields[fieldIndex];
+        if (strlen(field->name) != nameLength || strncmp(field->name, name, nameLength) != 0)
+            continue;
+
+        number = strtod(value, &valueEnd);
+        if (valueEnd == value || (*valueEnd != ',' && *valueEnd != '\0'))
+            return false;
+        if (!(number >= field->min && number <= field->max))
+            return false;
+
+        switch (field->type) {
+        case RULE_INT:
+            if (number != (double)(int)number)
+                return false;
+            *(int *)((char *)rules + field->offset) = (int)number;
+            break;
+        case RULE_FLOAT:
+            *(float *)((char *)rules + field->offset) = (float)number;
+            break;
+        case RULE_DOUBLE:
+            *(double *)((char *)rules + field->offset) = number;
+            break;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------------------------
+    RulesValid
+    Returns true if the rules fit together: the paddle and the built in
+    grid fit across the screen, the reflection angles are in order and the
+    dead zone is narrower than the paddle.
+ ----------------------------------------------------------------------------*/
+bool RulesValid(const struct game_rules *rules)
+{
+    return rules->paddleWidth <= QVGA_WIDTH
+        && rules->brickColumns * rules->brickWidth <= QVGA_WIDTH
+        && rules->brickRows * rules->brickHeight <= QVGA_HEIGHT * LEVEL_SCREENS_MAX
+        && rules->ballAngleReflectMin < rules->ballAngleReflectMax
+        && rules->paddleDeadZoneRadius * 2 < rules->paddleWidth + BALL_WIDTH;
+}
+
+/*-----------------------------------------------------------------------------
+    RulesHash
+    Returns a 64 bit FNV-1a hash of every rule's value, for telling rules
+    apart. Fields are hashed one by one, so padding between them is left
+    out.
+ ----------------------------------------------------------------------------*/
+uint64_t RulesHash(const struct game_rules *rules)
+{
+    const struct rule_field *field;
+    const uint8_t *value;
+    size_t valueSize;
+    uint64_t hash = RULES_HASH_BASIS;
+
+    for (size_t fieldIndex = 0; fieldIndex < sizeof(ruleFields) / sizeof(ruleFields[0]); fieldIndex++) {
+        field = &ruleFields[fieldIndex];
+        value = (const uint8_t *)rules + field->offset;
+        valueSize = (field->type == RULE_DOUBLE) ? sizeof(double) : (field->type == RULE_FLOAT) ? sizeof(float) : sizeof(int);
+        for (size_t byte = 0; byte < valueSize; byte++)
+            hash = (hash ^ value[byte]) * RULES_HASH_PRIME;
+    }
+
+    return hash;
+}
\ No newline at end of file
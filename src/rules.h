@@ -0,0 +1,65 @@
+/*=============================================================================
+    rules.h
+ =============================================================================*/
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RULES_LIVES_MAX 9
+#define RULES_SCORE_MAX 999
+#define RULES_HASH_BASIS 0xCBF29CE484222325ull
+#define RULES_HASH_PRIME 0x100000001B3ull
+
+/* The rules a game is played by. Every game state refers to a set of
+   rules, which must stay unchanged while it does; games run side by side
+   can each have their own. Speeds are in pixels per second and angles in
+   degrees; the brick grid is the built in layout's, used when there is no
+   level. The defaults are the #defines in game.h. */
+struct game_rules {
+    float ballSpeed;
+    double ballAngleInit;
+    double ballAngleReflectMin;
+    double ballAngleReflectMax;
+    float paddleSpeed;
+    int paddleWidth;
+    int paddleDeadZoneRadius;
+    int lives;
+    int scoreMax;
+    int scorePerBrick;
+    int brickRows;
+    int brickColumns;
+    int brickWidth;
+    int brickHeight;
+    float brickFirstRowY;
+    float countdownTime;
+    float cameraSpeed;
+};
+
+enum rule_type {
+    RULE_INT,
+    RULE_FLOAT,
+    RULE_DOUBLE
+};
+
+/* A rule that can be set by name, and the range it must be in. */
+struct rule_field {
+    const char *name;
+    enum rule_type type;
+    size_t offset;
+    double min;
+    double max;
+};
+
+extern const struct game_rules game_rules_default;
+
+void RulesInit(struct game_rules *);
+bool RulesSet(struct game_rules *, const char *);
+bool RulesSetField(struct game_rules *, const char *, size_t, const char *);
+bool RulesValid(const struct game_rules *);
+uint64_t RulesHash(const struct game_rules *);
+
+#endif /* RULES_H */
\ No newline at end of file
@@ -0,0 +1,226 @@
+/*=============================================================================
+    simulate.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "game.h"
+#include "simulate.h"
+#include "bricks.h"
+#include "particles.h"
+#include "telemetry.h"
+#include "kernels.h"
+
+/*-----------------------------------------------------------------------------
+    GameFastForward
+    Advance the game by a number of fixed ticks without an input queue. The
+    result matches calling GameUpdate for every tick, but stretches where
+    the ball only travels in a straight line (and the paddle and countdown
+    only move steadily) are jumped over without collision checks, so the
+    brick scan runs once per event rather than once per tick. Scripted
+    input is applied with GameApplyKey between calls, which splits the run
+    at every input change.
+ ----------------------------------------------------------------------------*/
+void GameFastForward(float deltaTimeMs, struct game_state *gameState, int ticks)
+{
+    int quietTicks;
+
+    while (ticks > 0) {
+        quietTicks = GameQuietTicks(deltaTimeMs, gameState, ticks);
+        if (quietTicks > 0) {
+            GameSkipTicks(deltaTimeMs, gameState, quietTicks);
+            ticks -= quietTicks;
+        }
+        else {
+            GameUpdate(deltaTimeMs, gameState, NULL);
+            ticks--;
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    GameQuietTicks
+    Returns how many of the next ticks (up to a maximum) are certain to do
+    nothing but move the ball, paddle and countdown steadily. The next event
+    is found analytically: the ball reaching a wall, the paddle plane or a
+    brick, or the countdown reaching a whole second, where it ticks and is
+    drawn anew. Particles in flight move every tick, so none are quiet
+    while there are any. Only bricks in view can be
+    reached before a wall, and they are swept by the kernel for the width
+    of the grid. A tick of margin is kept so float rounding can never skip
+    past an event.
+ ----------------------------------------------------------------------------*/
+int GameQuietTicks(float deltaTimeMs, struct game_state *gameState, int maxTicks)
+{
+    float secondElapsed = (deltaTimeMs / (float)MS_PER_SECOND);
+    struct rectangle rectBall = gameState->ball.rect;
+    struct rectangle rectBallWorld;
+    const struct brick_set *brickSet = &gameState->bricks;
+    int rowFirst, rowLast;
+    float stepX, stepY, paddleTop;
+    float eventTick = SIMULATE_NEVER;
+    int quietTicks;
+
+    if (gameState->pausedUser)
+        return maxTicks;
+
+    /* The opponent's paddle is not modelled; step versus games tick by
+       tick. */
+    if (gameState->versus)
+        return 0;
+
+    if (gameState->particles && gameState->particles->count > 0)
+        return 0;
+
+    if (gameState->paused) {
+        quietTicks = TicksBefore((gameState->countdown - floorf(gameState->countdown)) / secondElapsed);
+        return (quietTicks < maxTicks) ? quietTicks : maxTicks;
+    }
+
+    /* Bricks move on the screen while the camera scrolls. */
+    if (gameState->cameraY < gameState->cameraTarget)
+        return 0;
+
+    stepX = gameState->ball.velocity.x * secondElapsed;
+    stepY = gameState->ball.velocity.y * secondElapsed;
+
+    /* Near the paddle the paddle moves too, so step tick by tick. */
+    paddleTop = gameState->paddle.rect.position.y + gameState->paddle.rect.height;
+    if (rectBall.position.y <= paddleTop)
+        return 0;
+
+    /* Walls and the paddle plane. */
+    if (stepX > 0.0f)
+        eventTick = CalcMin(eventTick, ((QVGA_WIDTH - BALL_WIDTH) - rectBall.position.x) / stepX);
+    else if (stepX < 0.0f)
+        eventTick = CalcMin(eventTick, rectBall.position.x / -stepX);
+    if (stepY > 0.0f)
+        eventTick = CalcMin(eventTick, ((QVGA_HEIGHT - BALL_HEIGHT) - rectBall.position.y) / stepY);
+    else if (stepY < 0.0f)
+        eventTick = CalcMin(eventTick, (rectBall.position.y - paddleTop) / -stepY);
+
+    /* Bricks. */
+    rectBallWorld = rectBall;
+    rectBallWorld.position.y += gameState->cameraY;
+    if (BrickRowsOverlapping(brickSet, gameState->cameraY, gameState->cameraY + QVGA_HEIGHT, &rowFirst, &rowLast))
+        eventTick = CalcMin(eventTick, gameState->kernels->sweep(brickSet, rectBallWorld, stepX, stepY, rowFirst, rowLast));
+
+    quietTicks = TicksBefore(eventTick);
+
+    return (quietTicks < maxTicks) ? quietTicks : maxTicks;
+}
+
+/*-----------------------------------------------------------------------------
+    GameSkipTicks
+    Advance the game over ticks that GameQuietTicks found to be quiet. No
+    collisions or input are checked, and no sound is due; only the per tick
+    arithmetic of GameUpdate is repeated, so the game, and whether its
+    frame changed, come out bit for bit as stepping leaves them. Floats
+    added up a tick at a time round differently from one multiply, so the
+    ball and countdown still take a loop each; the paddle does not when no
+    key moves it.
+ ----------------------------------------------------------------------------*/
+void GameSkipTicks(float deltaTimeMs, struct game_state *gameState, int ticks)
+{
+    float secondElapsed = (deltaTimeMs / (float)MS_PER_SECOND);
+    float stepX = gameState->ball.velocity.x * secondElapsed;
+    float stepY = gameState->ball.velocity.y * secondElapsed;
+
+    gameState->tickTimeUs += (uint64_t)(deltaTimeMs * US_PER_MS) * ticks;
+    if (gameState->telemetry)
+        TelemetryTick(gameState->telemetry, ticks);
+
+    if (gameState->pausedUser)
+        return;
+
+    if (gameState->paused) {
+        for (int tick = 0; tick < ticks; tick++)
+            gameState->countdown -= secondElapsed;
+        return;
+    }
+
+    if (ticks > 0)
+        gameState->frameChanged = true;
+    if (gameState->keyboard[GAME_KEY_LEFT] != gameState->keyboard[GAME_KEY_RIGHT]) {
+        for (int tick = 0; tick < ticks; tick++)
+            PaddleMove(gameState, secondElapsed);
+    }
+    for (int tick = 0; tick < ticks; tick++) {
+        gameState->ball.rect.position.x += stepX;
+        gameState->ball.rect.position.y += stepY;
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    SweepAxis
+    Find the range of (fractional) ticks during which an offset that grows
+    by step every tick lies within [low, high]. Returns the first tick and
+    stores the last tick in exitTick.
+ ----------------------------------------------------------------------------*/
+float SweepAxis(float low, float high, float step, float *exitTick)
+{
+    if (step > 0.0f) {
+        *exitTick = high / step;
+        return low / step;
+    }
+    if (step < 0.0f) {
+        *exitTick = low / step;
+        return high / step;
+    }
+    if (low <= 0.0f && high >= 0.0f) {
+        *exitTick = SIMULATE_NEVER;
+        return -SIMULATE_NEVER;
+    }
+    *exitTick = -SIMULATE_NEVER;
+
+    return SIMULATE_NEVER;
+}
+
+/*-----------------------------------------------------------------------------
+    SweepEnterTick
+    Returns the first (fractional) tick at which a ball moving by a fixed
+    step every tick overlaps a rectangle the way DetectCollisionRectangle
+    sees it, 0 if it overlaps already, or SIMULATE_NEVER.
+ ----------------------------------------------------------------------------*/
+float SweepEnterTick(struct rectangle rectBall, float stepX, float stepY, struct rectangle rect)
+{
+    float enterX, exitX, enterY, exitY, enterTick, exitTick;
+
+    enterX = SweepAxis(
+        rect.position.x - rectBall.width - rectBall.position.x,
+        rect.position.x + rect.width - rectBall.position.x,
+        stepX, &exitX);
+    enterY = SweepAxis(
+        rect.position.y - rectBall.height - rectBall.position.y,
+        rect.position.y + rect.height - rectBall.position.y,
+        stepY, &exitY);
+
+    enterTick = CalcMax(enterX, enterY);
+    exitTick = CalcMin(exitX, exitY);
+
+    if (enterTick > exitTick || exitTick < 0.0f)
+        return SIMULATE_NEVER;
+
+    return ClampMin(enterTick, 0.0f);
+}
+
+/*-----------------------------------------------------------------------------
+    TicksBefore
+    Returns the number of whole ticks that are certain to end before a
+    fractional event tick, keeping one tick of margin.
+ ----------------------------------------------------------------------------*/
+int TicksBefore(float eventTick)
+{
+    if (eventTick >= (float)INT32_MAX)
+        return INT32_MAX;
+    if (eventTick < 2.0f)
+        return 0;
+
+    return (int)eventTick - 1;
+}
\ No newline at end of file
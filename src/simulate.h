@@ -0,0 +1,17 @@
+/*=============================================================================
+    simulate.h
+ =============================================================================*/
+
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#define SIMULATE_NEVER 1.0e30f
+
+void GameFastForward(float, struct game_state *, int);
+int GameQuietTicks(float, struct game_state *, int);
+void GameSkipTicks(float, struct game_state *, int);
+float SweepAxis(float, float, float, float *);
+float SweepEnterTick(struct rectangle, float, float, struct rectangle);
+int TicksBefore(float);
+
+#endif /* SIMULATE_H */
\ No newline at end of file
@@ -0,0 +1,326 @@
+/*=============================================================================
+    sprite.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SPRITE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SPRITE_SSE2
+#endif
+
+#include "game.h"
+#include "palette.h"
+#include "sprite.h"
+
+/*-----------------------------------------------------------------------------
+    SpriteAtlasInit
+    Draw the game's sprites into an atlas: an anti-aliased ball, a rounded
+    paddle and a bevelled brick in every palette colour.
+ ----------------------------------------------------------------------------*/
+void SpriteAtlasInit(struct sprite_atlas *atlas, const struct palette *palette)
+{
+    const struct sprite *sprite;
+    uint32_t *pixel;
+    float sampleX, sampleY, centerX, centerY, radius, offsetX, offsetY;
+    int coverage, alpha, shade;
+
+    memset(atlas->pixels, 0, sizeof(atlas->pixels));
+    atlas->shelfX = 0;
+    atlas->shelfY = 0;
+    atlas->shelfHeight = 0;
+
+    /* Ball: a disc lit from the top left. */
+    SpriteAtlasAdd(atlas, SPRITE_BALL, BALL_WIDTH, BALL_HEIGHT);
+    sprite = &atlas->sprites[SPRITE_BALL];
+    centerX = BALL_WIDTH * 0.5f;
+    centerY = BALL_HEIGHT * 0.5f;
+    radius = BALL_WIDTH * 0.5f;
+    for (int y = 0; y < sprite->height; y++) {
+        for (int x = 0; x < sprite->width; x++) {
+            coverage = 0;
+            for (int sample = 0; sample < SPRITE_SUBSAMPLES * SPRITE_SUBSAMPLES; sample++) {
+                sampleX = x + ((sample % SPRITE_SUBSAMPLES) + 0.5f) / SPRITE_SUBSAMPLES - centerX;
+                sampleY = y + ((sample / SPRITE_SUBSAMPLES) + 0.5f) / SPRITE_SUBSAMPLES - centerY;
+                coverage += (sampleX * sampleX + sampleY * sampleY <= radius * radius);
+            }
+            alpha = coverage * 255 / (SPRITE_SUBSAMPLES * SPRITE_SUBSAMPLES);
+            offsetX = x + 0.5f - (centerX - 1.5f);
+            offsetY = y + 0.5f - (centerY + 1.5f);
+            shade = 256 - (int)((offsetX * offsetX + offsetY * offsetY) * 6.0f);
+            pixel = &atlas->pixels[(sprite->y + y) * SPRITE_ATLAS_WIDTH + sprite->x + x];
+            *pixel = SpriteShade(palette->colors[COLOR_WHITE], (shade > 96) ? shade : 96, alpha);
+        }
+    }
+
+    /* Paddle: a capsule, brighter towards the top. */
+    SpriteAtlasAdd(atlas, SPRITE_PADDLE, PADDLE_WIDTH, PADDLE_HEIGHT);
+    sprite = &atlas->sprites[SPRITE_PADDLE];
+    radius = PADDLE_HEIGHT * 0.5f;
+    for (int y = 0; y < sprite->height; y++) {
+        for (int x = 0; x < sprite->width; x++) {
+            coverage = 0;
+            for (int sample = 0; sample < SPRITE_SUBSAMPLES * SPRITE_SUBSAMPLES; sample++) {
+                sampleX = x + ((sample % SPRITE_SUBSAMPLES) + 0.5f) / SPRITE_SUBSAMPLES;
+                sampleY = y + ((sample / SPRITE_SUBSAMPLES) + 0.5f) / SPRITE_SUBSAMPLES - radius;
+                sampleX -= ClampMax(ClampMin(sampleX, radius), PADDLE_WIDTH - radius);
+                coverage += (sampleX * sampleX + sampleY * sampleY <= radius * radius);
+            }
+            alpha = coverage * 255 / (SPRITE_SUBSAMPLES * SPRITE_SUBSAMPLES);
+            shade = 160 + 96 * y / (PADDLE_HEIGHT - 1);
+            pixel = &atlas->pixels[(sprite->y + y) * SPRITE_ATLAS_WIDTH + sprite->x + x];
+            *pixel = SpriteShade(palette->colors[COLOR_WHITE], shade, alpha);
+        }
+    }
+
+    /* Bricks: opaque, with a light top and left edge and a dark bottom and
+       right edge. */
+    for (int color = 0; color < NUM_PALETTE_COLORS; color++) {
+        SpriteAtlasAdd(atlas, SPRITE_BRICK + color, BRICK_WIDTH, BRICK_HEIGHT);
+        sprite = &atlas->sprites[SPRITE_BRICK + color];
+        for (int y = 0; y < sprite->height; y++) {
+            for (int x = 0; x < sprite->width; x++) {
+                if (y == BRICK_HEIGHT - 1 || x == 0)
+                    shade = 320;
+                else if (y == 0 || x == BRICK_WIDTH - 1)
+                    shade = 144;
+                else
+                    shade = 232;
+                pixel = &atlas->pixels[(sprite->y + y) * SPRITE_ATLAS_WIDTH + sprite->x + x];
+                *pixel = SpriteShade(palette->colors[color], shade, 255);
+            }
+        }
+    }
+
+    /* Opaque sprites are copied rather than blended. */
+    for (int spriteId = 0; spriteId < NUM_SPRITES; spriteId++) {
+        sprite = &atlas->sprites[spriteId];
+        atlas->sprites[spriteId].opaque = true;
+        for (int y = 0; y < sprite->height; y++)
+            for (int x = 0; x < sprite->width; x++)
+                if ((atlas->pixels[(sprite->y + y) * SPRITE_ATLAS_WIDTH + sprite->x + x] >> 24) != 0xFF)
+                    atlas->sprites[spriteId].opaque = false;
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    SpriteAtlasFlatten
+    Fill every sprite in an atlas with the colour it is drawn in without an
+    atlas: white for the ball and paddle and its own colour for a brick.
+    Frames drawn with a flattened atlas match frames drawn without one
+    pixel for pixel, as long as both layer the frame alike.
+ ----------------------------------------------------------------------------*/
+void SpriteAtlasFlatten(struct sprite_atlas *atlas, const struct palette *palette)
+{
+    const struct sprite *sprite;
+    uint32_t color;
+
+    for (int spriteId = 0; spriteId < NUM_SPRITES; spriteId++) {
+        sprite = &atlas->sprites[spriteId];
+        color = palette->colors[(spriteId >= SPRITE_BRICK) ? spriteId - SPRITE_BRICK : COLOR_WHITE];
+        for (int y = 0; y < sprite->height; y++)
+            for (int x = 0; x < sprite->width; x++)
+                atlas->pixels[(sprite->y + y) * SPRITE_ATLAS_WIDTH + sprite->x + x] = color;
+        atlas->sprites[spriteId].opaque = true;
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    SpriteAtlasAdd
+    Reserve room for a sprite. Sprites are placed left to right on shelves
+    as tall as the tallest sprite on them. Returns false if the atlas is
+    full.
+ ----------------------------------------------------------------------------*/
+bool SpriteAtlasAdd(struct sprite_atlas *atlas, int sprite, int width, int height)
+{
+    if (atlas->shelfX + width > SPRITE_ATLAS_WIDTH) {
+        atlas->shelfY += atlas->shelfHeight;
+        atlas->shelfX = 0;
+        atlas->shelfHeight = 0;
+    }
+    if (width > SPRITE_ATLAS_WIDTH || atlas->shelfY + height > SPRITE_ATLAS_HEIGHT)
+        return false;
+
+    atlas->sprites[sprite].x = atlas->shelfX;
+    atlas->sprites[sprite].y = atlas->shelfY;
+    atlas->sprites[sprite].width = width;
+    atlas->sprites[sprite].height = height;
+    atlas->shelfX += width;
+    if (height > atlas->shelfHeight)
+        atlas->shelfHeight = height;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    SpriteShade
+    Scale the colour channels of a pixel by shade / 256 and premultiply
+    them by alpha. The channels are treated alike, so the byte order of
+    the pixel format does not matter.
+ ----------------------------------------------------------------------------*/
+uint32_t SpriteShade(uint32_t color, int shade, int alpha)
+{
+    uint32_t result = (uint32_t)alpha << 24;
+    int channel;
+
+    for (int byte = 0; byte < 3; byte++) {
+        channel = (int)((color >> (byte * 8)) & 0xFF) * shade >> 8;
+        if (channel > 255)
+            channel = 255;
+        result |= (uint32_t)((channel * alpha + 127) / 255) << (byte * 8);
+    }
+
+    return result;
+}
+
+/*-----------------------------------------------------------------------------
+    SpriteBlit
+    Blend a sprite, stretched to an output rectangle, into a buffer of 32
+    bit pixels. The rectangle is clipped to the buffer and to a range of
+    rows.
+ ----------------------------------------------------------------------------*/
+void SpriteBlit(const struct sprite_atlas *atlas, int spriteId, struct bitmap_buffer *pixelBuffer, int x0, int y0, int x1, int y1, int rowFirst, int rowEnd)
+{
+    const struct sprite *sprite = &atlas->sprites[spriteId];
+    const uint32_t *source;
+    uint32_t *destination;
+    uint32_t span[SPRITE_SPAN_MAX];
+    int width = x1 - x0;
+    int height = y1 - y0;
+    int clipX0, clipX1, clipY0, clipY1, count, sourceRow;
+    int spanRow = -1;
+    uint32_t sourceX, step;
+
+    if (width <= 0 || height <= 0)
+        return;
+
+    clipX0 = (x0 > 0) ? x0 : 0;
+    clipX1 = (x1 < pixelBuffer->width) ? x1 : pixelBuffer->width;
+    clipY0 = (y0 > rowFirst) ? y0 : rowFirst;
+    clipY1 = (y1 < rowEnd) ? y1 : rowEnd;
+    if (clipX1 <= clipX0)
+        return;
+
+    /* Source columns are stepped in 16.16 fixed point. */
+    step = (uint32_t)(((uint64_t)sprite->width << 16) / width);
+
+    for (int y = clipY0; y < clipY1; y++) {
+        sourceRow = (y - y0) * sprite->height / height;
+        source = &atlas->pixels[(sprite->y + sourceRow) * SPRITE_ATLAS_WIDTH + sprite->x];
+        destination = (uint32_t *)((uint8_t *)pixelBuffer->memory + pixelBuffer->pitch * y);
+        if (width == sprite->width) {
+            SpriteSpan(destination + clipX0, source + (clipX0 - x0), clipX1 - clipX0, sprite->opaque);
+            continue;
+        }
+        /* Stretch the row into a span first, so blending stays in bulk. A
+           span that fits whole is kept for the rows that repeat it. */
+        for (int x = clipX0; x < clipX1; x += count) {
+            count = clipX1 - x;
+            if (count > SPRITE_SPAN_MAX)
+                count = SPRITE_SPAN_MAX;
+            if (sourceRow != spanRow || count != clipX1 - clipX0) {
+                sourceX = (uint32_t)(x - x0) * step;
+                for (int pixel = 0; pixel < count; pixel++, sourceX += step)
+                    span[pixel] = source[sourceX >> 16];
+                spanRow = (count == clipX1 - clipX0) ? sourceRow : -1;
+            }
+            SpriteSpan(destination + x, span, count, sprite->opaque);
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    SpriteSpan
+    Draw a span of sprite pixels: copy it if the sprite is opaque, and blend
+    it otherwise.
+ ----------------------------------------------------------------------------*/
+void SpriteSpan(uint32_t *destination, const uint32_t *source, int count, bool opaque)
+{
+    if (opaque)
+        memcpy(destination, source, count * sizeof(uint32_t));
+    else
+        SpriteBlendSpan(destination, source, count);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    SpriteBlendSpan
+    Blend premultiplied source pixels over destination pixels:
+    destination = source + destination * (255 - alpha) / 255, rounded. With
+    AVX2 eight pixels are blended at a time, with SSE2 four; the channels
+    are widened to 16 bits and the division by 255 is done with shifts.
+ ----------------------------------------------------------------------------*/
+void SpriteBlendSpan(uint32_t *destination, const uint32_t *source, int count)
+{
+    int pixel = 0;
+    uint32_t sourcePixel, destinationPixel, result, inverseAlpha, blended;
+
+#if defined(SPRITE_AVX2)
+    __m256i zero = _mm256_setzero_si256();
+    __m256i bias = _mm256_set1_epi16(128);
+    __m256i full = _mm256_set1_epi16(255);
+    __m256i sourceVector, destinationVector, sourceLow, sourceHigh, low, high;
+
+    for (; pixel + 8 <= count; pixel += 8) {
+        sourceVector = _mm256_loadu_si256((const __m256i *)(source + pixel));
+        destinationVector = _mm256_loadu_si256((const __m256i *)(destination + pixel));
+        sourceLow = _mm256_unpacklo_epi8(sourceVector, zero);
+        sourceHigh = _mm256_unpackhi_epi8(sourceVector, zero);
+        sourceLow = _mm256_sub_epi16(full, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(sourceLow, 0xFF), 0xFF));
+        sourceHigh = _mm256_sub_epi16(full, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(sourceHigh, 0xFF), 0xFF));
+        low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(destinationVector, zero), sourceLow), bias);
+        high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(destinationVector, zero), sourceHigh), bias);
+        low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+        high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+        _mm256_storeu_si256((__m256i *)(destination + pixel),
+            _mm256_adds_epu8(_mm256_packus_epi16(low, high), sourceVector));
+    }
+#elif defined(SPRITE_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i bias = _mm_set1_epi16(128);
+    __m128i full = _mm_set1_epi16(255);
+    __m128i sourceVector, destinationVector, sourceLow, sourceHigh, low, high;
+
+    for (; pixel + 4 <= count; pixel += 4) {
+        sourceVector = _mm_loadu_si128((const __m128i *)(source + pixel));
+        destinationVector = _mm_loadu_si128((const __m128i *)(destination + pixel));
+        sourceLow = _mm_unpacklo_epi8(sourceVector, zero);
+        sourceHigh = _mm_unpackhi_epi8(sourceVector, zero);
+        sourceLow = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(sourceLow, 0xFF), 0xFF));
+        sourceHigh = _mm_sub_epi16(full, _mm_shufflehi_epi16(_mm_shufflelo_epi16(sourceHigh, 0xFF), 0xFF));
+        low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(destinationVector, zero), sourceLow), bias);
+        high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(destinationVector, zero), sourceHigh), bias);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        _mm_storeu_si128((__m128i *)(destination + pixel),
+            _mm_adds_epu8(_mm_packus_epi16(low, high), sourceVector));
+    }
+#endif
+
+    for (; pixel < count; pixel++) {
+        sourcePixel = source[pixel];
+        destinationPixel = destination[pixel];
+        inverseAlpha = 255 - (sourcePixel >> 24);
+        result = 0;
+        for (int byte = 0; byte < 32; byte += 8) {
+            blended = ((destinationPixel >> byte) & 0xFF) * inverseAlpha + 128;
+            blended = ((blended + (blended >> 8)) >> 8) + ((sourcePixel >> byte) & 0xFF);
+            result |= ((blended > 255) ? 255 : blended) << byte;
+        }
+        destination[pixel] = result;
+    }
+
+    return;
+}
\ No newline at end of file
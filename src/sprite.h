@@ -0,0 +1,54 @@
+/*=============================================================================
+    sprite.h
+ =============================================================================*/
+
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "palette.h"
+
+#define SPRITE_ATLAS_WIDTH 128
+#define SPRITE_ATLAS_HEIGHT 64
+#define SPRITE_SPAN_MAX 1024
+#define SPRITE_SUBSAMPLES 4
+
+/* Brick sprites follow each other in palette order. */
+enum sprite_ids {
+    SPRITE_BALL,
+    SPRITE_PADDLE,
+    SPRITE_BRICK,
+    NUM_SPRITES = SPRITE_BRICK + NUM_PALETTE_COLORS
+};
+
+struct sprite {
+    int x;
+    int y;
+    int width;
+    int height;
+    bool opaque;
+};
+
+/* Premultiplied alpha pixels in the platform's pixel format, with alpha
+   in the top byte, packed on shelves into one image. */
+struct sprite_atlas {
+    uint32_t pixels[SPRITE_ATLAS_WIDTH * SPRITE_ATLAS_HEIGHT];
+    struct sprite sprites[NUM_SPRITES];
+    int shelfX;
+    int shelfY;
+    int shelfHeight;
+};
+
+struct bitmap_buffer;
+
+void SpriteAtlasInit(struct sprite_atlas *, const struct palette *);
+void SpriteAtlasFlatten(struct sprite_atlas *, const struct palette *);
+bool SpriteAtlasAdd(struct sprite_atlas *, int, int, int);
+uint32_t SpriteShade(uint32_t, int, int);
+void SpriteBlit(const struct sprite_atlas *, int, struct bitmap_buffer *, int, int, int, int, int, int);
+void SpriteSpan(uint32_t *, const uint32_t *, int, bool);
+void SpriteBlendSpan(uint32_t *, const uint32_t *, int);
+
+#endif /* SPRITE_H */
\ No newline at end of file
@@ -0,0 +1,470 @@
+/*=============================================================================
+    stream.c
+ =============================================================================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define STREAM_SSE2
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define STREAM_NEON
+#endif
+
+#include "game.h"
+#include "memory.h"
+#include "stream.h"
+
+/*-----------------------------------------------------------------------------
+    StreamEncoderOpen
+    Start streaming frames of the given size to a path: a Unix socket a
+    viewer listens on, a named pipe, or a file. The encoder's buffers, of
+    StreamMemorySize, come from an arena. Writes the stream header and
+    starts the encoder thread. Returns false if the path cannot be opened.
+ ----------------------------------------------------------------------------*/
+bool StreamEncoderOpen(struct stream_encoder *encoder, const char *path, int width, int height, struct memory_arena *arena)
+{
+    uint8_t header[STREAM_HEADER_SIZE];
+
+    memset(encoder, 0, sizeof(*encoder));
+    encoder->width = width;
+    encoder->height = height;
+    encoder->frameSize = width * height * STREAM_BYTES_PER_PIXEL;
+
+#ifdef _WIN32
+    /* A named pipe must already exist. */
+    encoder->file = CreateFileA(path, GENERIC_WRITE, 0, NULL,
+        (strncmp(path, "\\\\.\\pipe\\", 9) == 0) ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (encoder->file == INVALID_HANDLE_VALUE)
+        return false;
+#else
+    struct stat pathStat;
+    struct sockaddr_un address;
+
+    if (stat(path, &pathStat) == 0 && S_ISSOCK(pathStat.st_mode)) {
+        if (strlen(path) >= sizeof(address.sun_path))
+            return false;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, path);
+        encoder->file = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (encoder->file < 0)
+            return false;
+        if (connect(encoder->file, (struct sockaddr *)&address, sizeof(address)) != 0) {
+            close(encoder->file);
+            return false;
+        }
+    }
+    else {
+        /* Opening a named pipe waits for its reader. */
+        encoder->file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (encoder->file < 0)
+            return false;
+    }
+#endif
+
+    /* The first frame is sent against black. */
+    for (int slot = 0; slot < STREAM_SLOTS; slot++)
+        encoder->slots[slot] = ArenaPush(arena, encoder->frameSize);
+    encoder->latest = ArenaPush(arena, encoder->frameSize);
+    encoder->spare = ArenaPush(arena, encoder->frameSize);
+    encoder->previous = ArenaPush(arena, encoder->frameSize);
+    memset(encoder->previous, 0, encoder->frameSize);
+    encoder->packet = ArenaPush(arena, STREAM_FRAME_HEADER_SIZE + StreamPayloadMax(encoder->frameSize));
+
+    StreamPut32(header, STREAM_MAGIC);
+    StreamPut32(header + 4, (uint32_t)width);
+    StreamPut32(header + 8, (uint32_t)height);
+    encoder->failed = !StreamWrite(encoder, header, STREAM_HEADER_SIZE);
+
+#ifdef _WIN32
+    InitializeSRWLock(&encoder->lock);
+    InitializeConditionVariable(&encoder->wake);
+    encoder->thread = CreateThread(NULL, 0, StreamEncoderThread, encoder, 0, NULL);
+#else
+    pthread_mutex_init(&encoder->lock, NULL);
+    pthread_cond_init(&encoder->wake, NULL);
+    pthread_create(&encoder->thread, NULL, StreamEncoderThread, encoder);
+#endif
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamMemorySize
+    Returns the memory an encoder needs from its arena for frames of the
+    given size.
+ ----------------------------------------------------------------------------*/
+size_t StreamMemorySize(int width, int height)
+{
+    size_t frameSize = (size_t)width * height * STREAM_BYTES_PER_PIXEL;
+
+    return (STREAM_SLOTS + 3) * ARENA_SIZE(frameSize)
+        + ARENA_SIZE(STREAM_FRAME_HEADER_SIZE + StreamPayloadMax((int)frameSize));
+}
+
+/*-----------------------------------------------------------------------------
+    StreamEncoderClose
+    Encode and write the frames still queued and the latest frame, then
+    stop the encoder thread and close the stream.
+ ----------------------------------------------------------------------------*/
+void StreamEncoderClose(struct stream_encoder *encoder)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&encoder->lock);
+    encoder->quit = 1;
+    WakeConditionVariable(&encoder->wake);
+    ReleaseSRWLockExclusive(&encoder->lock);
+    WaitForSingleObject(encoder->thread, INFINITE);
+    CloseHandle(encoder->thread);
+    CloseHandle(encoder->file);
+#else
+    pthread_mutex_lock(&encoder->lock);
+    encoder->quit = 1;
+    pthread_cond_signal(&encoder->wake);
+    pthread_mutex_unlock(&encoder->lock);
+    pthread_join(encoder->thread, NULL);
+    pthread_mutex_destroy(&encoder->lock);
+    pthread_cond_destroy(&encoder->wake);
+    close(encoder->file);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamSubmit
+    Queue a frame for the encoder thread. If the queue is full, or a
+    latest frame is already waiting, the frame becomes the latest frame
+    and the one it replaces is dropped. The frame is not copied: its
+    memory is swapped for a free slot's, so the buffer must be the size
+    the stream was opened with, rows packed, and fully redrawn before it
+    is next submitted.
+    Called from the game thread only.
+ ----------------------------------------------------------------------------*/
+void StreamSubmit(struct stream_encoder *encoder, struct bitmap_buffer *buffer)
+{
+    uint32_t writeIndex = encoder->writeIndex;
+    uint8_t *slot;
+
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&encoder->lock);
+#else
+    pthread_mutex_lock(&encoder->lock);
+#endif
+
+    if (encoder->latestPending || writeIndex - AtomicLoadAcquire(&encoder->readIndex) == STREAM_SLOTS) {
+        if (encoder->latestPending)
+            encoder->framesDropped++;
+        slot = encoder->latest;
+        encoder->latest = buffer->memory;
+        buffer->memory = slot;
+        encoder->latestFrame = encoder->frameNext++;
+        encoder->latestPending = true;
+    }
+    else {
+        slot = encoder->slots[writeIndex & STREAM_SLOT_MASK];
+        encoder->slots[writeIndex & STREAM_SLOT_MASK] = buffer->memory;
+        buffer->memory = slot;
+        encoder->slotFrames[writeIndex & STREAM_SLOT_MASK] = encoder->frameNext++;
+        AtomicStoreRelease(&encoder->writeIndex, writeIndex + 1);
+    }
+
+#ifdef _WIN32
+    WakeConditionVariable(&encoder->wake);
+    ReleaseSRWLockExclusive(&encoder->lock);
+#else
+    pthread_cond_signal(&encoder->wake);
+    pthread_mutex_unlock(&encoder->lock);
+#endif
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamEncoderThread
+    Encode and write queued frames, and the latest frame once the queue is
+    empty, until told to stop with none left. Once a write fails, frames
+    are taken off the queue and thrown away.
+ ----------------------------------------------------------------------------*/
+#ifdef _WIN32
+DWORD WINAPI StreamEncoderThread(LPVOID parameter)
+#else
+void *StreamEncoderThread(void *parameter)
+#endif
+{
+    struct stream_encoder *encoder = parameter;
+    uint32_t readIndex;
+    uint8_t *frame;
+    uint32_t frameNumber;
+    bool queued;
+    int payloadSize;
+
+#ifndef _WIN32
+    /* A reader that goes away makes writes fail, rather than ending the
+       process. */
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+#endif
+
+    for (;;) {
+        readIndex = encoder->readIndex;
+        frame = NULL;
+        frameNumber = 0;
+#ifdef _WIN32
+        AcquireSRWLockExclusive(&encoder->lock);
+        while (AtomicLoadAcquire(&encoder->writeIndex) == readIndex && !encoder->latestPending && !encoder->quit)
+            SleepConditionVariableSRW(&encoder->wake, &encoder->lock, INFINITE, 0);
+#else
+        pthread_mutex_lock(&encoder->lock);
+        while (AtomicLoadAcquire(&encoder->writeIndex) == readIndex && !encoder->latestPending && !encoder->quit)
+            pthread_cond_wait(&encoder->wake, &encoder->lock);
+#endif
+        /* The latest frame follows every queued frame, so it is taken only
+           once the queue is empty. Swapping it for the spare frees the
+           latest slot while it is encoded. */
+        queued = AtomicLoadAcquire(&encoder->writeIndex) != readIndex;
+        if (!queued && encoder->latestPending) {
+            frame = encoder->latest;
+            encoder->latest = encoder->spare;
+            encoder->spare = frame;
+            frameNumber = encoder->latestFrame;
+            encoder->latestPending = false;
+        }
+#ifdef _WIN32
+        ReleaseSRWLockExclusive(&encoder->lock);
+#else
+        pthread_mutex_unlock(&encoder->lock);
+#endif
+        if (queued) {
+            frame = encoder->slots[readIndex & STREAM_SLOT_MASK];
+            frameNumber = encoder->slotFrames[readIndex & STREAM_SLOT_MASK];
+        }
+        else if (!frame)
+            break;
+
+        if (!encoder->failed) {
+            payloadSize = StreamEncode(frame, encoder->previous,
+                encoder->frameSize, encoder->packet + STREAM_FRAME_HEADER_SIZE);
+            StreamPut32(encoder->packet, frameNumber);
+            StreamPut32(encoder->packet + 4, (uint32_t)payloadSize);
+            encoder->failed = !StreamWrite(encoder, encoder->packet, STREAM_FRAME_HEADER_SIZE + payloadSize);
+            if (!encoder->failed) {
+                encoder->framesWritten++;
+                encoder->bytesWritten += STREAM_FRAME_HEADER_SIZE + payloadSize;
+            }
+        }
+        if (queued)
+            AtomicStoreRelease(&encoder->readIndex, readIndex + 1);
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamWrite
+    Write all of a block of bytes to the stream. Returns false if it could
+    not be written.
+ ----------------------------------------------------------------------------*/
+bool StreamWrite(struct stream_encoder *encoder, const uint8_t *bytes, int size)
+{
+    while (size > 0) {
+#ifdef _WIN32
+        DWORD written;
+        if (!WriteFile(encoder->file, bytes, (DWORD)size, &written, NULL))
+            return false;
+#else
+        ssize_t written = write(encoder->file, bytes, size);
+        if (written <= 0)
+            return false;
+#endif
+        bytes += written;
+        size -= (int)written;
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamEncode
+    Encode the difference between a frame and the previous one, and bring
+    the previous frame up to date. Returns the size of the payload, which
+    is at most StreamPayloadMax of the frame size.
+ ----------------------------------------------------------------------------*/
+int StreamEncode(const uint8_t *frame, uint8_t *previous, int size, uint8_t *payload)
+{
+    int payloadSize = 0;
+    int position = 0;
+    int skipStart, literalStart, equalRun;
+
+    while (position < size) {
+        skipStart = position;
+        position = StreamSkipEqual(frame, previous, position, size);
+        if (position == size)
+            break;
+
+        /* The literal run goes on until enough equal bytes in a row to be
+           worth a skip. */
+        literalStart = position;
+        equalRun = 0;
+        while (position < size && equalRun < STREAM_SKIP_MIN) {
+            equalRun = (frame[position] == previous[position]) ? equalRun + 1 : 0;
+            position++;
+        }
+        position -= equalRun;
+
+        payloadSize += StreamPutVarint(payload + payloadSize, (uint32_t)(literalStart - skipStart));
+        payloadSize += StreamPutVarint(payload + payloadSize, (uint32_t)(position - literalStart));
+        for (int index = literalStart; index < position; index++) {
+            payload[payloadSize++] = frame[index] ^ previous[index];
+            previous[index] = frame[index];
+        }
+    }
+
+    return payloadSize;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamSkipEqual
+    Returns the position of the first byte from a position on that differs
+    between two frames, or the size if none does. Most of a frame is the
+    same as the one before, so this is where encoding spends its time.
+ ----------------------------------------------------------------------------*/
+int StreamSkipEqual(const uint8_t *frame, const uint8_t *previous, int position, int size)
+{
+#if defined(STREAM_SSE2)
+    for (; position + 16 <= size; position += 16) {
+        __m128i equal = _mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i *)(frame + position)),
+            _mm_loadu_si128((const __m128i *)(previous + position)));
+        if (_mm_movemask_epi8(equal) != 0xFFFF)
+            break;
+    }
+#elif defined(STREAM_NEON)
+    for (; position + 16 <= size; position += 16) {
+        uint64x2_t equal = vreinterpretq_u64_u8(vceqq_u8(vld1q_u8(frame + position), vld1q_u8(previous + position)));
+        if ((vgetq_lane_u64(equal, 0) & vgetq_lane_u64(equal, 1)) != UINT64_MAX)
+            break;
+    }
+#endif
+
+    while (position < size && frame[position] == previous[position])
+        position++;
+
+    return position;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamDecode
+    Apply a payload to the previous frame to make the next one. Returns
+    false if the payload is malformed.
+ ----------------------------------------------------------------------------*/
+bool StreamDecode(const uint8_t *payload, int payloadSize, uint8_t *frame, int size)
+{
+    uint32_t skip, literal;
+    int read = 0;
+    int position = 0;
+    int bytes;
+
+    while (read < payloadSize) {
+        bytes = StreamGetVarint(payload + read, payloadSize - read, &skip);
+        if (bytes == 0)
+            return false;
+        read += bytes;
+        bytes = StreamGetVarint(payload + read, payloadSize - read, &literal);
+        if (bytes == 0)
+            return false;
+        read += bytes;
+
+        if (skip > (uint32_t)(size - position) || literal > (uint32_t)(size - position - (int)skip)
+            || literal > (uint32_t)(payloadSize - read))
+            return false;
+        position += skip;
+        for (uint32_t index = 0; index < literal; index++)
+            frame[position++] ^= payload[read++];
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamPutVarint
+    Write a value seven bits a byte, least significant first, with the top
+    bit set on every byte but the last. Returns the number of bytes.
+ ----------------------------------------------------------------------------*/
+int StreamPutVarint(uint8_t *bytes, uint32_t value)
+{
+    int count = 0;
+
+    while (value >= 0x80) {
+        bytes[count++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    bytes[count++] = (uint8_t)value;
+
+    return count;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamGetVarint
+    Read a value written by StreamPutVarint. Returns the number of bytes,
+    or 0 if the value runs past the end.
+ ----------------------------------------------------------------------------*/
+int StreamGetVarint(const uint8_t *bytes, int size, uint32_t *value)
+{
+    *value = 0;
+    for (int count = 0; count < size && count < 5; count++) {
+        *value |= (uint32_t)(bytes[count] & 0x7F) << (count * 7);
+        if (!(bytes[count] & 0x80))
+            return count + 1;
+    }
+
+    return 0;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamPayloadMax
+    Returns the largest payload a frame of a size can encode to: every byte
+    literal, and a token of two varints for every run.
+ ----------------------------------------------------------------------------*/
+int StreamPayloadMax(int size)
+{
+    return size + (size / (STREAM_SKIP_MIN + 1) + 1) * 10;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamPut32
+    Write a 32 bit value, least significant byte first.
+ ----------------------------------------------------------------------------*/
+void StreamPut32(uint8_t *bytes, uint32_t value)
+{
+    for (int byte = 0; byte < 4; byte++)
+        bytes[byte] = (uint8_t)(value >> (byte * 8));
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    StreamGet32
+    Read a 32 bit value, least significant byte first.
+ ----------------------------------------------------------------------------*/
+uint32_t StreamGet32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
\ No newline at end of file
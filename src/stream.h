@@ -0,0 +1,98 @@
+/*=============================================================================
+    stream.h
+ =============================================================================*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+#include <stddef.h>
+
+#include "atomic.h"
+
+#define STREAM_MAGIC 0x534B4C42
+#define STREAM_HEADER_SIZE 12
+#define STREAM_FRAME_HEADER_SIZE 8
+#define STREAM_BYTES_PER_PIXEL 4
+/* Equal bytes shorter than this are cheaper to send as part of a literal
+   run than to skip with a token of their own. */
+#define STREAM_SKIP_MIN 8
+
+/* Must be a power of two so the free running indices can be masked. */
+#define STREAM_SLOTS 4
+#define STREAM_SLOT_MASK (STREAM_SLOTS - 1)
+
+/* A stream is a header of magic, width and height, then one record per
+   frame: its number, the size of its payload, and the payload. A payload
+   is the frame XORed with the frame before it (or with black), as pairs of
+   varints, the count of zero bytes to skip and the count of literal bytes
+   that follow. Zeros after the last literal are implied. Pixels are 32 bit
+   BGRX, rows packed without padding. All fields are little endian. */
+
+/* Frames are handed over by the game thread and encoded and written by a
+   thread of the encoder's own, single producer, single consumer. A frame
+   submitted while every slot is taken goes to the latest slot instead,
+   replacing the one there, and later frames follow it until the encoder
+   has emptied the queue and taken it, so the game never waits on a slow
+   reader and the last frame submitted is always sent. */
+struct stream_encoder {
+    int width;
+    int height;
+    int frameSize;
+    uint8_t *slots[STREAM_SLOTS];
+    uint32_t slotFrames[STREAM_SLOTS];
+    volatile uint32_t writeIndex;
+    volatile uint32_t readIndex;
+    volatile uint32_t quit;
+    uint32_t frameNext;
+    int framesDropped;
+    uint8_t *latest;
+    uint32_t latestFrame;
+    bool latestPending;
+    uint8_t *spare;
+    uint8_t *previous;
+    uint8_t *packet;
+    int framesWritten;
+    uint64_t bytesWritten;
+    bool failed;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE thread;
+    SRWLOCK lock;
+    CONDITION_VARIABLE wake;
+#else
+    int file;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+#endif
+};
+
+struct bitmap_buffer;
+struct memory_arena;
+
+bool StreamEncoderOpen(struct stream_encoder *, const char *, int, int, struct memory_arena *);
+size_t StreamMemorySize(int, int);
+void StreamEncoderClose(struct stream_encoder *);
+void StreamSubmit(struct stream_encoder *, struct bitmap_buffer *);
+#ifdef _WIN32
+DWORD WINAPI StreamEncoderThread(LPVOID);
+#else
+void *StreamEncoderThread(void *);
+#endif
+bool StreamWrite(struct stream_encoder *, const uint8_t *, int);
+int StreamEncode(const uint8_t *, uint8_t *, int, uint8_t *);
+int StreamSkipEqual(const uint8_t *, const uint8_t *, int, int);
+bool StreamDecode(const uint8_t *, int, uint8_t *, int);
+int StreamPutVarint(uint8_t *, uint32_t);
+int StreamGetVarint(const uint8_t *, int, uint32_t *);
+int StreamPayloadMax(int);
+void StreamPut32(uint8_t *, uint32_t);
+uint32_t StreamGet32(const uint8_t *);
+
+#endif /* STREAM_H */
\ No newline at end of file
@@ -0,0 +1,199 @@
+/*=============================================================================
+    telemetry.c
+    Counters of where things happen in play, for analysing batch runs. The
+    hooks in the game only increment counters in their thread's own block,
+    and cost one test of a pointer when telemetry is off.
+ =============================================================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "game.h"
+#include "telemetry.h"
+
+/*-----------------------------------------------------------------------------
+    TelemetryInit
+    Start a telemetry block in memory of TELEMETRY_MEMORY_SIZE bytes, at
+    the first cache line boundary in it, with every counter zero. Returns
+    the block.
+ ----------------------------------------------------------------------------*/
+struct telemetry *TelemetryInit(void *memory)
+{
+    struct telemetry *telemetry = (struct telemetry *)((uint8_t *)memory
+        + (TELEMETRY_ALIGNMENT - (uintptr_t)memory % TELEMETRY_ALIGNMENT) % TELEMETRY_ALIGNMENT);
+
+    memset(telemetry, 0, sizeof(*telemetry));
+
+    return telemetry;
+}
+
+/*-----------------------------------------------------------------------------
+    TelemetryTick
+    Count ticks played, in the run and in the game under way.
+ ----------------------------------------------------------------------------*/
+void TelemetryTick(struct telemetry *telemetry, int ticks)
+{
+    telemetry->counters.ticks += ticks;
+    telemetry->gameTicks += ticks;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    TelemetryBrickHit
+    Count a hit on a brick, by its row and column.
+ ----------------------------------------------------------------------------*/
+void TelemetryBrickHit(struct telemetry *telemetry, const struct brick_set *brickSet, int brickIndex)
+{
+    int columns = brickSet->base->columns;
+
+    telemetry->counters.brickHits[brickIndex / columns][brickIndex % columns]++;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    TelemetryPaddleHit
+    Count a bounce off the top of a paddle, by where the ball struck it as
+    BallBouncePaddle measures it, before the dead zone pushes it aside. A
+    paddle the rules make wider or narrower than the default is scaled to
+    the default's buckets.
+ ----------------------------------------------------------------------------*/
+void TelemetryPaddleHit(struct telemetry *telemetry, float ballPosRelativePaddle, int paddleWidth)
+{
+    int bucket;
+
+    if (paddleWidth != PADDLE_WIDTH)
+        ballPosRelativePaddle *= (float)TELEMETRY_PADDLE_BUCKETS / (float)(paddleWidth + BALL_WIDTH);
+    bucket = (int)ballPosRelativePaddle;
+
+    bucket = (bucket < 0) ? 0 : (bucket >= TELEMETRY_PADDLE_BUCKETS) ? TELEMETRY_PADDLE_BUCKETS - 1 : bucket;
+    telemetry->counters.paddleHits[bucket]++;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    TelemetryLifeLost
+    Count a life lost, by where the ball left the screen.
+ ----------------------------------------------------------------------------*/
+void TelemetryLifeLost(struct telemetry *telemetry, float ballX)
+{
+    int bucket = (int)ballX;
+
+    bucket = (bucket < 0) ? 0 : (bucket >= TELEMETRY_LIFE_BUCKETS) ? TELEMETRY_LIFE_BUCKETS - 1 : bucket;
+    telemetry->counters.livesLost[bucket]++;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    TelemetryGameEnd
+    Count a game that has ended, by how many ticks it lasted.
+ ----------------------------------------------------------------------------*/
+void TelemetryGameEnd(struct telemetry *telemetry)
+{
+    int bucket = 0;
+
+    while (bucket < TELEMETRY_GAME_TICKS_BUCKETS - 1 && (telemetry->gameTicks >> (bucket + 1)) != 0)
+        bucket++;
+    telemetry->counters.gameTicks[bucket]++;
+    telemetry->counters.gamesEnded++;
+    telemetry->gameTicks = 0;
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    TelemetryMerge
+    Add a block's counters into a total and zero them, so the block can go
+    on counting from there. Only the block's own thread may call this, but
+    any number of threads can merge into the same total at once; counters
+    are added atomically and the many that are still zero are skipped.
+ ----------------------------------------------------------------------------*/
+void TelemetryMerge(struct telemetry_counters *total, struct telemetry *telemetry)
+{
+    volatile uint64_t *totalCounters = (volatile uint64_t *)total;
+    uint64_t *blockCounters = (uint64_t *)&telemetry->counters;
+
+    for (size_t counter = 0; counter < TELEMETRY_COUNTERS; counter++) {
+        if (blockCounters[counter] != 0) {
+            AtomicAdd64(&totalCounters[counter], blockCounters[counter]);
+            blockCounters[counter] = 0;
+        }
+    }
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    TelemetryWrite
+    Write counters to a telemetry file. The brick grid is cut down to the
+    rows and columns that were ever hit. Returns false on failure.
+ ----------------------------------------------------------------------------*/
+bool TelemetryWrite(const char *path, const struct telemetry_counters *counters)
+{
+    struct telemetry_file_header header;
+    int rows = 0, columns = 0;
+    bool written;
+    FILE *file;
+
+    for (int row = 0; row < BRICK_ROWS_MAX; row++) {
+        for (int column = 0; column < BRICK_COLUMNS_MAX; column++) {
+            if (counters->brickHits[row][column] != 0) {
+                rows = (row + 1 > rows) ? row + 1 : rows;
+                columns = (column + 1 > columns) ? column + 1 : columns;
+            }
+        }
+    }
+
+    file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    header.magic = TELEMETRY_MAGIC;
+    header.version = TELEMETRY_VERSION;
+    header.columnCount = 6;
+    written = fwrite(&header, sizeof(header), 1, file) == 1
+        && TelemetryWriteColumn(file, "ticks", &counters->ticks, 1, 1, 1)
+        && TelemetryWriteColumn(file, "games_ended", &counters->gamesEnded, 1, 1, 1)
+        && TelemetryWriteColumn(file, "game_ticks", counters->gameTicks, 1, TELEMETRY_GAME_TICKS_BUCKETS, TELEMETRY_GAME_TICKS_BUCKETS)
+        && TelemetryWriteColumn(file, "paddle_hits", counters->paddleHits, 1, TELEMETRY_PADDLE_BUCKETS, TELEMETRY_PADDLE_BUCKETS)
+        && TelemetryWriteColumn(file, "lives_lost", counters->livesLost, 1, TELEMETRY_LIFE_BUCKETS, TELEMETRY_LIFE_BUCKETS)
+        && TelemetryWriteColumn(file, "brick_hits", &counters->brickHits[0][0], rows, columns, BRICK_COLUMNS_MAX);
+    if (fclose(file) != 0)
+        written = false;
+
+    return written;
+}
+
+/*-----------------------------------------------------------------------------
+    TelemetryWriteColumn
+    Write a column's entry in the table, then its counters, a row at a
+    time from an array with rows pitch counters apart. Returns false on
+    failure.
+ ----------------------------------------------------------------------------*/
+bool TelemetryWriteColumn(FILE *file, const char *name, const uint64_t *counters, int rows, int columns, int pitch)
+{
+    struct telemetry_column column;
+    size_t nameLength = strlen(name);
+
+    /* The name is cut short if need be, and always ends in a zero. */
+    if (nameLength > TELEMETRY_COLUMN_NAME_SIZE - 1)
+        nameLength = TELEMETRY_COLUMN_NAME_SIZE - 1;
+    memset(&column, 0, sizeof(column));
+    memcpy(column.name, name, nameLength);
+    column.rows = (uint16_t)rows;
+    column.columns = (uint16_t)columns;
+    if (fwrite(&column, sizeof(column), 1, file) != 1)
+        return false;
+
+    for (int row = 0; row < rows; row++) {
+        if (fwrite(counters + (size_t)row * pitch, sizeof(uint64_t), columns, file) != (size_t)columns)
+            return false;
+    }
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*=============================================================================
+    telemetry.h
+ =============================================================================*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "atomic.h"
+
+#define TELEMETRY_MAGIC 0x544B4C42 /* "BLKT" */
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_ALIGNMENT 64
+#define TELEMETRY_COLUMN_NAME_SIZE 12
+
+/* Games are counted by their length in ticks, a power of two to a bucket.
+   Paddle hits are counted by where the ball struck, one bucket per pixel
+   of the span BallBouncePaddle measures across the default paddle, dead
+   zone included; other paddles are scaled to fit. Lives
+   are counted by where the ball was lost, one bucket per pixel. */
+#define TELEMETRY_GAME_TICKS_BUCKETS 32
+#define TELEMETRY_PADDLE_BUCKETS (PADDLE_WIDTH + BALL_WIDTH)
+#define TELEMETRY_LIFE_BUCKETS QVGA_WIDTH
+
+/* Every counter is 64 bits, so a set of counters can be added to another
+   as a flat array. Bricks are counted on the largest grid, by row and
+   column, so games on levels with other grids still line up. */
+struct telemetry_counters {
+    uint64_t ticks;
+    uint64_t gamesEnded;
+    uint64_t gameTicks[TELEMETRY_GAME_TICKS_BUCKETS];
+    uint64_t paddleHits[TELEMETRY_PADDLE_BUCKETS];
+    uint64_t livesLost[TELEMETRY_LIFE_BUCKETS];
+    uint64_t brickHits[BRICK_ROWS_MAX][BRICK_COLUMNS_MAX];
+};
+
+#define TELEMETRY_COUNTERS (sizeof(struct telemetry_counters) / sizeof(uint64_t))
+
+/* One block per thread that runs games, written with plain increments by
+   that thread alone. Blocks start on a cache line of their own, so the
+   hooks of threads running side by side never share a line. */
+struct telemetry {
+    struct telemetry_counters counters;
+    uint64_t gameTicks;
+};
+
+#define TELEMETRY_MEMORY_SIZE (sizeof(struct telemetry) + TELEMETRY_ALIGNMENT - 1)
+
+/* A telemetry file is a header, then every column in turn: an entry
+   naming it and giving its size, then its counters row by row. Everything
+   is little-endian. */
+struct telemetry_file_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t columnCount;
+};
+
+struct telemetry_column {
+    char name[TELEMETRY_COLUMN_NAME_SIZE];
+    uint16_t rows;
+    uint16_t columns;
+};
+
+struct telemetry *TelemetryInit(void *);
+void TelemetryTick(struct telemetry *, int);
+void TelemetryBrickHit(struct telemetry *, const struct brick_set *, int);
+void TelemetryPaddleHit(struct telemetry *, float, int);
+void TelemetryLifeLost(struct telemetry *, float);
+void TelemetryGameEnd(struct telemetry *);
+void TelemetryMerge(struct telemetry_counters *, struct telemetry *);
+bool TelemetryWrite(const char *, const struct telemetry_counters *);
+bool TelemetryWriteColumn(FILE *, const char *, const uint64_t *, int, int, int);
+
+#endif /* TELEMETRY_H */
\ No newline at end of file
@@ -8,28 +8,15 @@
 
 #include "game.h"
 #include "text.h"
+#include "render.h"
 
 /*-----------------------------------------------------------------------------
     DrawGlyph
-    Draw a glyph to a bitmap buffer.
+    Draw a glyph.
  ----------------------------------------------------------------------------*/
-void DrawGlyph(char font[][FONT_SIZE], unsigned int glyph, struct text_cursor *cursor, uint32_t color, struct bitmap_buffer *bitmapBuffer)
+void DrawGlyph(char font[][FONT_SIZE], unsigned int glyph, struct text_cursor *cursor, uint8_t color, struct render_list *renderList)
 {
-    bool fillPixel;
-
-    uint8_t *row = bitmapBuffer->memory;
-    row += bitmapBuffer->pitch * cursor->y;
-    for (int glyphY = 0; glyphY < FONT_SIZE; glyphY++) {
-        uint32_t *pixel = (uint32_t *)row;
-        pixel += cursor->x;
-        for (int glyphX = 0; glyphX < FONT_SIZE; glyphX++) {
-            fillPixel = font[glyph][glyphY] & (1 << (FONT_SIZE - glyphX));
-            if (fillPixel)
-                *pixel = color;
-            pixel++;
-        }
-        row += bitmapBuffer->pitch;
-    }
+    RenderPushGlyph(renderList, font[glyph], cursor->x, cursor->y, color);
 
     cursor->x += cursor->size;
 
@@ -38,23 +25,23 @@ void DrawGlyph(char font[][FONT_SIZE], unsigned int glyph, struct text_cursor *c
 
 /*-----------------------------------------------------------------------------
     DrawCharacter
-    Draw a single character to a bitmap buffer.
+    Draw a single character.
  ----------------------------------------------------------------------------*/
-void DrawCharacter(unsigned int character, struct text_cursor *cursor, uint32_t color, struct bitmap_buffer *bitmapBuffer)
+void DrawCharacter(unsigned int character, struct text_cursor *cursor, uint8_t color, struct render_list *renderList)
 {
     character -= ASCII_OFFSET;
 
     if (character < NUM_OF_LETTERS)
-        DrawGlyph(font_letters, character, cursor, color, bitmapBuffer);
+        DrawGlyph(font_letters, character, cursor, color, renderList);
 
     return;
 }
 
 /*-----------------------------------------------------------------------------
     DrawString
-    Draw a string to a bitmap buffer.
+    Draw a string.
  ----------------------------------------------------------------------------*/
-void DrawString(char *string, struct text_cursor *cursor, uint32_t color, struct bitmap_buffer *bitmapBuffer)
+void DrawString(char *string, struct text_cursor *cursor, uint8_t color, struct render_list *renderList)
 {
     char c;
 
@@ -63,7 +50,7 @@ void DrawString(char *string, struct text_cursor *cursor, uint32_t color, struct
         if (c == ' ')
             cursor->x += cursor->size;
         else
-            DrawCharacter((unsigned int)c, cursor, color, bitmapBuffer);
+            DrawCharacter((unsigned int)c, cursor, color, renderList);
         string++;
     }
 
@@ -72,27 +59,27 @@ void DrawString(char *string, struct text_cursor *cursor, uint32_t color, struct
 
 /*-----------------------------------------------------------------------------
     DrawDigit
-    Draw a single digit to a bitmap buffer.
+    Draw a single digit.
  ----------------------------------------------------------------------------*/
-void DrawDigit(unsigned int digit, struct text_cursor *cursor, uint32_t color, struct bitmap_buffer *bitmapBuffer)
+void DrawDigit(unsigned int digit, struct text_cursor *cursor, uint8_t color, struct render_list *renderList)
 {
     if (digit < NUM_OF_NUMBERS)
-        DrawGlyph(font_numbers, digit, cursor, color, bitmapBuffer);
+        DrawGlyph(font_numbers, digit, cursor, color, renderList);
 
     return;
 }
 
 /*-----------------------------------------------------------------------------
     DrawNumber
-    Draw a number to a bitmap buffer.
+    Draw a number.
  ----------------------------------------------------------------------------*/
-void DrawNumber(int number, int digits, struct text_cursor *cursor, uint32_t color, struct bitmap_buffer *bitmapBuffer)
+void DrawNumber(int number, int digits, struct text_cursor *cursor, uint8_t color, struct render_list *renderList)
 {
     int digit;
     int padding = pow(10, digits - 1);
 
     while (padding > 0 && number / padding == 0) {
-        DrawDigit(0, cursor, color, bitmapBuffer);
+        DrawDigit(0, cursor, color, renderList);
         padding /= 10;
         digits -= 1;
     }
@@ -101,13 +88,13 @@ void DrawNumber(int number, int digits, struct text_cursor *cursor, uint32_t col
 
     while (number > 0) {
         digit = number % 10;
-        DrawDigit(digit, cursor, color, bitmapBuffer);
+        DrawDigit(digit, cursor, color, renderList);
         number /= 10;
         digits -= 1;
     }
 
     if (digits > 0)
-        DrawDigit(0, cursor, color, bitmapBuffer);
+        DrawDigit(0, cursor, color, renderList);
 
     return;
 }
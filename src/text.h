@@ -58,13 +58,13 @@ struct text_cursor {
     int size;
 };
 
-struct bitmap_buffer;
+struct render_list;
 
-void DrawGlyph(char [][FONT_SIZE], unsigned int, struct text_cursor *, uint32_t, struct bitmap_buffer *);
-void DrawCharacter(unsigned int, struct text_cursor *, uint32_t, struct bitmap_buffer *);
-void DrawString(char *, struct text_cursor *, uint32_t, struct bitmap_buffer *);
-void DrawDigit(unsigned int, struct text_cursor *, uint32_t, struct bitmap_buffer *);
-void DrawNumber(int, int, struct text_cursor *, uint32_t, struct bitmap_buffer *);
+void DrawGlyph(char [][FONT_SIZE], unsigned int, struct text_cursor *, uint8_t, struct render_list *);
+void DrawCharacter(unsigned int, struct text_cursor *, uint8_t, struct render_list *);
+void DrawString(char *, struct text_cursor *, uint8_t, struct render_list *);
+void DrawDigit(unsigned int, struct text_cursor *, uint8_t, struct render_list *);
+void DrawNumber(int, int, struct text_cursor *, uint8_t, struct render_list *);
 int ReverseNumber(int);
 
 #endif /* FONT_H */
\ No newline at end of file
@@ -3,4 +3,5 @@
 IF NOT EXIST ..\..\build mkdir ..\..\build
 pushd ..\..\build
 cl -Zi /Febreakout ..\src\win\win_main.c user32.lib gdi32.lib winmm.lib opengl32.lib
+cl -Zi /LD /Feblocks ..\src\lib\blocks_lib.c
 popd
\ No newline at end of file
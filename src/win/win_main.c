@@ -6,12 +6,30 @@
 #include <gl/gl.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 
 #include "win_main.h"
 
+#include "../atomic.c"
+#include "../input.c"
+#include "../latency.c"
+#include "../pacer.c"
 #include "../text.c"
+#include "../palette.c"
+#include "../render.c"
+#include "../sprite.c"
+#include "../particles.c"
+#include "../audio.c"
+#include "../level.c"
+#include "../memory.c"
 #include "../game.c"
+#include "../rules.c"
+#include "../bricks.c"
+#include "../simulate.c"
+#include "../kernels.c"
+#include "../telemetry.c"
+#include "../autopilot.c"
 
 /*-----------------------------------------------------------------------------
     WinMain
@@ -63,15 +81,72 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     float msPerUpdate = (float)MS_PER_SECOND / (float)UPDATES_PER_SECOND;
     float msAccumulator = 0.0f;
 
-    /* Allocate game memory */
-    struct game_memory *gameMemory;
-    gameMemory = VirtualAlloc(NULL, sizeof(struct game_memory), MEM_COMMIT, PAGE_READWRITE);
+    /* Reserve all the game's memory up front, the game state first. The
+       frame buffer belongs to the DIB section. */
+    struct memory_reservation memory;
+    size_t permanentSize = ARENA_SIZE(sizeof(struct game_state))
+        + ARENA_SIZE(BrickBaseSize(BRICK_CAPACITY_MAX))
+        + ARENA_SIZE(sizeof(struct particle_system))
+        + ARENA_SIZE(sizeof(struct game_memory))
+        + ARENA_SIZE(sizeof(struct input_queue))
+        + ARENA_SIZE(sizeof(struct latency_tracer))
+        + ARENA_SIZE(sizeof(struct wave_out_sink))
+        + ARENA_SIZE(sizeof(struct audio_mixer))
+        + ARENA_SIZE(INDEX_BITMAP_SIZE)
+        + ARENA_SIZE(sizeof(struct sprite_atlas));
+    if (!MemoryReserve(&memory, permanentSize, sizeof(struct render_list))) {
+        MessageBox(NULL, TEXT("Could not reserve memory."),
+            szAppName, MB_ICONERROR);
+        return 0;
+    }
     struct game_state *gameState;
-    gameState = VirtualAlloc(NULL, sizeof(struct game_state), MEM_COMMIT, PAGE_READWRITE);
-    GameInit(gameState);
+    gameState = ArenaPush(&memory.permanent, sizeof(struct game_state));
+    void *brickMemory;
+    brickMemory = ArenaPush(&memory.permanent, BrickBaseSize(BRICK_CAPACITY_MAX));
+    BrickSetInit(&gameState->bricks, brickMemory, BRICK_CAPACITY_MAX);
+    gameState->particles = ArenaPush(&memory.permanent, sizeof(struct particle_system));
+    ParticleSystemInit(gameState->particles, (uint32_t)ComputeTimestampUs());
+    /* Load a level file or level pack given on the command line. */
+    const struct level_header *level = NULL;
+    uint64_t levelFileSize = 0;
+    void *levelFile = NULL;
+    if (__argc > 1) {
+        levelFile = MapFile(__argv[1], &levelFileSize);
+        if (levelFile)
+            level = LevelLoad(levelFile, levelFileSize, (__argc > 2) ? atoi(__argv[2]) : 0);
+        if (!level)
+            MessageBox(NULL, TEXT("Could not load the level, using the default level."),
+                szAppName, MB_ICONWARNING);
+    }
+    GameInit(gameState, level);
+    struct game_memory *gameMemory;
+    gameMemory = ArenaPush(&memory.permanent, sizeof(struct game_memory));
+    struct input_queue *inputQueue;
+    inputQueue = ArenaPush(&memory.permanent, sizeof(struct input_queue));
+    InputQueueInit(inputQueue);
+    struct latency_tracer *latencyTracer;
+    latencyTracer = ArenaPush(&memory.permanent, sizeof(struct latency_tracer));
+    LatencyTraceInit(latencyTracer, getenv("BLOCKS_LATENCY_TRACE"));
+    struct autopilot autopilot;
+    AutopilotInit(&autopilot);
     enum graphicsAPIType graphicsAPI = opengl;
+    /* Sounds are mixed on a thread paced by the wave out device. Without a
+       device the game is silent. */
+    struct audio_sink audioSink;
+    struct wave_out_sink *waveOutSink = ArenaPush(&memory.permanent, sizeof(struct wave_out_sink));
+    struct audio_mixer *audioMixer = ArenaPush(&memory.permanent, sizeof(struct audio_mixer));
+    bool audioStarted = WaveOutSinkOpen(&audioSink, waveOutSink);
+    if (audioStarted) {
+        AudioMixerInit(audioMixer, &audioSink);
+        gameState->audio = &audioMixer->queue;
+        AudioMixerStart(audioMixer);
+    }
     gameMemory->gameState = gameState;
+    gameMemory->inputQueue = inputQueue;
+    gameMemory->latencyTracer = latencyTracer;
+    gameMemory->autopilot = &autopilot;
     gameMemory->graphicsAPI = &graphicsAPI;
+    gameMemory->redraw = true;
 
     /* Create the window. */
     HWND hwnd;
@@ -115,13 +190,21 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     HGLRC hglrc = wglCreateContext(hdc);
     wglMakeCurrent(hdc, hglrc);
     wgl_swap_interval_ext *wglSwapInterval = (wgl_swap_interval_ext *)wglGetProcAddress("wglSwapIntervalEXT");
-    if(wglSwapInterval)
-        wglSwapInterval(1);
+
+    /* With vsync, present waits for the refresh, so the pacer can start each
+       frame just in time for it. A refresh rate of 0 or 1 means the
+       hardware default, taken to be 60 Hz. */
+    bool pacing = wglSwapInterval && wglSwapInterval(1);
+    int refreshHz = GetDeviceCaps(hdc, VREFRESH);
+    if (refreshHz <= 1)
+        refreshHz = UPDATES_PER_SECOND;
+    struct frame_pacer pacer;
+    PacerInit(&pacer, US_PER_SECOND / refreshHz, ComputeTimestampUs());
 
     /* Create a Windows frame buffer. */
     HBITMAP frameBmp;
     int bitmapMemorySize = QVGA_WIDTH * QVGA_HEIGHT * BYTES_PER_PIXEL;
-    void *bitmapMemory = VirtualAlloc(NULL, bitmapMemorySize, MEM_COMMIT, PAGE_READWRITE);
+    void *bitmapMemory = NULL;
 
     BITMAPINFO bitmapInfo;
     bitmapInfo.bmiHeader.biSize = sizeof(bitmapInfo.bmiHeader);
@@ -144,6 +227,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
         NULL,
         0);
 
+    /* The game draws palette colours, which are expanded into the frame
+       buffer, with the sprites blended over them. */
+    void *indexBitmapMemory = ArenaPush(&memory.permanent, INDEX_BITMAP_SIZE);
+    struct palette palette;
+    PaletteInit(&palette, PIXEL_FORMAT_BGRX);
+    struct sprite_atlas *spriteAtlas = ArenaPush(&memory.permanent, sizeof(struct sprite_atlas));
+    SpriteAtlasInit(spriteAtlas, &palette);
+
     /* Release the handle to the window device context. */
     ReleaseDC(hwnd, hdc);
   
@@ -155,6 +246,16 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 
     /* Game loop. */
     for (;;) {
+        /* On the OpenGL path the frame starts as late as it can and still
+           make the next refresh, and input is sampled then. The wait counts
+           as time passed. */
+        if (graphicsAPI == opengl && pacing) {
+            WaitUntilUs(PacerWakeUs(&pacer, ComputeTimestampUs()));
+            msElapsed += ComputeMsElapsed(&ticksStart, &ticksCurrent, &ticksElapsed, &ticksPerSecond);
+            ticksStart = ticksCurrent;
+            PacerFrameStart(&pacer, ComputeTimestampUs());
+        }
+
         while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
             TranslateMessage(&msg);
             DispatchMessage(&msg);
@@ -165,27 +266,71 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 
         msAccumulator += msElapsed;
 
+        AutopilotUpdate(&autopilot, gameState, inputQueue, ComputeTimestampUs(), msPerUpdate);
+
+        /* Line the simulation clock up with the wall clock so queued input
+           lands at the right point within each tick. */
+        gameState->tickTimeUs = ComputeTimestampUs() - (uint64_t)(msAccumulator * US_PER_MS);
+
         while (msAccumulator >= msPerUpdate) {
-            GameUpdate(msPerUpdate, gameState);
+            GameUpdate(msPerUpdate, gameState, inputQueue);
             msAccumulator -= msPerUpdate;
         }
+        LatencyTraceUpdate(latencyTracer, gameState->inputLastId, ComputeTimestampUs());
+
+        /* Nothing is rendered or presented while the frame would come out
+           the same, or the window is minimized. The loop sleeps until the
+           frame will change instead, or until a message arrives. While the
+           game is paused or the window is minimized it waits for messages
+           alone, and the time spent waiting does not count, so the game
+           carries on where it was. */
+        if (IsIconic(hwnd) || (!gameState->frameChanged && !gameMemory->redraw)) {
+            float secondsIdle = IsIconic(hwnd) ? GAME_IDLE_FOREVER : GameSecondsIdle(gameState, inputQueue);
+            if (secondsIdle >= GAME_IDLE_FOREVER) {
+                MsgWaitForMultipleObjects(0, NULL, FALSE, INFINITE, QS_ALLINPUT);
+                QueryPerformanceCounter(&ticksStart);
+            }
+            else {
+                float msIdle = max(secondsIdle * MS_PER_SECOND, msPerUpdate - msAccumulator);
+                MsgWaitForMultipleObjects(0, NULL, FALSE, (DWORD)msIdle, QS_ALLINPUT);
+            }
+            msElapsed = ComputeMsElapsed(&ticksStart, &ticksCurrent, &ticksElapsed, &ticksPerSecond);
+            ticksStart = ticksCurrent;
+            continue;
+        }
+        gameState->frameChanged = false;
+        gameMemory->redraw = false;
 
         //render check for missed?
         struct bitmap_buffer gameBitmapBuffer;
-        gameBitmapBuffer.memory = bitmapMemory;
-        gameBitmapBuffer.memorySize = bitmapMemorySize;
+        gameBitmapBuffer.memory = indexBitmapMemory;
+        gameBitmapBuffer.memorySize = INDEX_BITMAP_SIZE;
         gameBitmapBuffer.width = QVGA_WIDTH;
         gameBitmapBuffer.height = QVGA_HEIGHT;
-        gameBitmapBuffer.pitch = QVGA_WIDTH * BYTES_PER_PIXEL;
-        GameRender(gameState, &gameBitmapBuffer);
+        gameBitmapBuffer.pitch = QVGA_WIDTH;
+        struct bitmap_buffer frameBitmapBuffer;
+        frameBitmapBuffer.memory = bitmapMemory;
+        frameBitmapBuffer.memorySize = bitmapMemorySize;
+        frameBitmapBuffer.width = QVGA_WIDTH;
+        frameBitmapBuffer.height = QVGA_HEIGHT;
+        frameBitmapBuffer.pitch = QVGA_WIDTH * BYTES_PER_PIXEL;
+        ArenaReset(&memory.transient);
+        struct render_list *renderList = ArenaPush(&memory.transient, sizeof(struct render_list));
+        GameRender(gameState, renderList);
+        RenderFrame(NULL, renderList, &gameBitmapBuffer, &palette, spriteAtlas, &frameBitmapBuffer);
+        LatencyTraceRender(latencyTracer, ComputeTimestampUs());
 
         msElapsed = ComputeMsElapsed(&ticksStart, &ticksCurrent, &ticksElapsed, &ticksPerSecond);
         char buffer[256];
         sprintf(buffer, "%.2fms/f\n", msElapsed);
         OutputDebugString(buffer);
 
-        if (graphicsAPI == opengl)
-            BlitFrameOpenGL(hwnd, bitmapMemory);
+        if (graphicsAPI == opengl) {
+            uint64_t swapUs;
+            BlitFrameOpenGL(hwnd, bitmapMemory, &swapUs);
+            if (pacing)
+                PacerFramePresented(&pacer, swapUs, ComputeTimestampUs());
+        }
         else if (graphicsAPI == software) {
             while (msElapsed < msPerUpdate) {
                 DWORD msSleep = (DWORD)(msPerUpdate - msElapsed);
@@ -194,6 +339,18 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
             }
             BlitFrameGDI(hwnd, frameBmp);
         }
+        LatencyTracePresent(latencyTracer, ComputeTimestampUs());
+        if (latencyTracer->eventsSinceReport >= LATENCY_REPORT_EVENTS) {
+            char report[LATENCY_REPORT_SIZE];
+            LatencyTraceReport(latencyTracer, report, sizeof(report));
+            OutputDebugString(report);
+            if (pacing) {
+                sprintf(report, "pacer cost %.2fms (p95) margin %.2fms, %u of %u frames missed\n",
+                    (float)PacerCostUs(&pacer) / US_PER_MS, (float)pacer.marginUs / US_PER_MS,
+                    pacer.framesMissed, pacer.frames);
+                OutputDebugString(report);
+            }
+        }
 
         msElapsed = ComputeMsElapsed(&ticksStart, &ticksCurrent, &ticksElapsed, &ticksPerSecond);
         ticksStart = ticksCurrent;
@@ -206,10 +363,15 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     timeEndPeriod(timerResolution);
 
     /* Clean up resources. */
+    if (audioStarted) {
+        AudioMixerStop(audioMixer);
+        audioSink.close(&audioSink);
+    }
     DeleteObject(frameBmp);
-    VirtualFree(gameState, 0, MEM_RELEASE);
-    VirtualFree(bitmapMemory, 0, MEM_RELEASE);
-    VirtualFree(gameMemory, 0, MEM_RELEASE);
+    LatencyTraceClose(latencyTracer);
+    MemoryRelease(&memory);
+    if (levelFile)
+        UnmapFile(levelFile);
     wglMakeCurrent(NULL, NULL);
     wglDeleteContext(hglrc);
 
@@ -234,34 +396,51 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
     case WM_KEYDOWN:
     case WM_KEYUP:
         gameMemory = (struct game_memory *)GetWindowLongPtr(hwnd, GWLP_USERDATA);
-        struct game_state *gameState = gameMemory->gameState;
+        struct input_queue *inputQueue = gameMemory->inputQueue;
         enum graphicsAPIType *graphicsAPI = gameMemory->graphicsAPI;
         uint32_t virtualKeyCode = wParam;
         uint32_t keyState = lParam;
         bool keyWasDown = ((keyState & KEY_PREVIOUS_STATE) != 0);
         bool keyIsDown = ((keyState & KEY_TRANSITION_STATE) == 0);
+        uint64_t timestampUs = ComputeTimestampUs();
+        uint32_t inputId = 0;
         if (!(keyIsDown && keyWasDown)) {
             switch(virtualKeyCode){
             case VK_LEFT:
-                GameKeyboardUpdate(gameState, GAME_KEY_LEFT, keyIsDown);
+                inputId = GameKeyboardUpdate(inputQueue, GAME_KEY_LEFT, keyIsDown, timestampUs);
                 break;
             case VK_RIGHT:
-                GameKeyboardUpdate(gameState, GAME_KEY_RIGHT, keyIsDown);
+                inputId = GameKeyboardUpdate(inputQueue, GAME_KEY_RIGHT, keyIsDown, timestampUs);
                 break;
             case VK_F2:
-                if (!keyIsDown)
+                if (!keyIsDown) {
                     *graphicsAPI = opengl;
+                    gameMemory->redraw = true;
+                }
                 break;
             case VK_F3:
-                if (!keyIsDown)
+                if (!keyIsDown) {
                     *graphicsAPI = software;
+                    gameMemory->redraw = true;
+                }
+                break;
+            case VK_F5:
+                if (!keyIsDown)
+                    AutopilotToggle(gameMemory->autopilot, gameMemory->gameState, inputQueue, timestampUs);
                 break;
             case VK_ESCAPE:
-                GameKeyboardUpdate(gameState, GAME_KEY_ESCAPE, keyIsDown);
+                inputId = GameKeyboardUpdate(inputQueue, GAME_KEY_ESCAPE, keyIsDown, timestampUs);
                 break;
             }
+            LatencyTraceInput(gameMemory->latencyTracer, inputId, timestampUs);
         }
         break;
+    case WM_PAINT:
+        /* The frame has to be presented again when the window is shown,
+           even if the game has not changed it. */
+        gameMemory = (struct game_memory *)GetWindowLongPtr(hwnd, GWLP_USERDATA);
+        gameMemory->redraw = true;
+        break;
     case WM_DESTROY:
         PostQuitMessage(0);
         return 0;
@@ -272,9 +451,10 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 
 /*-----------------------------------------------------------------------------
     BlitFrameOpenGL
-    Transfers a bitmap to the display via OpenGL.
+    Transfers a bitmap to the display via OpenGL. Sets when the swap was
+    asked for, which returns once the frame is shown when vsync is on.
  ----------------------------------------------------------------------------*/
-void BlitFrameOpenGL(HWND hwnd, void *bitmapMemory)
+void BlitFrameOpenGL(HWND hwnd, void *bitmapMemory, uint64_t *swapUs)
 {
     HDC windowHDC = GetDC(hwnd);
 
@@ -331,6 +511,7 @@ void BlitFrameOpenGL(HWND hwnd, void *bitmapMemory)
 
     glEnd();
 
+    *swapUs = ComputeTimestampUs();
     SwapBuffers(windowHDC);
 
     glDeleteTextures(1, &textureHandle);
@@ -367,6 +548,25 @@ void BlitFrameGDI(HWND hwnd, HBITMAP frameBmp)
     return;
 }
 
+/*-----------------------------------------------------------------------------
+    WaitUntilUs
+    Wait until a performance counter time in microseconds: sleep for most
+    of the wait, then spin for the rest, as sleeps overshoot.
+ ----------------------------------------------------------------------------*/
+void WaitUntilUs(uint64_t wakeUs)
+{
+    uint64_t nowUs;
+
+    while ((nowUs = ComputeTimestampUs()) < wakeUs) {
+        if (wakeUs - nowUs > PACER_SPIN_US)
+            Sleep((DWORD)((wakeUs - nowUs - PACER_SPIN_US) / US_PER_MS));
+        else
+            YieldProcessor();
+    }
+
+    return;
+}
+
 /*-----------------------------------------------------------------------------
     ComputeMsElapsed
     Returns the amount of time elapsed since ticksStart.
@@ -378,4 +578,138 @@ float ComputeMsElapsed(LARGE_INTEGER *ticksStart, LARGE_INTEGER *ticksCurrent,
     *ticksElapsed = ticksCurrent->QuadPart - ticksStart->QuadPart;
 
     return (float)(*ticksElapsed * MS_PER_SECOND) / (float)ticksPerSecond->QuadPart;
+}
+
+/*-----------------------------------------------------------------------------
+    ComputeTimestampUs
+    Returns the current value of the performance counter in microseconds.
+ ----------------------------------------------------------------------------*/
+uint64_t ComputeTimestampUs(void)
+{
+    static LARGE_INTEGER ticksPerSecond;
+    LARGE_INTEGER ticks;
+
+    if (ticksPerSecond.QuadPart == 0)
+        QueryPerformanceFrequency(&ticksPerSecond);
+    QueryPerformanceCounter(&ticks);
+
+    /* Split the conversion to avoid overflowing on long uptimes. */
+    return (ticks.QuadPart / ticksPerSecond.QuadPart) * US_PER_SECOND +
+        (ticks.QuadPart % ticksPerSecond.QuadPart) * US_PER_SECOND / ticksPerSecond.QuadPart;
+}
+
+/*-----------------------------------------------------------------------------
+    MapFile
+    Map a whole file into memory, read only. Returns NULL on failure.
+ ----------------------------------------------------------------------------*/
+void *MapFile(const char *path, uint64_t *size)
+{
+    HANDLE file, mapping;
+    LARGE_INTEGER fileSize;
+    void *memory = NULL;
+
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            *size = fileSize.QuadPart;
+            /* The view keeps the mapping alive. */
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+
+    return memory;
+}
+
+/*-----------------------------------------------------------------------------
+    UnmapFile
+    Unmap a file mapped by MapFile.
+ ----------------------------------------------------------------------------*/
+void UnmapFile(void *memory)
+{
+    UnmapViewOfFile(memory);
+
+    return;
+}
+
+/*-----------------------------------------------------------------------------
+    WaveOutSinkOpen
+    Open the default wave out device for mono 16 bit samples at the mixer's
+    rate. Returns false if there is no device.
+ ----------------------------------------------------------------------------*/
+bool WaveOutSinkOpen(struct audio_sink *sink, struct wave_out_sink *waveOut)
+{
+    WAVEFORMATEX format;
+
+    format.wFormatTag = WAVE_FORMAT_PCM;
+    format.nChannels = 1;
+    format.nSamplesPerSec = AUDIO_SAMPLE_RATE;
+    format.wBitsPerSample = 16;
+    format.nBlockAlign = sizeof(int16_t);
+    format.nAvgBytesPerSec = AUDIO_SAMPLE_RATE * sizeof(int16_t);
+    format.cbSize = 0;
+
+    waveOut->blockDone = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (waveOutOpen(&waveOut->device, WAVE_MAPPER, &format, (DWORD_PTR)waveOut->blockDone, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+        CloseHandle(waveOut->blockDone);
+        return false;
+    }
+
+    for (int block = 0; block < WAVE_OUT_BUFFERS; block++) {
+        ZeroMemory(&waveOut->headers[block], sizeof(WAVEHDR));
+        waveOut->headers[block].lpData = (LPSTR)waveOut->blocks[block];
+        waveOut->headers[block].dwBufferLength = sizeof(waveOut->blocks[block]);
+        waveOutPrepareHeader(waveOut->device, &waveOut->headers[block], sizeof(WAVEHDR));
+    }
+    waveOut->next = 0;
+
+    sink->context = waveOut;
+    sink->write = WaveOutSinkWrite;
+    sink->close = WaveOutSinkClose;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    WaveOutSinkWrite
+    Queue a block of samples on the device, waiting for the oldest queued
+    block to finish playing if every buffer is in use.
+ ----------------------------------------------------------------------------*/
+bool WaveOutSinkWrite(struct audio_sink *sink, const int16_t *samples, int frameCount)
+{
+    struct wave_out_sink *waveOut = sink->context;
+    WAVEHDR *header = &waveOut->headers[waveOut->next];
+
+    while (header->dwFlags & WHDR_INQUEUE)
+        WaitForSingleObject(waveOut->blockDone, INFINITE);
+
+    memcpy(waveOut->blocks[waveOut->next], samples, frameCount * sizeof(int16_t));
+    header->dwBufferLength = frameCount * sizeof(int16_t);
+    if (waveOutWrite(waveOut->device, header, sizeof(WAVEHDR)) != MMSYSERR_NOERROR)
+        return false;
+    waveOut->next = (waveOut->next + 1) % WAVE_OUT_BUFFERS;
+
+    return true;
+}
+
+/*-----------------------------------------------------------------------------
+    WaveOutSinkClose
+    Stop playback and close the device.
+ ----------------------------------------------------------------------------*/
+void WaveOutSinkClose(struct audio_sink *sink)
+{
+    struct wave_out_sink *waveOut = sink->context;
+
+    waveOutReset(waveOut->device);
+    for (int block = 0; block < WAVE_OUT_BUFFERS; block++)
+        waveOutUnprepareHeader(waveOut->device, &waveOut->headers[block], sizeof(WAVEHDR));
+    waveOutClose(waveOut->device);
+    CloseHandle(waveOut->blockDone);
+
+    return;
 }
\ No newline at end of file
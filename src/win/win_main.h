@@ -5,14 +5,18 @@
 #ifndef WIN_MAIN_H
 #define WIN_MAIN_H
 
+#include "../audio.h"
+
 #define KEY_PREVIOUS_STATE 0x40000000L
 #define KEY_TRANSITION_STATE 0x80000000L
 #define QVGA_WIDTH 320
 #define QVGA_HEIGHT 240
 #define BYTES_PER_PIXEL 4
+#define INDEX_BITMAP_SIZE (QVGA_WIDTH * QVGA_HEIGHT)
 #define TARGET_TIMER_RESOLUTION_MS 1
 #define UPDATES_PER_SECOND 60
 #define MS_PER_SECOND 1000
+#define WAVE_OUT_BUFFERS 3
 
 typedef BOOL WINAPI wgl_swap_interval_ext (int interval);
 
@@ -23,12 +27,33 @@ enum graphicsAPIType {
 
 struct game_memory {
     struct game_state *gameState;
+    struct input_queue *inputQueue;
+    struct latency_tracer *latencyTracer;
+    struct autopilot *autopilot;
     enum graphicsAPIType *graphicsAPI;
+    bool redraw;
+};
+
+/* Mixed blocks are queued on the wave out device; writing waits until one
+   of the blocks queued before has played. */
+struct wave_out_sink {
+    HWAVEOUT device;
+    HANDLE blockDone;
+    WAVEHDR headers[WAVE_OUT_BUFFERS];
+    int16_t blocks[WAVE_OUT_BUFFERS][AUDIO_BLOCK_FRAMES];
+    int next;
 };
 
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
-void BlitFrameOpenGL(HWND, void *);
+void BlitFrameOpenGL(HWND, void *, uint64_t *);
 void BlitFrameGDI(HWND, HBITMAP);
+void WaitUntilUs(uint64_t);
 float ComputeMsElapsed(LARGE_INTEGER *, LARGE_INTEGER *, int64_t *, LARGE_INTEGER *);
+uint64_t ComputeTimestampUs(void);
+void *MapFile(const char *, uint64_t *);
+void UnmapFile(void *);
+bool WaveOutSinkOpen(struct audio_sink *, struct wave_out_sink *);
+bool WaveOutSinkWrite(struct audio_sink *, const int16_t *, int);
+void WaveOutSinkClose(struct audio_sink *);
 
 #endif /* WIN_MAIN_H */
\ No newline at end of file